@@ -55,9 +55,9 @@
 #define DEFAULT_DISJOINT                0
 #define DEFAULT_DSL_PER_CORE            2
 
-uint8_t dsl_seq[256];
-uint8_t ID, num_dsl, num_app;
-uint8_t num_procs = DEFAULT_NUM_PROCS;
+uint32_t dsl_seq[SSMP_MAX_UES];
+uint32_t ID, num_dsl, num_app;
+uint32_t num_procs = DEFAULT_NUM_PROCS;
 
 int num_ops = DEFAULT_NUM_OPS;
 int nb_accounts = DEFAULT_NB_ACCOUNTS;
@@ -109,7 +109,7 @@ enum
 
 /* help functions */
 int color_dsl(int id);
-uint8_t nth_dsl(uint8_t id);
+uint32_t nth_dsl(uint32_t id);
 int color_app1(int id);
 int color_all(int id);
 
@@ -126,7 +126,7 @@ deposit(uint32_t acc, uint32_t dsl, uint32_t amount)
 }
 
 int
-check(uint32_t acc, uint8_t dsl)
+check(uint32_t acc, uint32_t dsl)
 {
   msg->w0 = CHECK;
   msg->w1 = acc;
@@ -178,7 +178,7 @@ seed_rand()
 
 
 
-static inline uint8_t
+static inline uint32_t
 get_dsl(uint32_t acc_num, uint32_t nb_accs_per_dsl)
 {
   return dsl_seq[acc_num / nb_accs_per_dsl];
@@ -210,7 +210,7 @@ bank_app()
     {
       uint32_t nb = (uint32_t) (my_random(&(seeds[0]),&(seeds[1]),&(seeds[2])) % 100);
       uint32_t acc = (uint32_t) my_random(&(seeds[0]),&(seeds[1]),&(seeds[2])) & rand_max;
-      uint8_t dsl = get_dsl(acc, nb_accounts_per_dsl);
+      uint32_t dsl = get_dsl(acc, nb_accounts_per_dsl);
       /* PRINT("* %6d *to %-3d for %3d (nb = %3d)", ops, dsl, acc, nb); */
 
       acc %= nb_accounts_per_dsl;
@@ -244,8 +244,7 @@ bank_app()
   ssmp_barrier_wait(1);
 
   ticks t_dur = t_end - t_start - getticks_correction;
-  double ticks_per_sec = REF_SPEED_GHZ * 1e9;
-  double dur = t_dur / ticks_per_sec;
+  double dur = ticks_to_secs(t_dur);
   double througput = num_ops / dur;
 
   /* PRINT("Completed in %10f secs | Througput: %f", dur, througput); */
@@ -459,7 +458,7 @@ main(int argc, char **argv)
     srand(seed);
 
 
-  uint8_t dsl_seq_idx = 0;;
+  uint32_t dsl_seq_idx = 0;;
   for (i = 0; i < num_procs; i++)
     {
       if (color_dsl(i))
@@ -488,7 +487,7 @@ main(int argc, char **argv)
   ssmp_barrier_init(4, 0, color_all);
   ssmp_barrier_init(3, 0, color_all);
 
-  uint8_t rank;
+  uint32_t rank;
   for (rank = 1; rank < num_procs; rank++) 
     {
       pid_t child = fork();
@@ -554,10 +553,10 @@ color_dsl(int id)
   return (id % dsl_per_core == 0);
 }
 
-uint8_t 
-nth_dsl(uint8_t id)
+uint32_t 
+nth_dsl(uint32_t id)
 {
-  uint8_t i, id_seq = 0;
+  uint32_t i, id_seq = 0;
   for (i = 0; i < ssmp_num_ues(); i++)
     {
       if (i == id)
@@ -22,7 +22,7 @@
 
 int num_procs = 2;
 long long int num_reps = 100000;
-uint8_t ID;
+uint32_t ID;
 
 static inline unsigned long* 
 seed_rand() 
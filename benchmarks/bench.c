@@ -0,0 +1,848 @@
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/utsname.h>
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <inttypes.h>
+#include <unistd.h>
+#include <time.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <assert.h>
+#include <getopt.h>
+#include <dirent.h>
+#include <math.h>
+
+#include "common.h"
+#include "ssmp.h"
+
+#include "measurements.h"
+
+/*
+   One harness for the basic workloads: it forks and pins the processes, runs
+   warm-up and measured repetitions of the selected workload, and reports the
+   mean throughput with its 95% confidence interval over the repetitions and the
+   latency percentiles (from the profiler histograms, merged over all processes)
+   as one JSON or CSV record, together with the configuration and the host.
+   Given a list of offered loads (-R), it runs and reports every load in turn,
+   e.g., the latency-vs-throughput curve of open_loop with -S servers.
+*/
+
+uint32_t ID;
+ticks getticks_correction;
+
+int num_procs = 2;
+uint32_t num_ops = 100000;
+int num_reps = 5;
+int num_warmup = 1;
+size_t big_size = 4096;
+int num_servers = 1;
+double rate = 0;		/* offered load of open_loop, requests/s of all clients */
+int pin = 1;
+int init_opts = 0;
+uint32_t* cores = NULL;
+char* cores_str = NULL;
+char* format = "json";
+char* output = NULL;
+char* label = "";
+
+/* ------------------------------------------------------------------------------- */
+/* workloads: run num_ops operations and return the rate of this process (0 if it
+   does not count), recording the latency of its operations with PF_SAMPLE(0) */
+/* ------------------------------------------------------------------------------- */
+
+static inline void
+record_latency(ticks start)
+{
+#if defined(DO_TIMINGS)
+  ticks t = getticks_fenced() - start;
+  PF_SAMPLE(0, (t > getticks_correction) ? t - getticks_correction : 0);
+#endif
+}
+
+/* even processes receive from the next odd one */
+static double
+run_oneway(uint32_t ops)
+{
+  ssmp_msg_t msg;
+  uint32_t i;
+  if (ID % 2 == 0)
+    {
+      ticks t0 = getticks_fenced();
+      for (i = 0; i < ops; i++)
+	{
+	  ssmp_recv_from(ID + 1, &msg);
+	}
+      return ops / ticks_to_secs(getticks_fenced() - t0);
+    }
+
+  for (i = 0; i < ops; i++)
+    {
+      msg.w0 = i;
+      ssmp_send(ID - 1, &msg);
+    }
+  return 0;
+}
+
+/* odd processes send to the previous even one, which answers */
+static double
+run_roundtrip(uint32_t ops)
+{
+  ssmp_msg_t msg;
+  uint32_t i;
+  if (ID % 2 == 0)
+    {
+      for (i = 0; i < ops; i++)
+	{
+	  ssmp_recv_from(ID + 1, &msg);
+	  ssmp_send(ID + 1, &msg);
+	}
+      return 0;
+    }
+
+  ticks t0 = getticks_fenced();
+  for (i = 0; i < ops; i++)
+    {
+      ticks t = getticks_fenced();
+      ssmp_send(ID - 1, &msg);
+      ssmp_recv_from(ID - 1, &msg);
+      record_latency(t);
+    }
+  return ops / ticks_to_secs(getticks_fenced() - t0);
+}
+
+/* processes 0 .. num_servers - 1 are the servers and the others the clients;
+   client c sends its requests to server (c - num_servers) % num_servers */
+static inline uint32_t
+server_of(uint32_t client)
+{
+  return (client - num_servers) % num_servers;
+}
+
+/* answer the ops requests of every client of this server */
+static double
+serve(uint32_t ops)
+{
+  ssmp_msg_t msg;
+  uint32_t i, reqs = 0;
+  for (i = num_servers; i < num_procs; i++)
+    {
+      reqs += (server_of(i) == ID) ? ops : 0;
+    }
+
+  ticks t0 = getticks_fenced();
+  for (i = 0; i < reqs; i++)
+    {
+      ssmp_recv(&msg);
+      ssmp_send(msg.sender, &msg);
+    }
+  return reqs ? reqs / ticks_to_secs(getticks_fenced() - t0) : 0;
+}
+
+static double
+run_client_server(uint32_t ops)
+{
+  ssmp_msg_t msg;
+  uint32_t i, server = server_of(ID);
+  if (ID < num_servers)
+    {
+      return serve(ops);
+    }
+
+  for (i = 0; i < ops; i++)
+    {
+      ticks t = getticks_fenced();
+      ssmp_send(server, &msg);
+      ssmp_recv_from(server, &msg);
+      record_latency(t);
+    }
+  return 0;
+}
+
+/* xorshift64*, seeded per process */
+static uint64_t rand_state = 0;
+
+static inline double
+rand_uniform()
+{
+  if (rand_state == 0)
+    {
+      rand_state = ((ID + 1) * 0x9E3779B97F4A7C15ULL) ^ getticks();
+    }
+  rand_state ^= rand_state >> 12;
+  rand_state ^= rand_state << 25;
+  rand_state ^= rand_state >> 27;
+  return ((rand_state * 0x2545F4914F6CDD1DULL) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+/*
+ * client_server with an open loop: the requests of every client arrive as a
+ * Poisson process of rate / clients requests/s, independently of the responses,
+ * and their response time counts from the scheduled arrival. A client can only
+ * have one request in flight (one message buffer per pair), so when its server
+ * falls behind, the next requests leave late and their queueing delay shows up
+ * in the response time instead of lowering the offered load.
+ */
+static double
+run_open_loop(uint32_t ops)
+{
+  ssmp_msg_t msg;
+  uint32_t i, server = server_of(ID);
+  if (ID < num_servers)
+    {
+      return serve(ops);
+    }
+
+  double gap = ticks_per_ns() * 1e9 * (num_procs - num_servers) / rate; /* mean, in ticks */
+  ticks next = getticks_fenced();
+  for (i = 0; i < ops; i++)
+    {
+      next += (ticks) (-log(1 - rand_uniform()) * gap);
+      while (getticks() < next)
+	{
+	  PAUSE;
+	}
+      ssmp_send(server, &msg);
+      ssmp_recv_from(server, &msg);
+      record_latency(next);
+    }
+  return 0;
+}
+
+static double
+run_barrier(uint32_t ops)
+{
+  uint32_t i;
+  ticks t0 = getticks_fenced();
+  for (i = 0; i < ops; i++)
+    {
+      ticks t = getticks_fenced();
+      ssmp_barrier_wait(0);
+      record_latency(t);
+    }
+  return (ID == 0) ? ops / ticks_to_secs(getticks_fenced() - t0) : 0;
+}
+
+/* as oneway, with big_size bytes per message */
+static double
+run_big(uint32_t ops)
+{
+  static char* buf = NULL;
+  uint32_t i;
+  if (buf == NULL)
+    {
+      buf = (char*) malloc(big_size);
+      assert(buf != NULL);
+      memset(buf, 1, big_size);
+    }
+
+  if (ID % 2 == 0)
+    {
+      ticks t0 = getticks_fenced();
+      for (i = 0; i < ops; i++)
+	{
+	  ticks t = getticks_fenced();
+	  ssmp_recv_from_big(ID + 1, buf, big_size);
+	  record_latency(t);
+	}
+      return (double) ops * big_size / ticks_to_secs(getticks_fenced() - t0);
+    }
+
+  for (i = 0; i < ops; i++)
+    {
+      ssmp_send_big(ID - 1, buf, big_size);
+    }
+  return 0;
+}
+
+typedef struct workload
+{
+  const char* name;
+  const char* unit;
+  int pairs;			/* needs an even number of processes */
+  double (*run)(uint32_t ops);
+  const char* desc;
+} workload_t;
+
+static workload_t workloads[] =
+  {
+    {"oneway", "msgs/s", 1, run_oneway, "pairs of processes, one-way messages"},
+    {"roundtrip", "roundtrips/s", 1, run_roundtrip, "pairs of processes, roundtrips"},
+    {"client_server", "requests/s", 0, run_client_server, "-S servers answer the others"},
+    {"open_loop", "requests/s", 0, run_open_loop, "client_server, Poisson arrivals at -R"},
+    {"barrier", "barriers/s", 0, run_barrier, "all processes wait on a barrier"},
+    {"big", "bytes/s", 1, run_big, "pairs of processes, messages of -s bytes"},
+  };
+
+#define NUM_WORKLOADS (sizeof(workloads) / sizeof(workloads[0]))
+
+/* ------------------------------------------------------------------------------- */
+/* statistics */
+/* ------------------------------------------------------------------------------- */
+
+/* two-sided 97.5% quantiles of Student's t, for 1 to 30 degrees of freedom */
+static const double t_975[] =
+  {
+    12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+    2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+    2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042
+  };
+
+typedef struct summary
+{
+  double mean, stddev, ci95, min, max;
+} summary_t;
+
+static summary_t
+summarize(const double* v, int n)
+{
+  summary_t s = {0, 0, 0, 0, 0};
+  int i;
+  if (n == 0)
+    {
+      return s;
+    }
+
+  s.min = s.max = v[0];
+  for (i = 0; i < n; i++)
+    {
+      s.mean += v[i];
+      s.min = (v[i] < s.min) ? v[i] : s.min;
+      s.max = (v[i] > s.max) ? v[i] : s.max;
+    }
+  s.mean /= n;
+
+  if (n > 1)
+    {
+      double ss = 0;
+      for (i = 0; i < n; i++)
+	{
+	  ss += (v[i] - s.mean) * (v[i] - s.mean);
+	}
+      s.stddev = sqrt(ss / (n - 1));
+      double t = (n - 1 <= 30) ? t_975[n - 2] : 1.96;
+      s.ci95 = t * s.stddev / sqrt(n);
+    }
+  return s;
+}
+
+/* ------------------------------------------------------------------------------- */
+/* host */
+/* ------------------------------------------------------------------------------- */
+
+typedef struct host
+{
+  char name[128];
+  char kernel[256];
+  char cpu[128];
+  long cpus;
+  int sockets;
+  int numa_nodes;
+} host_t;
+
+/* keep the string printable inside JSON / CSV */
+static void
+sanitize(char* s)
+{
+  for (; *s; s++)
+    {
+      if (*s == '"' || *s == '\\' || *s == ',' || *s < ' ')
+	{
+	  *s = ' ';
+	}
+    }
+}
+
+static void
+host_info(host_t* h)
+{
+  struct utsname u;
+  memset(h, 0, sizeof(host_t));
+  if (uname(&u) == 0)
+    {
+      snprintf(h->name, sizeof(h->name), "%s", u.nodename);
+      snprintf(h->kernel, sizeof(h->kernel), "%s %s %s", u.sysname, u.release, u.machine);
+    }
+  h->cpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+  FILE* f = fopen("/proc/cpuinfo", "r");
+  char line[512];
+  if (f != NULL)
+    {
+      while (fgets(line, sizeof(line), f) != NULL)
+	{
+	  char* c = strchr(line, ':');
+	  if (strncmp(line, "model name", 10) == 0 && c != NULL)
+	    {
+	      snprintf(h->cpu, sizeof(h->cpu), "%s", c + 2);
+	      h->cpu[strcspn(h->cpu, "\n")] = '\0';
+	      break;
+	    }
+	}
+      fclose(f);
+    }
+
+  /* the distinct physical_package_id of the online cpus */
+  int packages[1024], num_packages = 0, cpu;
+  for (cpu = 0; cpu < h->cpus && cpu < 4096; cpu++)
+    {
+      int p, k;
+      snprintf(line, sizeof(line), "/sys/devices/system/cpu/cpu%d/topology/physical_package_id", cpu);
+      if ((f = fopen(line, "r")) == NULL)
+	{
+	  continue;
+	}
+      if (fscanf(f, "%d", &p) == 1)
+	{
+	  for (k = 0; k < num_packages && packages[k] != p; k++);
+	  if (k == num_packages && num_packages < 1024)
+	    {
+	      packages[num_packages++] = p;
+	    }
+	}
+      fclose(f);
+    }
+  h->sockets = num_packages ? num_packages : 1;
+
+  DIR* dir = opendir("/sys/devices/system/node");
+  if (dir != NULL)
+    {
+      struct dirent* e;
+      int n;
+      while ((e = readdir(dir)) != NULL)
+	{
+	  if (sscanf(e->d_name, "node%d", &n) == 1)
+	    {
+	      h->numa_nodes++;
+	    }
+	}
+      closedir(dir);
+    }
+  if (h->numa_nodes == 0)
+    {
+      h->numa_nodes = 1;
+    }
+
+  sanitize(h->name);
+  sanitize(h->kernel);
+  sanitize(h->cpu);
+}
+
+/* ------------------------------------------------------------------------------- */
+/* reporting */
+/* ------------------------------------------------------------------------------- */
+
+typedef struct latency
+{
+  long long samples;
+  double mean, p50, p90, p99, p999, max;	/* ns */
+} latency_t;
+
+static void
+latency_info(latency_t* l)
+{
+  memset(l, 0, sizeof(latency_t));
+#if defined(DO_TIMINGS)
+  if (total_samples[0])
+    {
+      l->samples = total_samples[0];
+      l->mean = ticks_to_ns(total_sum_ticks[0]) / total_samples[0];
+      l->p50 = ticks_to_ns(pf_percentile(0, 0.5));
+      l->p90 = ticks_to_ns(pf_percentile(0, 0.9));
+      l->p99 = ticks_to_ns(pf_percentile(0, 0.99));
+      l->p999 = ticks_to_ns(pf_percentile(0, 0.999));
+      l->max = ticks_to_ns(pf_max_ticks[0]);
+    }
+#endif
+}
+
+#define CSV_HEADER							\
+  "time,label,workload,unit,procs,servers,rate,ops,reps,warmup,size,pin,cores,opts," \
+  "host,kernel,cpu,cpus,sockets,numa_nodes,platform,ticks_per_ns,"	\
+  "mean,stddev,ci95,min,max,lat_samples,lat_mean_ns,lat_p50_ns,"	\
+  "lat_p90_ns,lat_p99_ns,lat_p999_ns,lat_max_ns,reps_values"
+
+static void
+report(FILE* out, int csv, workload_t* w, const double* vals, summary_t* s, latency_t* l, host_t* h)
+{
+  char when[32];
+  time_t now = time(NULL);
+  strftime(when, sizeof(when), "%Y-%m-%dT%H:%M:%SZ", gmtime(&now));
+  int i;
+
+  if (csv)
+    {
+      fprintf(out, "%s,%s,%s,%s,%d,%d,%.2f,%u,%d,%d,%zu,%d,%s,%d,%s,%s,%s,%ld,%d,%d,%s,%.4f,"
+	      "%.2f,%.2f,%.2f,%.2f,%.2f,%lld,%.1f,%.1f,%.1f,%.1f,%.1f,%.1f,",
+	      when, label, w->name, w->unit, num_procs, num_servers, rate, num_ops, num_reps,
+	      num_warmup, big_size, pin, cores_str ? cores_str : "", init_opts, h->name, h->kernel,
+	      h->cpu, h->cpus, h->sockets, h->numa_nodes, ssmp_platform_name(), ticks_per_ns(),
+	      s->mean, s->stddev, s->ci95, s->min, s->max,
+	      l->samples, l->mean, l->p50, l->p90, l->p99, l->p999, l->max);
+      for (i = 0; i < num_reps; i++)
+	{
+	  fprintf(out, "%s%.2f", i ? ";" : "", vals[i]);
+	}
+      fprintf(out, "\n");
+      return;
+    }
+
+  fprintf(out, "{\"time\": \"%s\", \"label\": \"%s\", \"workload\": \"%s\", \"unit\": \"%s\", "
+	  "\"config\": {\"procs\": %d, \"servers\": %d, \"rate\": %.2f, \"ops\": %u, \"reps\": %d, "
+	  "\"warmup\": %d, \"size\": %zu, \"pin\": %d, \"cores\": \"%s\", \"opts\": %d}, "
+	  "\"host\": {\"name\": \"%s\", \"kernel\": \"%s\", \"cpu\": \"%s\", \"cpus\": %ld, "
+	  "\"sockets\": %d, \"numa_nodes\": %d, \"platform\": \"%s\", \"ticks_per_ns\": %.4f}, "
+	  "\"throughput\": {\"mean\": %.2f, \"stddev\": %.2f, \"ci95\": %.2f, \"min\": %.2f, \"max\": %.2f, "
+	  "\"reps\": [",
+	  when, label, w->name, w->unit, num_procs, num_servers, rate, num_ops, num_reps,
+	  num_warmup, big_size, pin, cores_str ? cores_str : "", init_opts, h->name, h->kernel,
+	  h->cpu, h->cpus, h->sockets, h->numa_nodes, ssmp_platform_name(), ticks_per_ns(),
+	  s->mean, s->stddev, s->ci95, s->min, s->max);
+  for (i = 0; i < num_reps; i++)
+    {
+      fprintf(out, "%s%.2f", i ? ", " : "", vals[i]);
+    }
+  fprintf(out, "]}");
+  if (l->samples)
+    {
+      fprintf(out, ", \"latency_ns\": {\"samples\": %lld, \"mean\": %.1f, \"p50\": %.1f, \"p90\": %.1f, "
+	      "\"p99\": %.1f, \"p999\": %.1f, \"max\": %.1f}",
+	      l->samples, l->mean, l->p50, l->p90, l->p99, l->p999, l->max);
+    }
+  fprintf(out, "}\n");
+}
+
+/* ------------------------------------------------------------------------------- */
+/* main */
+/* ------------------------------------------------------------------------------- */
+
+static uint32_t*
+parse_cores(char* str, int n)
+{
+  uint32_t* c = (uint32_t*) malloc(n * sizeof(uint32_t));
+  assert(c != NULL);
+  char* s = strdup(str);
+  char* save = NULL;
+  char* tok = strtok_r(s, ",", &save);
+  int i;
+  for (i = 0; i < n; i++)
+    {
+      if (tok != NULL)
+	{
+	  c[i] = atoi(tok);
+	  tok = strtok_r(NULL, ",", &save);
+	}
+      else
+	{
+	  c[i] = (i > 0) ? c[i - 1] + 1 : 0;	/* continue after the last given core */
+	}
+    }
+  free(s);
+  return c;
+}
+
+int
+main(int argc, char **argv)
+{
+  struct option long_options[] =
+    {
+      // These options don't set a flag
+      {"help",        no_argument, NULL, 'h'},
+      {"workload",    required_argument, NULL, 'w'},
+      {"num-procs",   required_argument, NULL, 'n'},
+      {"num-ops",     required_argument, NULL, 'm'},
+      {"reps",        required_argument, NULL, 'r'},
+      {"warmup",      required_argument, NULL, 'W'},
+      {"size",        required_argument, NULL, 's'},
+      {"cores",       required_argument, NULL, 'c'},
+      {"no-pin",      no_argument, NULL, 'P'},
+      {"prefault",    no_argument, NULL, 'p'},
+      {"format",      required_argument, NULL, 'f'},
+      {"output",      required_argument, NULL, 'o'},
+      {"label",       required_argument, NULL, 'l'},
+      {"servers",     required_argument, NULL, 'S'},
+      {"rates",       required_argument, NULL, 'R'},
+      {NULL, 0, NULL, 0}
+    };
+
+  workload_t* w = &workloads[0];
+  char* rates_str = NULL;
+  uint32_t k;
+  int i, c;
+  while (1)
+    {
+      i = 0;
+      c = getopt_long(argc, argv, "hw:n:m:r:W:s:c:Ppf:o:l:S:R:", long_options, &i);
+
+      if (c == -1)
+	break;
+
+      if (c == 0 && long_options[i].flag == 0)
+	c = long_options[i].val;
+
+      switch (c)
+	{
+	case 0:
+	  /* Flag is automatically set */
+	  break;
+	case 'h':
+	  printf("bench -- Run a workload and report one JSON / CSV record\n"
+		 "\n"
+		 "Usage:\n"
+		 "  ./bench [options...]\n"
+		 "\n"
+		 "Options:\n"
+		 "  -h, --help\n"
+		 "        Print this message\n"
+		 "  -w, --workload <name>\n"
+		 "        The workload:\n");
+	  for (k = 0; k < NUM_WORKLOADS; k++)
+	    {
+	      printf("          %-14s %s\n", workloads[k].name, workloads[k].desc);
+	    }
+	  printf("  -n, --num-procs <int>\n"
+		 "        Number of processes\n"
+		 "  -m, --num-ops <int>\n"
+		 "        Operations per process and repetition\n"
+		 "  -r, --reps <int>\n"
+		 "        Measured repetitions\n"
+		 "  -W, --warmup <int>\n"
+		 "        Repetitions before measuring\n"
+		 "  -s, --size <int>\n"
+		 "        Bytes per message of the big workload\n"
+		 "  -c, --cores <list>\n"
+		 "        Comma-separated cores of the processes (default 0, 1, ...)\n"
+		 "  -P, --no-pin\n"
+		 "        Do not pin the processes\n"
+		 "  -p, --prefault\n"
+		 "        Prefault and warm up the message memory (SSMP_OPT_[PREFAULT|WARMUP])\n"
+		 "  -f, --format <json|csv>\n"
+		 "        Format of the record\n"
+		 "  -o, --output <file>\n"
+		 "        Append the record to file (default: stdout)\n"
+		 "  -l, --label <string>\n"
+		 "        Free-form label of the record (e.g., the release)\n"
+		 "  -S, --servers <int>\n"
+		 "        Servers of client_server and open_loop (processes 0 .. S-1)\n"
+		 "  -R, --rates <list>\n"
+		 "        Comma-separated offered loads of open_loop (requests/s of all\n"
+		 "        clients), one record per load\n"
+		 );
+	  exit(0);
+	case 'w':
+	  for (k = 0; k < NUM_WORKLOADS && strcmp(optarg, workloads[k].name); k++);
+	  if (k == NUM_WORKLOADS)
+	    {
+	      printf("** unknown workload %s (use -h for the list)\n", optarg);
+	      exit(1);
+	    }
+	  w = &workloads[k];
+	  break;
+	case 'n':
+	  num_procs = atoi(optarg);
+	  break;
+	case 'm':
+	  num_ops = atoi(optarg);
+	  break;
+	case 'r':
+	  num_reps = atoi(optarg);
+	  break;
+	case 'W':
+	  num_warmup = atoi(optarg);
+	  break;
+	case 's':
+	  big_size = atol(optarg);
+	  break;
+	case 'c':
+	  cores_str = optarg;
+	  break;
+	case 'P':
+	  pin = 0;
+	  break;
+	case 'p':
+	  init_opts = SSMP_OPT_PREFAULT | SSMP_OPT_WARMUP;
+	  break;
+	case 'f':
+	  format = optarg;
+	  break;
+	case 'o':
+	  output = optarg;
+	  break;
+	case 'l':
+	  label = optarg;
+	  sanitize(label);
+	  break;
+	case 'S':
+	  num_servers = atoi(optarg);
+	  break;
+	case 'R':
+	  rates_str = optarg;
+	  break;
+	case '?':
+	  printf("Use -h or --help for help\n");
+	  exit(0);
+	default:
+	  exit(1);
+	}
+    }
+
+  if (num_procs < 2 || (w->pairs && num_procs % 2) || num_reps < 1)
+    {
+      printf("** %s needs %s number of processes (>= 2) and at least one repetition\n",
+	     w->name, w->pairs ? "an even" : "a");
+      exit(1);
+    }
+  if (num_servers < 1 || num_servers >= num_procs)
+    {
+      printf("** need at least one server and one client (-S)\n");
+      exit(1);
+    }
+
+  /* the offered loads, one run per load */
+  int num_rates = 0;
+  double* rates = (double*) malloc((rates_str ? strlen(rates_str) / 2 + 1 : 1) * sizeof(double));
+  assert(rates != NULL);
+  if (rates_str != NULL)
+    {
+      char* save = NULL;
+      char* tok;
+      for (tok = strtok_r(rates_str, ",", &save); tok != NULL; tok = strtok_r(NULL, ",", &save))
+	{
+	  rates[num_rates++] = atof(tok);
+	}
+    }
+  if (num_rates == 0 || w->run != run_open_loop)
+    {
+      num_rates = 0;
+      rates[num_rates++] = 0;
+    }
+  if (w->run == run_open_loop && rates[0] <= 0)
+    {
+      printf("** open_loop needs the offered loads (-R)\n");
+      exit(1);
+    }
+  int csv = (strcmp(format, "csv") == 0);
+
+  cores = parse_cores(cores_str ? cores_str : "0", num_procs);
+
+  ID = 0;
+  getticks_correction = getticks_correction_calc();
+  ssmp_init_opt(num_procs, init_opts);
+
+  int rank;
+  for (rank = 1; rank < num_procs; rank++)
+    {
+      pid_t child = fork();
+      if (child < 0)
+	{
+	  P("Failure in fork():\n%s", strerror(errno));
+	}
+      else if (child == 0)
+	{
+	  goto fork_done;
+	}
+    }
+  rank = 0;
+
+ fork_done:
+  ID = rank;
+
+  if (pin)
+    {
+      set_cpu(cores[ID]);
+    }
+
+  ssmp_mem_init(ID, num_procs);
+
+  PF_MSG(0, w->name);
+
+  double val;
+  double* vals = (double*) malloc(num_procs * sizeof(double));
+  double* reps = (double*) malloc(num_reps * sizeof(double));
+  assert(vals != NULL && reps != NULL);
+
+  FILE* out = stdout;
+  int header = csv;
+  if (ID == 0 && output != NULL)
+    {
+      struct stat st;
+      header = csv && (stat(output, &st) != 0 || st.st_size == 0);
+      if ((out = fopen(output, "a")) == NULL)
+	{
+	  perror("fopen");
+	  exit(1);
+	}
+    }
+  if (ID == 0 && header)
+    {
+      fprintf(out, "%s\n", CSV_HEADER);
+    }
+
+  int r, rt;
+  for (rt = 0; rt < num_rates; rt++)
+    {
+      rate = rates[rt];
+      PF_EXCLUDE(0);
+      for (r = 0; r < num_warmup + num_reps; r++)
+	{
+	  ssmp_barrier_wait(0);
+	  val = w->run(num_ops);
+	  ssmp_barrier_wait(0);
+
+	  ssmp_gather(0, &val, vals, sizeof(double));
+	  if (r == num_warmup - 1)
+	    {
+	      PF_EXCLUDE(0);
+	    }
+	  if (ID == 0 && r >= num_warmup)
+	    {
+	      reps[r - num_warmup] = 0;
+	      for (i = 0; i < num_procs; i++)
+		{
+		  reps[r - num_warmup] += vals[i];
+		}
+	    }
+	}
+
+      PF_MERGE;
+
+      if (ID == 0)
+	{
+	  summary_t s = summarize(reps, num_reps);
+	  latency_t l;
+	  host_t h;
+	  latency_info(&l);
+	  host_info(&h);
+
+	  printf("%s: %d processes, %d x %u ops", w->name, num_procs, num_reps, num_ops);
+	  if (rate > 0)
+	    {
+	      printf(", offered %.2f", rate);
+	    }
+	  printf(": %.2f +- %.2f %s (95%% CI)", s.mean, s.ci95, w->unit);
+	  if (l.samples)
+	    {
+	      printf(" | latency p50 %.1f ns, p99 %.1f ns", l.p50, l.p99);
+	    }
+	  printf("\n");
+
+	  report(out, csv, w, reps, &s, &l, &h);
+	  fflush(out);
+	}
+    }
+
+  if (out != stdout)
+    {
+      fclose(out);
+    }
+  free(vals);
+  free(reps);
+  free(rates);
+  ssmp_term();
+  return 0;
+}
@@ -0,0 +1,456 @@
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <inttypes.h>
+#include <unistd.h>
+#include <time.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <assert.h>
+#include <getopt.h>
+
+#include "common.h"
+#include "ssmp.h"
+#include "measurements.h"
+
+/*
+   Cache-coherence latencies (in the style of ccbench): process 0 (and, for the
+   shared / owned states, process 2) brings a cache line in a coherence state,
+   then process 1 loads, stores, CASes, fetch-and-increments or prefetchw's it,
+   timed with fenced getticks. Repeated for every placement of process 1 with
+   respect to process 0 (hyper-thread sibling, same socket, other socket), and
+   printed as one table of median ticks: the costs behind the wait loops and the
+   PREFETCHW / CAS / plain-load choices of the platform files.
+*/
+
+uint32_t ID;
+uint32_t num_procs = 3;
+uint32_t num_reps = 1000;
+int core_a = 0, core_b = -1, core_c = -1;
+
+enum { ST_MODIFIED, ST_OWNED, ST_EXCLUSIVE, ST_SHARED, ST_INVALID, NUM_STATES };
+static const char* state_names[NUM_STATES] =
+  {"M", "O (M + load)", "E", "S", "I (memory)"};
+
+enum { OP_LOAD, OP_STORE, OP_CAS, OP_FAI, OP_PREFETCHW, NUM_OPS };
+static const char* op_names[NUM_OPS] = {"load", "store", "cas", "fai", "prefetchw"};
+
+#if defined(__x86_64__) || defined(__i386__)
+#  define CLFLUSH(x) asm volatile("clflush %0" :: "m" (*(volatile char*) (x)))
+#  define HAVE_CLFLUSH 1
+#else
+#  define CLFLUSH(x)
+#  define HAVE_CLFLUSH 0
+#endif
+
+typedef struct placement
+{
+  const char* name;
+  int b, c;			/* cores of processes 1 and 2 (process 0 on core_a) */
+} placement_t;
+
+static volatile uint64_t* line;
+
+/* the topology entry what (e.g., core_id) of cpu, -1 if unknown */
+static int
+cpu_topology(int cpu, const char* what)
+{
+  char path[128];
+  int v = -1;
+  sprintf(path, "/sys/devices/system/cpu/cpu%d/topology/%s", cpu, what);
+  FILE* f = fopen(path, "r");
+  if (f != NULL)
+    {
+      if (fscanf(f, "%d", &v) != 1)
+	{
+	  v = -1;
+	}
+      fclose(f);
+    }
+  return v;
+}
+
+/* process 1 on the hyper-thread sibling of core_a, another core of its socket, a
+   core of another socket (the ones that exist); process 2 on a core that is none
+   of the two, preferably of the socket of core_a */
+static int
+find_placements(placement_t* pl)
+{
+  int cpus = sysconf(_SC_NPROCESSORS_ONLN), cpu, n = 0, k;
+  int cls[3] = {-1, -1, -1};
+  const char* names[3] = {"smt", "socket", "cross"};
+  int pkg_a = cpu_topology(core_a, "physical_package_id"), core_id_a = cpu_topology(core_a, "core_id");
+  for (cpu = 0; cpu < cpus; cpu++)
+    {
+      int pkg = cpu_topology(cpu, "physical_package_id"), core = cpu_topology(cpu, "core_id");
+      k = (pkg != pkg_a) ? 2 : (core == core_id_a) ? 0 : 1;
+      if (cpu != core_a && cls[k] < 0)
+	{
+	  cls[k] = cpu;
+	}
+    }
+
+  for (k = 0; k < 3; k++)
+    {
+      if (cls[k] < 0)
+	{
+	  continue;
+	}
+      pl[n].name = names[k];
+      pl[n].b = cls[k];
+      pl[n].c = -1;
+      for (cpu = 0; cpu < cpus && pl[n].c < 0; cpu++)
+	{
+	  if (cpu != core_a && cpu != cls[k] && cpu_topology(cpu, "physical_package_id") == pkg_a)
+	    {
+	      pl[n].c = cpu;
+	    }
+	}
+      for (cpu = 0; cpu < cpus && pl[n].c < 0; cpu++)
+	{
+	  if (cpu != core_a && cpu != cls[k])
+	    {
+	      pl[n].c = cpu;
+	    }
+	}
+      n++;
+    }
+  return n;
+}
+
+static int
+state_needs_c(int state)
+{
+  return (state == ST_OWNED || state == ST_SHARED);
+}
+
+static int
+state_supported(int state, int have_c)
+{
+  if (state_needs_c(state) && !have_c)
+    {
+      return 0;
+    }
+  return HAVE_CLFLUSH || (state != ST_EXCLUSIVE && state != ST_INVALID);
+}
+
+/* step 0 by process 0, step 1 by process 2 */
+static void
+set_state(int state, int step, uint32_t r)
+{
+  uint64_t v;
+  switch (state)
+    {
+    case ST_MODIFIED:
+      if (step == 0)
+	{
+	  *line = r;
+	  _mm_mfence();
+	}
+      break;
+    case ST_OWNED:
+      if (step == 0)
+	{
+	  *line = r;
+	  _mm_mfence();
+	}
+      else
+	{
+	  v = *line;
+	}
+      break;
+    case ST_EXCLUSIVE:
+      if (step == 0)
+	{
+	  CLFLUSH(line);
+	  _mm_mfence();
+	  v = *line;
+	}
+      break;
+    case ST_SHARED:
+      if (step == 0)
+	{
+	  CLFLUSH(line);
+	  _mm_mfence();
+	  v = *line;
+	}
+      else
+	{
+	  v = *line;
+	}
+      break;
+    case ST_INVALID:
+      if (step == 0)
+	{
+	  CLFLUSH(line);
+	  _mm_mfence();
+	}
+      break;
+    }
+  (void) v;
+}
+
+static ticks
+measure(int op, ticks correction)
+{
+  volatile uint64_t v;
+  ticks t0 = getticks_fenced();
+  switch (op)
+    {
+    case OP_LOAD:
+      v = *line;
+      break;
+    case OP_STORE:
+      *line = 1;
+      _mm_mfence();
+      break;
+    case OP_CAS:
+      v = __sync_val_compare_and_swap(line, 0, 1);
+      break;
+    case OP_FAI:
+      v = __sync_fetch_and_add(line, 1);
+      break;
+    case OP_PREFETCHW:
+      PREFETCHW(line);
+      break;
+    }
+  ticks t = getticks_fenced() - t0;
+  (void) v;
+  return (t > correction) ? t - correction : 0;
+}
+
+static int
+ticks_cmp(const void* a, const void* b)
+{
+  ticks x = *(const ticks*) a, y = *(const ticks*) b;
+  return (x > y) - (x < y);
+}
+
+int
+main(int argc, char **argv)
+{
+  struct option long_options[] =
+    {
+      // These options don't set a flag
+      {"help",        no_argument, NULL, 'h'},
+      {"reps",        required_argument, NULL, 'r'},
+      {"core-a",      required_argument, NULL, 'x'},
+      {"core-b",      required_argument, NULL, 'y'},
+      {"core-c",      required_argument, NULL, 'z'},
+      {NULL, 0, NULL, 0}
+    };
+
+  int i, c;
+  while (1)
+    {
+      i = 0;
+      c = getopt_long(argc, argv, "hr:x:y:z:", long_options, &i);
+
+      if (c == -1)
+	break;
+
+      if (c == 0 && long_options[i].flag == 0)
+	c = long_options[i].val;
+
+      switch (c)
+	{
+	case 0:
+	  /* Flag is automatically set */
+	  break;
+	case 'h':
+	  PRINT("ccbench -- Latency of accesses to a cache line in each coherence state\n"
+		"\n"
+		"Usage:\n"
+		"  ./ccbench [options...]\n"
+		"\n"
+		"Options:\n"
+		"  -h, --help\n"
+		"        Print this message\n"
+		"  -r, --reps <int>\n"
+		"        Repetitions per state and operation (the median is reported)\n"
+		"  -x, --core-a <int>\n"
+		"        Core of the process that brings the line in the state\n"
+		"  -y, --core-b <int>\n"
+		"        Core of the process that measures (default: the sibling,\n"
+		"        same-socket and other-socket cores of core-a)\n"
+		"  -z, --core-c <int>\n"
+		"        Core of the second process holding the line in the S / O states\n"
+		"        (-1: none)\n"
+		);
+	  exit(0);
+	case 'r':
+	  num_reps = atoi(optarg);
+	  break;
+	case 'x':
+	  core_a = atoi(optarg);
+	  break;
+	case 'y':
+	  core_b = atoi(optarg);
+	  break;
+	case 'z':
+	  core_c = atoi(optarg);
+	  break;
+	case '?':
+	  PRINT("Use -h or --help for help\n");
+	  exit(0);
+	default:
+	  exit(1);
+	}
+    }
+
+  placement_t placements[3];
+  int num_placements = 1;
+  if (core_b >= 0)
+    {
+      placements[0].name = "manual";
+      placements[0].b = core_b;
+      placements[0].c = core_c;
+    }
+  else if ((num_placements = find_placements(placements)) == 0)
+    {
+      PRINT("** no second cpu: give the cores with -y (and -z)\n");
+      exit(1);
+    }
+
+  /* the third process only if every placement has a core for it */
+  int p, have_c = 1;
+  for (p = 0; p < num_placements; p++)
+    {
+      have_c &= (placements[p].c >= 0);
+    }
+  num_procs = have_c ? 3 : 2;
+
+  if (num_reps < 1)
+    {
+      num_reps = 1;
+    }
+  ticks* samples = (ticks*) malloc(num_reps * sizeof(ticks));
+  ticks* medians = (ticks*) calloc(num_placements * NUM_STATES * NUM_OPS, sizeof(ticks));
+  assert(samples != NULL && medians != NULL);
+
+  ID = 0;
+  printf("ccbench: %u repetitions, process 0 on core %d%s\n", num_reps, core_a,
+	 have_c ? "" : ", no third process (no S / O states)");
+  fflush(stdout);
+
+  ticks correction = getticks_correction_calc();
+  ssmp_init(num_procs);
+
+  line = (volatile uint64_t*) mmap(NULL, getpagesize(), PROT_READ | PROT_WRITE,
+				   MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  if (line == MAP_FAILED)
+    {
+      perror("mmap");
+      exit(1);
+    }
+
+  uint32_t rank;
+  for (rank = 1; rank < num_procs; rank++)
+    {
+      pid_t child = fork();
+      if (child < 0) {
+	P("Failure in fork():\n%s", strerror(errno));
+      } else if (child == 0)
+	{
+	  goto fork_done;
+	}
+    }
+  rank = 0;
+
+ fork_done:
+  ID = rank;
+
+  set_cpu((ID == 0) ? core_a : (ID == 1) ? placements[0].b : placements[0].c);
+  ssmp_mem_init(ID, num_procs);
+
+  int state, op;
+  uint32_t r;
+  for (p = 0; p < num_placements; p++)
+    {
+      if (p > 0 && ID > 0)
+	{
+	  set_cpu((ID == 1) ? placements[p].b : placements[p].c);
+	}
+
+      for (state = 0; state < NUM_STATES; state++)
+	{
+	  if (!state_supported(state, have_c))
+	    {
+	      continue;
+	    }
+	  for (op = 0; op < NUM_OPS; op++)
+	    {
+	      for (r = 0; r < num_reps; r++)
+		{
+		  ssmp_barrier_wait(0);
+		  if (ID == 0)
+		    {
+		      set_state(state, 0, r);
+		    }
+		  ssmp_barrier_wait(0);
+		  if (ID == 2)
+		    {
+		      set_state(state, 1, r);
+		    }
+		  ssmp_barrier_wait(0);
+		  if (ID == 1)
+		    {
+		      samples[r] = measure(op, correction);
+		    }
+		}
+
+	      if (ID == 1)
+		{
+		  qsort(samples, num_reps, sizeof(ticks), ticks_cmp);
+		  medians[(p * NUM_STATES + state) * NUM_OPS + op] = samples[num_reps / 2];
+		}
+	    }
+	}
+    }
+
+  /* process 1 prints the table */
+  ssmp_barrier_wait(0);
+  if (ID == 1)
+    {
+      printf("median ticks (%.2f per ns)\n%-14s %-10s", ticks_per_ns(), "state", "op");
+      for (p = 0; p < num_placements; p++)
+	{
+	  char col[32];
+	  snprintf(col, sizeof(col), "%s (%d)", placements[p].name, placements[p].b);
+	  printf(" %14s", col);
+	}
+      printf("\n");
+
+      for (state = 0; state < NUM_STATES; state++)
+	{
+	  if (!state_supported(state, have_c))
+	    {
+	      continue;
+	    }
+	  for (op = 0; op < NUM_OPS; op++)
+	    {
+	      printf("%-14s %-10s", (op == 0) ? state_names[state] : "", op_names[op]);
+	      for (p = 0; p < num_placements; p++)
+		{
+		  printf(" %14llu", (unsigned long long) medians[(p * NUM_STATES + state) * NUM_OPS + op]);
+		}
+	      printf("\n");
+	    }
+	}
+      fflush(stdout);
+    }
+  ssmp_barrier_wait(0);
+
+  free(samples);
+  free(medians);
+  ssmp_term();
+  return 0;
+}
@@ -26,12 +26,12 @@
 #define NO_SYNC_SRV_
 
 uint32_t num_msgs = 5000000;
-uint8_t dsl_seq[256];
-uint8_t num_procs = 2;
-uint8_t ID;
-uint8_t num_dsl = 0;
-uint8_t num_app = 0;
-uint8_t dsl_per_core = 2;
+uint32_t dsl_seq[SSMP_MAX_UES];
+uint32_t num_procs = 2;
+uint32_t ID;
+uint32_t num_dsl = 0;
+uint32_t num_app = 0;
+uint32_t dsl_per_core = 2;
 uint32_t delay_after = 0;
 uint32_t delay_cs = 0;
 
@@ -47,10 +47,10 @@ color_dsl(int id)
   return (id % dsl_per_core == 0);
 }
 
-uint8_t 
-nth_dsl(uint8_t id)
+uint32_t 
+nth_dsl(uint32_t id)
 {
-  uint8_t i, id_seq = 0;
+  uint32_t i, id_seq = 0;
   for (i = 0; i < ssmp_num_ues(); i++)
     {
       if (i == id)
@@ -164,7 +164,7 @@ main(int argc, char **argv)
   PRINT("ONEWAY");
 #endif  /* ROUNDTRIP */
 
-  uint8_t j, dsl_seq_idx = 0;;
+  uint32_t j, dsl_seq_idx = 0;;
   for (j = 0; j < num_procs; j++)
     {
       if (color_dsl(j))
@@ -184,12 +184,13 @@ main(int argc, char **argv)
 
   ssmp_barrier_init(2, 0, color_dsl);
   ssmp_barrier_init(1, 0, color_app1);
-#if defined(XEON)
-  ssmp_barrier_init(0, 0, color_all);
-  ssmp_barrier_init(5, 0, color_all);
-#endif
+  if (strcmp(ssmp_platform_name(), "xeon") == 0)
+    {
+      ssmp_barrier_init(0, 0, color_all);
+      ssmp_barrier_init(5, 0, color_all);
+    }
 
-  uint8_t rank;
+  uint32_t rank;
   for (rank = 1; rank < num_procs; rank++) 
     {
       pid_t child = fork();
@@ -323,8 +324,7 @@ main(int argc, char **argv)
 	  if (!color_dsl(co))
 	    {
  	      ticks t_dur = t_end - t_start - getticks_correction;
-	      double ticks_per_sec = REF_SPEED_GHZ * 1e9;
-	      double dur = t_dur / ticks_per_sec;
+	      double dur = ticks_to_secs(t_dur);
 	      double througput = num_msgs / dur;
 
 #if defined(DEBUG)
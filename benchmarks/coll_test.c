@@ -0,0 +1,616 @@
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/mman.h>
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <inttypes.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <sched.h>
+#include <assert.h>
+#include <getopt.h>
+
+#include "common.h"
+#include "ssmp.h"
+
+/*
+   Checks the collectives, the groups, the tagged messages and the declared
+   peers against known data. The launcher runs two phases, each with its own
+   ssmp_init and processes:
+   - all peers (ssmp_mem_init): big messages, gather / scatter / allgather /
+     alltoall with blocks of one message and of several chunks, group split,
+     group collectives and barriers (odd sizes, with messages in flight across
+     the barriers), ssmp_group_init_color with ssmp_recv_group, and tagged
+     messages received out of tag order, with any source / any tag and probe
+   - declared peers (ssmp_mem_init_peers): every process declares its two
+     neighbours on a ring, and a barrier of the even ids (ssmp_barrier_init_mask)
+   Every process counts its errors and exits with 1 if there is any.
+*/
+
+uint32_t num_procs = 7;
+uint32_t num_reps = 20;
+uint32_t num_tags = 100;	/* more than an allocation block of the unexpected queue */
+uint32_t ID;
+uint32_t errors = 0;
+
+/* one counter per group, shared by the processes: incremented by every member
+   before a barrier, hence at least (round + 1) * members after it */
+volatile uint32_t* arrived;
+
+#define CHECK(cond, args...)			\
+  do {						\
+    if (!(cond))				\
+      {						\
+	if (errors++ < 10)			\
+	  {					\
+	    P(args);				\
+	  }					\
+      }						\
+  } while (0)
+
+/* the byte i of the block that core from sends to core to */
+static inline unsigned char
+pattern(uint32_t from, uint32_t to, size_t i)
+{
+  return (unsigned char) (from * 131 + to * 17 + i * 7 + (i >> 8));
+}
+
+static void
+fill(unsigned char* b, uint32_t from, uint32_t to, size_t length)
+{
+  size_t i;
+  for (i = 0; i < length; i++)
+    {
+      b[i] = pattern(from, to, i);
+    }
+}
+
+static int
+same(unsigned char* b, uint32_t from, uint32_t to, size_t length)
+{
+  size_t i;
+  for (i = 0; i < length; i++)
+    {
+      if (b[i] != pattern(from, to, i))
+	{
+	  return 0;
+	}
+    }
+  return 1;
+}
+
+/* ------------------------------------------------------------------------------- */
+/* big messages and collectives                                                    */
+/* ------------------------------------------------------------------------------- */
+
+/* a chain 0 -> 1 -> .. -> n - 1 -> 0, so that no sender waits for a sending receiver.
+   ssmp_recv_from_big takes whatever is in the chunk buffer of the sender, thus
+   no stream of a collective may still be pending: hence the barrier */
+static void
+check_big(size_t length)
+{
+  unsigned char* b = (unsigned char*) malloc(length);
+  assert(b != NULL);
+  uint32_t to = (ID + 1) % num_procs, from = (ID + num_procs - 1) % num_procs;
+
+  ssmp_barrier_wait(0);
+
+  if (ID != 0)
+    {
+      memset(b, 0, length);
+      ssmp_recv_from_big(from, b, length);
+      CHECK(same(b, from, ID, length), "big %zu bytes from %u: wrong data", length, from);
+    }
+  fill(b, ID, to, length);
+  ssmp_send_big(to, b, length);
+  if (ID == 0)
+    {
+      memset(b, 0, length);
+      ssmp_recv_from_big(from, b, length);
+      CHECK(same(b, from, ID, length), "big %zu bytes from %u: wrong data", length, from);
+    }
+
+  free(b);
+}
+
+static void
+check_collectives(size_t length)
+{
+  uint32_t n = num_procs, b;
+  unsigned char* s = (unsigned char*) malloc(n * length);
+  unsigned char* r = (unsigned char*) malloc(n * length);
+  assert(s != NULL && r != NULL);
+
+  /* gather to the last core */
+  fill(s, ID, n - 1, length);
+  memset(r, 0, n * length);
+  ssmp_gather(n - 1, s, r, length);
+  if (ID == n - 1)
+    {
+      for (b = 0; b < n; b++)
+	{
+	  CHECK(same(r + b * length, b, n - 1, length), "gather %zu: wrong block %u", length, b);
+	}
+    }
+
+  /* scatter from core 1 */
+  uint32_t root = 1 % n;
+  for (b = 0; b < n; b++)
+    {
+      fill(s + b * length, root, b, length);
+    }
+  memset(r, 0, length);
+  ssmp_scatter(root, s, r, length);
+  CHECK(same(r, root, ID, length), "scatter %zu from %u: wrong block", length, root);
+
+  /* allgather */
+  fill(s, ID, n, length);
+  memset(r, 0, n * length);
+  ssmp_allgather(s, r, length);
+  for (b = 0; b < n; b++)
+    {
+      CHECK(same(r + b * length, b, n, length), "allgather %zu: wrong block %u", length, b);
+    }
+
+  /* alltoall */
+  for (b = 0; b < n; b++)
+    {
+      fill(s + b * length, ID, b, length);
+    }
+  memset(r, 0, n * length);
+  ssmp_alltoall(s, r, length);
+  for (b = 0; b < n; b++)
+    {
+      CHECK(same(r + b * length, b, ID, length), "alltoall %zu: wrong block %u", length, b);
+    }
+
+  free(s);
+  free(r);
+}
+
+/* ------------------------------------------------------------------------------- */
+/* groups                                                                          */
+/* ------------------------------------------------------------------------------- */
+
+/* group barriers, with a message to the next member in flight across every barrier */
+static void
+check_group_barrier(ssmp_group_t* g, uint32_t counter)
+{
+  if (g->rank < 0)
+    {
+      return;
+    }
+
+  uint32_t size = g->num_ues, round;
+  uint32_t next = g->members[(g->rank + 1) % size];
+  uint32_t prev = g->members[(g->rank + size - 1) % size];
+  ssmp_msg_t msg;
+
+  for (round = 0; round < num_reps; round++)
+    {
+      if (size > 1)
+	{
+	  msg.w0 = round;
+	  msg.w1 = ID;
+	  ssmp_send(next, &msg);
+	}
+
+      __sync_fetch_and_add(&arrived[counter], 1);
+      ssmp_group_barrier(g);
+      CHECK(arrived[counter] >= (round + 1) * size, "group barrier (%u members): passed in round %u "
+	    "with %u arrivals", size, round, arrived[counter]);
+
+      if (size > 1)
+	{
+	  ssmp_recv_from(prev, &msg);
+	  CHECK(msg.w0 == round && msg.w1 == prev, "group barrier: got (%d, %d) from %u, expected (%u, %u)",
+		msg.w0, msg.w1, prev, round, prev);
+	}
+    }
+}
+
+static void
+check_group_collectives(ssmp_group_t* g)
+{
+  uint32_t size = g->num_ues, r;
+  int32_t* s = (int32_t*) malloc(size * sizeof(int32_t));
+  int32_t* d = (int32_t*) malloc(size * sizeof(int32_t));
+  assert(s != NULL && d != NULL);
+
+  s[0] = ID;
+  ssmp_group_allgather(g, s, d, sizeof(int32_t));
+  for (r = 0; r < size; r++)
+    {
+      CHECK(d[r] == (int32_t) g->members[r], "group allgather: rank %u has %d, expected %u",
+	    r, d[r], g->members[r]);
+    }
+
+  for (r = 0; r < size; r++)
+    {
+      s[r] = ID * 1000 + r;
+    }
+  ssmp_group_alltoall(g, s, d, sizeof(int32_t));
+  for (r = 0; r < size; r++)
+    {
+      CHECK(d[r] == (int32_t) (g->members[r] * 1000 + g->rank), "group alltoall: rank %u has %d", r, d[r]);
+    }
+
+  s[0] = ID;
+  ssmp_group_gather(g, size - 1, s, d, sizeof(int32_t));
+  if (g->rank == size - 1)
+    {
+      for (r = 0; r < size; r++)
+	{
+	  CHECK(d[r] == (int32_t) g->members[r], "group gather: rank %u has %d", r, d[r]);
+	}
+    }
+
+  for (r = 0; r < size; r++)
+    {
+      s[r] = -(int32_t) r;
+    }
+  d[0] = 1;
+  ssmp_group_scatter(g, 0, s, d, sizeof(int32_t));
+  CHECK(d[0] == -(int32_t) g->rank, "group scatter: got %d, expected %d", d[0], -(int32_t) g->rank);
+
+  free(s);
+  free(d);
+}
+
+static int
+color_odd(int id)
+{
+  return (id % 2);
+}
+
+static void
+check_groups()
+{
+  uint32_t n = num_procs, id, r;
+
+  /* three groups, ranked in reverse id order */
+  ssmp_group_t g;
+  ssmp_group_split(ssmp_group_world(), ID % 3, n - ID, &g);
+  uint32_t size = 0;
+  for (id = 0; id < n; id++)
+    {
+      size += (id % 3 == ID % 3);
+    }
+  CHECK(g.num_ues == size, "split: %u members, expected %u", g.num_ues, size);
+  for (r = 0; r < g.num_ues; r++)
+    {
+      uint32_t expected = ID % 3 + 3 * (size - 1 - r);
+      CHECK(g.members[r] == expected, "split: rank %u is core %u, expected %u", r, g.members[r], expected);
+    }
+  CHECK(g.members[g.rank] == ID, "split: own rank %d is core %u", g.rank, g.members[g.rank]);
+
+  check_group_collectives(&g);
+  check_group_barrier(&g, ID % 3);
+
+  /* ids below 3 and the others (ties on the key: parent order) */
+  ssmp_group_t h;
+  ssmp_group_split(ssmp_group_world(), ID < 3, 0, &h);
+  CHECK(h.num_ues == ((ID < 3) ? ((n < 3) ? n : 3) : n - 3), "split: %u members", h.num_ues);
+  CHECK(h.members[0] == ((ID < 3) ? 0 : 3), "split: rank 0 is core %u", h.members[0]);
+  check_group_collectives(&h);
+  check_group_barrier(&h, 3 + (ID < 3));
+
+  /* a split where some cores join no group */
+  ssmp_group_t none;
+  ssmp_group_split(ssmp_group_world(), (ID == 0) ? SSMP_GROUP_NONE : 0, 0, &none);
+  CHECK((ID == 0) ? (none.num_ues == 0 && none.rank < 0) : (none.num_ues == n - 1 && none.rank == ID - 1),
+	"split with SSMP_GROUP_NONE: %u members, rank %d", none.num_ues, none.rank);
+  check_group_barrier(&none, 5);
+  check_group_barrier(ssmp_group_world(), 6);
+
+  /* the odd ids, created locally: every other member sends its id to rank 0 */
+  ssmp_group_t odd;
+  ssmp_group_init_color(&odd, color_odd);
+  if (odd.rank > 0)
+    {
+      ssmp_msg_t msg;
+      msg.w0 = ID;
+      ssmp_send(odd.members[0], &msg);
+    }
+  else if (odd.rank == 0)
+    {
+      uint32_t* seen = (uint32_t*) calloc(n, sizeof(uint32_t));
+      assert(seen != NULL);
+      for (r = 1; r < odd.num_ues; r++)
+	{
+	  ssmp_msg_t msg;
+	  ssmp_recv_group(&odd, &msg);
+	  CHECK(msg.sender == msg.w0 && (msg.w0 % 2) && msg.w0 < n && !seen[msg.w0]++,
+		"recv_group: message %d from %u", msg.w0, msg.sender);
+	}
+      free(seen);
+    }
+  ssmp_barrier_wait(0);
+
+  ssmp_group_free(&g);
+  ssmp_group_free(&h);
+  ssmp_group_free(&none);
+  ssmp_group_free(&odd);
+}
+
+/* ------------------------------------------------------------------------------- */
+/* tagged messages                                                                 */
+/* ------------------------------------------------------------------------------- */
+
+/* every other core sends num_tags messages with tags 0, 1, .. to core 0. Core 0
+   first waits for the last tag of every sender, which queues all the others */
+static void
+check_tags()
+{
+  uint32_t n = num_procs, k, t;
+  ssmp_msg_t msg;
+
+  if (ID != 0)
+    {
+      for (t = 0; t < num_tags; t++)
+	{
+	  msg.w0 = ID;
+	  msg.w1 = t;
+	  ssmp_send_tag(0, &msg, t);
+	}
+      ssmp_barrier_wait(0);
+      return;
+    }
+
+  while (!ssmp_probe(SSMP_ANY_SOURCE, SSMP_ANY_TAG, &msg))
+    {
+      PAUSE;
+    }
+  CHECK(msg.tag == 0 && msg.w1 == 0, "probe: tag %u, expected 0", msg.tag);
+
+  for (k = 1; k < n; k++)
+    {
+      ssmp_recv_tag(k, num_tags - 1, &msg);
+      CHECK(msg.sender == k && msg.tag == num_tags - 1 && msg.w0 == k && msg.w1 == num_tags - 1,
+	    "recv_tag(%u, %u): from %u, tag %u, data (%d, %d)", k, num_tags - 1, msg.sender, msg.tag, msg.w0, msg.w1);
+    }
+
+  /* tag 0 from any source: every sender once */
+  uint32_t* seen = (uint32_t*) calloc(n, sizeof(uint32_t));
+  assert(seen != NULL);
+  for (k = 1; k < n; k++)
+    {
+      ssmp_recv_tag(SSMP_ANY_SOURCE, 0, &msg);
+      CHECK(msg.tag == 0 && msg.w1 == 0 && msg.sender == msg.w0 && msg.sender < n && !seen[msg.sender]++,
+	    "recv_tag(any, 0): from %u, tag %u", msg.sender, msg.tag);
+    }
+  free(seen);
+
+  /* a tag in the middle, from the last sender */
+  if (n > 1 && num_tags > 2)
+    {
+      CHECK(ssmp_probe(n - 1, num_tags / 2, &msg) && msg.w1 == num_tags / 2,
+	    "probe(%u, %u): not found", n - 1, num_tags / 2);
+      ssmp_recv_tag(n - 1, num_tags / 2, &msg);
+      CHECK(msg.sender == n - 1 && msg.w1 == num_tags / 2, "recv_tag(%u, %u): from %u, tag %u",
+	    n - 1, num_tags / 2, msg.sender, msg.tag);
+    }
+
+  /* the rest of every sender, with any tag: in send order */
+  for (k = 1; k < n; k++)
+    {
+      for (t = 1; t < num_tags - 1; t++)
+	{
+	  if (k == n - 1 && t == num_tags / 2)
+	    {
+	      continue;
+	    }
+	  ssmp_recv_tag(k, SSMP_ANY_TAG, &msg);
+	  CHECK(msg.sender == k && msg.tag == t && msg.w1 == t, "recv_tag(%u, any): tag %u, expected %u",
+		k, msg.tag, t);
+	}
+    }
+
+  CHECK(!ssmp_probe(SSMP_ANY_SOURCE, SSMP_ANY_TAG, &msg), "probe: message from %u, tag %u left",
+	msg.sender, msg.tag);
+  ssmp_barrier_wait(0);
+}
+
+/* ------------------------------------------------------------------------------- */
+/* declared peers                                                                  */
+/* ------------------------------------------------------------------------------- */
+
+static void
+check_peers()
+{
+  uint32_t n = num_procs;
+  uint32_t right = (ID + 1) % n, left = (ID + n - 1) % n;
+  ssmp_msg_t msg;
+
+  /* to the right, then to the left */
+  msg.w0 = ID;
+  msg.w1 = 1;
+  ssmp_send(right, &msg);
+  ssmp_recv_from(left, &msg);
+  CHECK(msg.w0 == left && msg.w1 == 1, "peers: got (%d, %d) from %u", msg.w0, msg.w1, left);
+
+  msg.w0 = ID;
+  msg.w1 = 2;
+  ssmp_send(left, &msg);
+  ssmp_recv_from(right, &msg);
+  CHECK(msg.w0 == right && msg.w1 == 2, "peers: got (%d, %d) from %u", msg.w0, msg.w1, right);
+
+  /* a barrier of the even ids */
+  uint64_t mask[(SSMP_MAX_UES + 63) / 64];
+  uint32_t id, evens = 0;
+  memset(mask, 0, sizeof(mask));
+  for (id = 0; id < n; id += 2)
+    {
+      mask[id / 64] |= 1ULL << (id % 64);
+      evens++;
+    }
+  ssmp_barrier_init_mask(1, mask);
+  ssmp_barrier_wait(0);
+
+  if (ID % 2 == 0)
+    {
+      uint32_t round;
+      for (round = 0; round < num_reps; round++)
+	{
+	  __sync_fetch_and_add(&arrived[0], 1);
+	  ssmp_barrier_wait(1);
+	  CHECK(arrived[0] >= (round + 1) * evens, "mask barrier: passed in round %u with %u arrivals",
+		round, arrived[0]);
+	}
+    }
+  ssmp_barrier_wait(0);
+}
+
+/* ------------------------------------------------------------------------------- */
+/* launcher                                                                        */
+/* ------------------------------------------------------------------------------- */
+
+/* one phase: its own ssmp_init and processes; returns the processes that failed */
+static uint32_t
+run_phase(int peers)
+{
+  fflush(stdout);		/* not to be printed again by the children */
+  ssmp_init(num_procs);
+  arrived = (volatile uint32_t*) mmap(NULL, SSMP_CACHE_LINE_SIZE, PROT_READ | PROT_WRITE,
+				      MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  assert(arrived != MAP_FAILED);
+
+  uint32_t rank;
+  for (rank = 1; rank < num_procs; rank++)
+    {
+      pid_t child = fork();
+      if (child < 0)
+	{
+	  P("Failure in fork():\n%s", strerror(errno));
+	}
+      else if (child == 0)
+	{
+	  goto fork_done;
+	}
+    }
+  rank = 0;
+
+ fork_done:
+  ID = rank;
+  errors = 0;
+
+  if (peers)
+    {
+      uint32_t ring[2] = { (ID + 1) % num_procs, (ID + num_procs - 1) % num_procs };
+      ssmp_mem_init_peers(ID, num_procs, ring, (ring[0] == ring[1]) ? 1 : 2);
+      ssmp_barrier_wait(0);
+      check_peers();
+    }
+  else
+    {
+      ssmp_mem_init(ID, num_procs);
+      ssmp_barrier_wait(0);
+      size_t sizes[] = { 1, SSMP_MSG_PAYLOAD, SSMP_MSG_PAYLOAD + 1, 2 * SSMP_CHUNK_DATA + 17 };
+      uint32_t s;
+      for (s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++)
+	{
+	  check_big(sizes[s] + SSMP_MSG_PAYLOAD);
+	  check_collectives(sizes[s]);
+	}
+      check_groups();
+      check_tags();
+    }
+
+  ssmp_term();
+  if (rank != 0)
+    {
+      exit(errors != 0);
+    }
+
+  uint32_t failed = (errors != 0);
+  int status;
+  while (wait(&status) > 0)
+    {
+      failed += !WIFEXITED(status) || WEXITSTATUS(status) != 0;
+    }
+  munmap((void*) arrived, SSMP_CACHE_LINE_SIZE);
+  return failed;
+}
+
+int
+main(int argc, char **argv)
+{
+  struct option long_options[] =
+    {
+      // These options don't set a flag
+      {"help",        no_argument, NULL, 'h'},
+      {"num-procs",   required_argument, NULL, 'n'},
+      {"num-reps",    required_argument, NULL, 'r'},
+      {"num-tags",    required_argument, NULL, 't'},
+      {NULL, 0, NULL, 0}
+    };
+
+  int i, c;
+  while (1)
+    {
+      i = 0;
+      c = getopt_long(argc, argv, "hn:r:t:", long_options, &i);
+
+      if (c == -1)
+	break;
+
+      if (c == 0 && long_options[i].flag == 0)
+	c = long_options[i].val;
+
+      switch (c)
+	{
+	case 0:
+	  /* Flag is automatically set */
+	  break;
+	case 'h':
+	  PRINT("coll_test -- Checking the collectives, groups, tagged messages and declared peers\n"
+		"\n"
+		"Usage:\n"
+		"  ./coll_test [options...]\n"
+		"\n"
+		"Options:\n"
+		"  -h, --help\n"
+		"        Print this message\n"
+		"  -n, --num-procs <int>\n"
+		"        Number of processes (at least 2; odd sizes give odd groups)\n"
+		"  -r, --num-reps <int>\n"
+		"        Number of crossings of every barrier\n"
+		"  -t, --num-tags <int>\n"
+		"        Number of tagged messages from every process to process 0\n"
+		);
+	  exit(0);
+	case 'n':
+	  num_procs = atoi(optarg);
+	  break;
+	case 'r':
+	  num_reps = atoi(optarg);
+	  break;
+	case 't':
+	  num_tags = atoi(optarg);
+	  break;
+	case '?':
+	  PRINT("Use -h or --help for help\n");
+	  exit(0);
+	default:
+	  exit(1);
+	}
+    }
+
+  if (num_procs < 2 || num_tags < 2)
+    {
+      PRINT("coll_test needs at least 2 processes and 2 tags");
+      exit(1);
+    }
+
+  uint32_t failed = run_phase(0);
+  printf("all peers     : %s (%u of %u processes failed)\n", failed ? "FAILED" : "ok", failed, num_procs);
+  uint32_t failed_peers = run_phase(1);
+  printf("declared peers: %s (%u of %u processes failed)\n", failed_peers ? "FAILED" : "ok",
+	 failed_peers, num_procs);
+
+  return (failed + failed_peers) != 0;
+}
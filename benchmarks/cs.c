@@ -25,7 +25,7 @@
 int num_procs = 2;
 long long int num_msgs = 10000;
 ticks getticks_correction;
-uint8_t ID;
+uint32_t ID;
 uint32_t wait_cycles_after = 0;
 int core = 0;
 int core_offs = 0;
@@ -214,7 +214,7 @@ main(int argc, char **argv)
 	  PF_PRINT;
 	  if (total_sum_ticks[0] > 0)
 	    {
-	      double secs = total_sum_ticks[0] / (REF_SPEED_GHZ * 1.e9);
+	      double secs = ticks_to_secs(total_sum_ticks[0]);
 	      printf("[%02d] Throughput (core): %.1f", ID, num_msgs/secs);
 	      printf(" CS/s\n");
 	    }
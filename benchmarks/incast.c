@@ -0,0 +1,340 @@
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <inttypes.h>
+#include <unistd.h>
+#include <time.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <assert.h>
+#include <getopt.h>
+
+#include "common.h"
+#include "ssmp.h"
+
+/*
+   Incast: processes 1 .. K send to process 0 as fast as they can, for a fixed
+   time window, while process 0 receives with ssmp_recv, ssmp_recv_color
+   (scans from the first sender every time) or ssmp_recv_color_start (scans from
+   the sender after the last one served). For every K (swept from 1 to
+   num_procs - 1) and receive function, reports the total throughput, the
+   cycles the receiver spends per message, and how fair it is to the senders
+   (Jain's index and the smallest / largest share, relative to an equal share).
+*/
+
+uint32_t num_procs = 4;
+uint32_t num_senders = 1;
+double window = 0.2;
+int k_fixed = 0;
+int verbose = 0;
+int pin = 1;
+uint32_t ID;
+
+enum { RECV_ANY, RECV_COLOR, RECV_COLOR_START, NUM_MODES };
+static const char* mode_names[NUM_MODES] = {"recv", "color", "color_start"};
+
+/* the control block, shared by the processes (forked after it is mapped) */
+typedef struct ALIGNED(SSMP_CACHE_LINE_SIZE) incast_line
+{
+  volatile uint64_t v;
+  uint8_t pad[SSMP_CACHE_LINE_SIZE - sizeof(uint64_t)];
+} incast_line_t;
+
+typedef struct incast_ctl
+{
+  incast_line_t stop;
+  incast_line_t done;
+  incast_line_t sent[SSMP_MAX_UES];
+} incast_ctl_t;
+
+static incast_ctl_t* ctl;
+
+int
+color_sender(int id)
+{
+  return (id != 0 && id <= num_senders);
+}
+
+/* flood process 0 until it raises stop, then publish the number of messages sent */
+static void
+sender(ssmp_msg_t* msg)
+{
+  uint64_t sent = 0;
+  while (!ctl->stop.v)
+    {
+      if (ssmp_send_is_free(0))
+	{
+	  msg->w0 = sent++;
+	  ssmp_send(0, msg);
+	}
+    }
+  ctl->sent[ID].v = sent;
+  __sync_fetch_and_add(&ctl->done.v, 1);
+}
+
+static inline void
+receive(int mode, ssmp_color_buf_t* cbuf, ssmp_msg_t* msg)
+{
+  switch (mode)
+    {
+    case RECV_ANY:
+      ssmp_recv(msg);
+      break;
+    case RECV_COLOR:
+      ssmp_recv_color(cbuf, msg);
+      break;
+    default:
+      ssmp_recv_color_start(cbuf, msg);
+      break;
+    }
+}
+
+/* receive for window seconds; then stop the senders and drain their last messages */
+static void
+receiver(int mode, ssmp_msg_t* msg, uint64_t* recvd)
+{
+  ssmp_color_buf_t cbuf;
+  if (mode != RECV_ANY)
+    {
+      ssmp_color_buf_init(&cbuf, color_sender);
+    }
+
+  uint32_t s;
+  uint64_t total = 0;
+  ticks duration = (ticks) (window * 1e9 * ticks_per_ns());
+  memset(recvd, 0, num_procs * sizeof(uint64_t));
+
+  ticks t0 = getticks_fenced(), t1 = t0;
+  while (t1 - t0 < duration)
+    {
+      receive(mode, &cbuf, msg);
+      recvd[msg->sender]++;
+      if ((++total & 63) == 0)
+	{
+	  t1 = getticks();
+	}
+    }
+  t1 = getticks_fenced();
+
+  ctl->stop.v = 1;
+  while (ctl->done.v < num_senders)
+    {
+      PAUSE;
+    }
+  uint64_t drained = 0;
+  for (s = 1; s <= num_senders; s++)
+    {
+      for (drained = recvd[s]; drained < ctl->sent[s].v; drained++)
+	{
+	  ssmp_recv_from(s, msg);
+	}
+    }
+
+  double secs = ticks_to_secs(t1 - t0);
+  double fair = (double) total / num_senders;
+  double sum2 = 0, min = 1e300, max = 0;
+  for (s = 1; s <= num_senders; s++)
+    {
+      double share = recvd[s] / fair;
+      sum2 += (double) recvd[s] * recvd[s];
+      min = (share < min) ? share : min;
+      max = (share > max) ? share : max;
+    }
+  double jain = (sum2 > 0) ? ((double) total * total) / (num_senders * sum2) : 0;
+
+  printf("%-12s %4u %14.0f %12.1f %8.4f %9.3f %9.3f\n", mode_names[mode], num_senders,
+	 total / secs, (double) (t1 - t0) / total, jain, min, max);
+  if (verbose)
+    {
+      for (s = 1; s <= num_senders; s++)
+	{
+	  printf("    sender %-4u %12llu msgs  share %.3f\n", s, (unsigned long long) recvd[s],
+		 recvd[s] / fair);
+	}
+    }
+  fflush(stdout);
+
+  if (mode != RECV_ANY)
+    {
+      ssmp_color_buf_free(&cbuf);
+    }
+}
+
+int
+main(int argc, char **argv)
+{
+  struct option long_options[] =
+    {
+      // These options don't set a flag
+      {"help",        no_argument, NULL, 'h'},
+      {"num-procs",   required_argument, NULL, 'n'},
+      {"senders",     required_argument, NULL, 'k'},
+      {"window",      required_argument, NULL, 'd'},
+      {"recv",        required_argument, NULL, 'r'},
+      {"verbose",     no_argument, NULL, 'v'},
+      {"no-pin",      no_argument, NULL, 'P'},
+      {NULL, 0, NULL, 0}
+    };
+
+  int modes[NUM_MODES] = {1, 1, 1};
+  int i, c;
+  while (1)
+    {
+      i = 0;
+      c = getopt_long(argc, argv, "hn:k:d:r:vP", long_options, &i);
+
+      if (c == -1)
+	break;
+
+      if (c == 0 && long_options[i].flag == 0)
+	c = long_options[i].val;
+
+      switch (c)
+	{
+	case 0:
+	  /* Flag is automatically set */
+	  break;
+	case 'h':
+	  PRINT("incast -- Testing many senders flooding one receiver\n"
+		"\n"
+		"Usage:\n"
+		"  ./incast [options...]\n"
+		"\n"
+		"Options:\n"
+		"  -h, --help\n"
+		"        Print this message\n"
+		"  -n, --num-procs <int>\n"
+		"        Number of processes (the receiver and up to num_procs - 1 senders)\n"
+		"  -k, --senders <int>\n"
+		"        Only this number of senders (default: 1 .. num_procs - 1)\n"
+		"  -d, --window <double>\n"
+		"        Seconds of receiving per measurement\n"
+		"  -r, --recv <recv|color|color_start>\n"
+		"        Only this receive function (default: all)\n"
+		"  -v, --verbose\n"
+		"        Print the messages of every sender\n"
+		"  -P, --no-pin\n"
+		"        Do not pin the processes\n"
+		);
+	  exit(0);
+	case 'n':
+	  num_procs = atoi(optarg);
+	  break;
+	case 'k':
+	  k_fixed = atoi(optarg);
+	  break;
+	case 'd':
+	  window = atof(optarg);
+	  break;
+	case 'r':
+	  for (i = 0; i < NUM_MODES; i++)
+	    {
+	      modes[i] = (strcmp(optarg, mode_names[i]) == 0);
+	    }
+	  break;
+	case 'v':
+	  verbose = 1;
+	  break;
+	case 'P':
+	  pin = 0;
+	  break;
+	case '?':
+	  PRINT("Use -h or --help for help\n");
+	  exit(0);
+	default:
+	  exit(1);
+	}
+    }
+
+  if (num_procs < 2 || k_fixed >= (int) num_procs)
+    {
+      PRINT("** need at least 2 processes and fewer senders than processes\n");
+      exit(1);
+    }
+
+  ID = 0;
+  printf("processes: %-10d / window: %.3f s%s\n", num_procs, window, pin ? "" : " / not pinned");
+  printf("%-12s %4s %14s %12s %8s %9s %9s\n", "recv", "K", "msgs/s", "cycles/msg",
+	 "jain", "min share", "max share");
+  fflush(stdout);
+
+  ssmp_init(num_procs);
+
+  ctl = (incast_ctl_t*) mmap(NULL, sizeof(incast_ctl_t), PROT_READ | PROT_WRITE,
+			     MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  if (ctl == MAP_FAILED)
+    {
+      perror("mmap");
+      exit(1);
+    }
+
+  uint32_t rank;
+  for (rank = 1; rank < num_procs; rank++)
+    {
+      pid_t child = fork();
+      if (child < 0) {
+	P("Failure in fork():\n%s", strerror(errno));
+      } else if (child == 0)
+	{
+	  goto fork_done;
+	}
+    }
+  rank = 0;
+
+ fork_done:
+  ID = rank;
+
+  if (pin)
+    {
+      set_cpu(id_to_core[ID]);
+    }
+  ssmp_mem_init(ID, num_procs);
+
+  ssmp_msg_t *msg;
+  msg = (ssmp_msg_t *) memalign(SSMP_CACHE_LINE_SIZE, sizeof(ssmp_msg_t));
+  uint64_t* recvd = (uint64_t*) malloc(num_procs * sizeof(uint64_t));
+  assert(msg != NULL && recvd != NULL);
+
+  int mode;
+  for (mode = 0; mode < NUM_MODES; mode++)
+    {
+      if (!modes[mode])
+	{
+	  continue;
+	}
+      uint32_t k_start = k_fixed ? k_fixed : 1, k_end = k_fixed ? k_fixed : num_procs - 1;
+      for (num_senders = k_start; num_senders <= k_end; num_senders++)
+	{
+	  if (ID == 0)
+	    {
+	      ctl->stop.v = 0;
+	      ctl->done.v = 0;
+	    }
+	  ssmp_barrier_wait(0);
+
+	  if (ID == 0)
+	    {
+	      receiver(mode, msg, recvd);
+	    }
+	  else if (ID <= num_senders)
+	    {
+	      sender(msg);
+	    }
+
+	  ssmp_barrier_wait(0);
+	}
+    }
+
+  free(recvd);
+  free(msg);
+  ssmp_term();
+  return 0;
+}
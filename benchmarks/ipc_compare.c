@@ -0,0 +1,972 @@
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <inttypes.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <assert.h>
+#include <getopt.h>
+#include <math.h>
+#include <mqueue.h>
+#if defined(__linux__)
+#  include <sys/eventfd.h>
+#  include <sys/syscall.h>
+#  include <linux/futex.h>
+#endif
+
+#include "common.h"
+#include "ssmp.h"
+
+#include "measurements.h"
+
+/*
+   Runs the one2one (one-way and roundtrip) and client_server patterns over ssmp
+   and over the standard IPC mechanisms of Linux, with the same processes and
+   pinning, and prints the throughput and the latency percentiles of every
+   transport side by side. All transports carry cache-line-sized messages and,
+   except ssmp, block the receiver in the kernel when there is nothing to receive.
+*/
+
+uint32_t ID;
+ticks getticks_correction;
+
+int num_procs = 2;
+uint32_t num_ops = 100000;
+int num_reps = 3;
+int pin = 1;
+uint32_t* cores = NULL;
+int csv = 0;
+
+typedef struct ipc_msg
+{
+  uint32_t sender;
+  uint32_t seq;
+  char payload[SSMP_CACHE_LINE_SIZE - 2 * sizeof(uint32_t)];
+} ipc_msg_t;
+
+/* ------------------------------------------------------------------------------- */
+/* transports: created by init before the fork; send and recv / recv_from block
+   until the message is out / in */
+/* ------------------------------------------------------------------------------- */
+
+typedef struct transport
+{
+  const char* name;
+  void (*init)(void);
+  void (*send)(uint32_t to, ipc_msg_t* msg);
+  void (*recv)(ipc_msg_t* msg);
+  void (*recv_from)(uint32_t from, ipc_msg_t* msg);
+  const char* desc;
+} transport_t;
+
+/* --- ssmp --- */
+
+static void
+ssmp_tr_init()
+{
+}
+
+static void
+ssmp_tr_send(uint32_t to, ipc_msg_t* msg)
+{
+  ssmp_msg_t m;
+  m.w0 = msg->seq;
+  ssmp_send(to, &m);
+}
+
+static void
+ssmp_tr_recv(ipc_msg_t* msg)
+{
+  ssmp_msg_t m;
+  ssmp_recv(&m);
+  msg->sender = m.sender;
+  msg->seq = m.w0;
+}
+
+static void
+ssmp_tr_recv_from(uint32_t from, ipc_msg_t* msg)
+{
+  ssmp_msg_t m;
+  ssmp_recv_from(from, &m);
+  msg->sender = from;
+  msg->seq = m.w0;
+}
+
+/* --- pipes and AF_UNIX datagram sockets: one per receiver, shared by the senders --- */
+
+static int (*fds)[2];
+
+static void
+write_full(int fd, ipc_msg_t* msg)
+{
+  size_t done = 0;
+  while (done < sizeof(ipc_msg_t))
+    {
+      ssize_t n = write(fd, (char*) msg + done, sizeof(ipc_msg_t) - done);
+      if (n < 0 && errno != EINTR)
+	{
+	  perror("write");
+	  exit(1);
+	}
+      done += (n > 0) ? n : 0;
+    }
+}
+
+static void
+read_full(int fd, ipc_msg_t* msg)
+{
+  size_t done = 0;
+  while (done < sizeof(ipc_msg_t))
+    {
+      ssize_t n = read(fd, (char*) msg + done, sizeof(ipc_msg_t) - done);
+      if (n < 0 && errno != EINTR)
+	{
+	  perror("read");
+	  exit(1);
+	}
+      done += (n > 0) ? n : 0;
+    }
+}
+
+static void
+pipe_init()
+{
+  int i;
+  fds = malloc(num_procs * sizeof(int[2]));
+  assert(fds != NULL);
+  for (i = 0; i < num_procs; i++)
+    {
+      if (pipe(fds[i]) < 0)
+	{
+	  perror("pipe");
+	  exit(1);
+	}
+    }
+}
+
+static void
+unix_init()
+{
+  int i;
+  fds = malloc(num_procs * sizeof(int[2]));
+  assert(fds != NULL);
+  for (i = 0; i < num_procs; i++)
+    {
+      if (socketpair(AF_UNIX, SOCK_DGRAM, 0, fds[i]) < 0)
+	{
+	  perror("socketpair");
+	  exit(1);
+	}
+    }
+}
+
+/* messages of at most PIPE_BUF bytes are written and read atomically, so that the
+   senders of a pipe do not interleave */
+static void
+fd_send(uint32_t to, ipc_msg_t* msg)
+{
+  msg->sender = ID;
+  write_full(fds[to][1], msg);
+}
+
+static void
+fd_recv(ipc_msg_t* msg)
+{
+  read_full(fds[ID][0], msg);
+}
+
+static void
+fd_recv_from(uint32_t from, ipc_msg_t* msg)
+{
+  read_full(fds[ID][0], msg);
+  assert(msg->sender == from);
+}
+
+/* --- POSIX message queues: one per receiver --- */
+
+static mqd_t* mqs;
+
+static void
+mq_init()
+{
+  struct mq_attr attr;
+  char name[64];
+  int i;
+  memset(&attr, 0, sizeof(attr));
+  attr.mq_maxmsg = 8;
+  attr.mq_msgsize = sizeof(ipc_msg_t);
+
+  mqs = malloc(num_procs * sizeof(mqd_t));
+  assert(mqs != NULL);
+  for (i = 0; i < num_procs; i++)
+    {
+      sprintf(name, "/ssmp_ipc%d_%d", getpid(), i);
+      mqs[i] = mq_open(name, O_CREAT | O_EXCL | O_RDWR, 0600, &attr);
+      if (mqs[i] == (mqd_t) -1)
+	{
+	  perror("mq_open");
+	  exit(1);
+	}
+      mq_unlink(name);		/* the forked processes inherit the descriptors */
+    }
+}
+
+static void
+mq_tr_send(uint32_t to, ipc_msg_t* msg)
+{
+  msg->sender = ID;
+  while (mq_send(mqs[to], (char*) msg, sizeof(ipc_msg_t), 0) < 0)
+    {
+      if (errno != EINTR)
+	{
+	  perror("mq_send");
+	  exit(1);
+	}
+    }
+}
+
+static void
+mq_tr_recv(ipc_msg_t* msg)
+{
+  while (mq_receive(mqs[ID], (char*) msg, sizeof(ipc_msg_t), NULL) < 0)
+    {
+      if (errno != EINTR)
+	{
+	  perror("mq_receive");
+	  exit(1);
+	}
+    }
+}
+
+static void
+mq_tr_recv_from(uint32_t from, ipc_msg_t* msg)
+{
+  mq_tr_recv(msg);
+  assert(msg->sender == from);
+}
+
+#if defined(__linux__)
+
+/* --- eventfd + shm and futex + shm: a ring per pair in shared memory, and a
+   per-receiver eventfd (semaphore mode, one count per message) or futex word to
+   sleep on --- */
+
+#  define RING_SLOTS 64
+
+typedef struct ALIGNED(SSMP_CACHE_LINE_SIZE) ring_idx
+{
+  volatile uint64_t v;
+  uint8_t pad[SSMP_CACHE_LINE_SIZE - sizeof(uint64_t)];
+} ring_idx_t;
+
+typedef struct ring
+{
+  ring_idx_t head;		/* written by the sender */
+  ring_idx_t tail;		/* written by the receiver */
+  ipc_msg_t slot[RING_SLOTS];
+} ring_t;
+
+typedef struct ALIGNED(SSMP_CACHE_LINE_SIZE) futex_word
+{
+  volatile int32_t seq;
+  volatile int32_t waiting;
+  uint8_t pad[SSMP_CACHE_LINE_SIZE - 2 * sizeof(int32_t)];
+} futex_word_t;
+
+static ring_t* rings;
+static int* efds;
+static futex_word_t* futexes;
+static uint32_t ring_next = 0;	/* where recv starts scanning */
+
+static inline ring_t*
+ring_of(uint32_t from, uint32_t to)
+{
+  return &rings[from * num_procs + to];
+}
+
+static void*
+shm_alloc(size_t size)
+{
+  void* mem = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  if (mem == MAP_FAILED)
+    {
+      perror("mmap");
+      exit(1);
+    }
+  return mem;
+}
+
+static void
+ring_init()
+{
+  rings = (ring_t*) shm_alloc(num_procs * num_procs * sizeof(ring_t));
+}
+
+static void
+ring_push(ring_t* r, ipc_msg_t* msg)
+{
+  uint64_t head = r->head.v;
+  while (head - r->tail.v == RING_SLOTS)
+    {
+      sched_yield();
+    }
+  msg->sender = ID;
+  memcpy(&r->slot[head % RING_SLOTS], msg, sizeof(ipc_msg_t));
+  _mm_sfence();
+  r->head.v = head + 1;
+}
+
+static int
+ring_pop(ring_t* r, ipc_msg_t* msg)
+{
+  uint64_t tail = r->tail.v;
+  if (r->head.v == tail)
+    {
+      return 0;
+    }
+  memcpy(msg, &r->slot[tail % RING_SLOTS], sizeof(ipc_msg_t));
+  _mm_mfence();
+  r->tail.v = tail + 1;
+  return 1;
+}
+
+/* round robin over the senders, as ssmp_recv */
+static int
+ring_pop_any(ipc_msg_t* msg)
+{
+  uint32_t i;
+  for (i = 0; i < num_procs; i++)
+    {
+      uint32_t from = ring_next;
+      ring_next = (ring_next + 1) % num_procs;
+      if (from != ID && ring_pop(ring_of(from, ID), msg))
+	{
+	  return 1;
+	}
+    }
+  return 0;
+}
+
+static void
+eventfd_init()
+{
+  int i;
+  ring_init();
+  efds = malloc(num_procs * sizeof(int));
+  assert(efds != NULL);
+  for (i = 0; i < num_procs; i++)
+    {
+      if ((efds[i] = eventfd(0, EFD_SEMAPHORE)) < 0)
+	{
+	  perror("eventfd");
+	  exit(1);
+	}
+    }
+}
+
+static void
+eventfd_send(uint32_t to, ipc_msg_t* msg)
+{
+  uint64_t one = 1;
+  ring_push(ring_of(ID, to), msg);
+  if (write(efds[to], &one, sizeof(one)) != sizeof(one))
+    {
+      perror("write eventfd");
+      exit(1);
+    }
+}
+
+static void
+eventfd_wait()
+{
+  uint64_t count;
+  while (read(efds[ID], &count, sizeof(count)) != sizeof(count))
+    {
+      if (errno != EINTR)
+	{
+	  perror("read eventfd");
+	  exit(1);
+	}
+    }
+}
+
+/* every message has one count: the count taken may belong to another message
+   that is already in its ring, which then finds a count left for it */
+static void
+eventfd_recv(ipc_msg_t* msg)
+{
+  eventfd_wait();
+  while (!ring_pop_any(msg))
+    {
+      PAUSE;
+    }
+}
+
+static void
+eventfd_recv_from(uint32_t from, ipc_msg_t* msg)
+{
+  eventfd_wait();
+  while (!ring_pop(ring_of(from, ID), msg))
+    {
+      PAUSE;
+    }
+}
+
+static void
+futex_init()
+{
+  ring_init();
+  futexes = (futex_word_t*) shm_alloc(num_procs * sizeof(futex_word_t));
+}
+
+static void
+futex_send(uint32_t to, ipc_msg_t* msg)
+{
+  futex_word_t* f = &futexes[to];
+  ring_push(ring_of(ID, to), msg);
+  __sync_fetch_and_add(&f->seq, 1);
+  if (f->waiting)
+    {
+      syscall(SYS_futex, &f->seq, FUTEX_WAKE, 1, NULL, NULL, 0);
+    }
+}
+
+/* sleep until a sender bumps the sequence after seq was read: a message pushed
+   before the increment is seen by the pop that follows the read */
+static void
+futex_recv_(int32_t from, ipc_msg_t* msg)
+{
+  futex_word_t* f = &futexes[ID];
+  while (1)
+    {
+      int32_t seq = f->seq;
+      if ((from < 0) ? ring_pop_any(msg) : ring_pop(ring_of(from, ID), msg))
+	{
+	  return;
+	}
+      f->waiting = 1;
+      _mm_mfence();
+      if (f->seq == seq)
+	{
+	  syscall(SYS_futex, &f->seq, FUTEX_WAIT, seq, NULL, NULL, 0);
+	}
+      f->waiting = 0;
+    }
+}
+
+static void
+futex_recv(ipc_msg_t* msg)
+{
+  futex_recv_(-1, msg);
+}
+
+static void
+futex_recv_from(uint32_t from, ipc_msg_t* msg)
+{
+  futex_recv_(from, msg);
+}
+
+#endif	/* __linux__ */
+
+static transport_t transports[] =
+  {
+    {"ssmp", ssmp_tr_init, ssmp_tr_send, ssmp_tr_recv, ssmp_tr_recv_from, "ssmp_send / ssmp_recv[_from]"},
+    {"pipe", pipe_init, fd_send, fd_recv, fd_recv_from, "a pipe per receiver"},
+    {"unix", unix_init, fd_send, fd_recv, fd_recv_from, "an AF_UNIX datagram socket per receiver"},
+#if defined(__linux__)
+    {"eventfd", eventfd_init, eventfd_send, eventfd_recv, eventfd_recv_from, "shm rings, an eventfd per receiver"},
+    {"futex", futex_init, futex_send, futex_recv, futex_recv_from, "shm rings, a futex per receiver"},
+#endif
+    {"mq", mq_init, mq_tr_send, mq_tr_recv, mq_tr_recv_from, "a POSIX message queue per receiver"},
+  };
+
+#define NUM_TRANSPORTS (sizeof(transports) / sizeof(transports[0]))
+
+/* ------------------------------------------------------------------------------- */
+/* patterns: as in bench, return the rate of this process (0 if it does not count)
+   and record the latency of every request with PF_SAMPLE(0) */
+/* ------------------------------------------------------------------------------- */
+
+static transport_t* tr;
+
+static inline void
+record_latency(ticks start)
+{
+#if defined(DO_TIMINGS)
+  ticks t = getticks_fenced() - start;
+  PF_SAMPLE(0, (t > getticks_correction) ? t - getticks_correction : 0);
+#endif
+}
+
+/* even processes receive from the next odd one */
+static double
+run_oneway(uint32_t ops)
+{
+  ipc_msg_t msg;
+  uint32_t i;
+  if (ID % 2 == 0)
+    {
+      ticks t0 = getticks_fenced();
+      for (i = 0; i < ops; i++)
+	{
+	  tr->recv_from(ID + 1, &msg);
+	}
+      return ops / ticks_to_secs(getticks_fenced() - t0);
+    }
+
+  for (i = 0; i < ops; i++)
+    {
+      msg.seq = i;
+      tr->send(ID - 1, &msg);
+    }
+  return 0;
+}
+
+/* odd processes send to the previous even one, which answers */
+static double
+run_roundtrip(uint32_t ops)
+{
+  ipc_msg_t msg;
+  uint32_t i;
+  if (ID % 2 == 0)
+    {
+      for (i = 0; i < ops; i++)
+	{
+	  tr->recv_from(ID + 1, &msg);
+	  tr->send(ID + 1, &msg);
+	}
+      return 0;
+    }
+
+  ticks t0 = getticks_fenced();
+  for (i = 0; i < ops; i++)
+    {
+      ticks t = getticks_fenced();
+      msg.seq = i;
+      tr->send(ID - 1, &msg);
+      tr->recv_from(ID - 1, &msg);
+      record_latency(t);
+    }
+  return ops / ticks_to_secs(getticks_fenced() - t0);
+}
+
+/* process 0 answers the requests of all the others */
+static double
+run_client_server(uint32_t ops)
+{
+  ipc_msg_t msg;
+  uint32_t i;
+  if (ID == 0)
+    {
+      uint32_t reqs = ops * (num_procs - 1);
+      ticks t0 = getticks_fenced();
+      for (i = 0; i < reqs; i++)
+	{
+	  tr->recv(&msg);
+	  tr->send(msg.sender, &msg);
+	}
+      return reqs / ticks_to_secs(getticks_fenced() - t0);
+    }
+
+  for (i = 0; i < ops; i++)
+    {
+      ticks t = getticks_fenced();
+      msg.seq = i;
+      tr->send(0, &msg);
+      tr->recv_from(0, &msg);
+      record_latency(t);
+    }
+  return 0;
+}
+
+typedef struct pattern
+{
+  const char* name;
+  const char* unit;
+  int pairs;			/* needs an even number of processes */
+  double (*run)(uint32_t ops);
+} pattern_t;
+
+static pattern_t patterns[] =
+  {
+    {"oneway", "msgs/s", 1, run_oneway},
+    {"roundtrip", "roundtrips/s", 1, run_roundtrip},
+    {"client_server", "requests/s", 0, run_client_server},
+  };
+
+#define NUM_PATTERNS (sizeof(patterns) / sizeof(patterns[0]))
+
+/* ------------------------------------------------------------------------------- */
+/* main */
+/* ------------------------------------------------------------------------------- */
+
+typedef struct result
+{
+  pattern_t* p;
+  transport_t* t;
+  double mean, stddev;
+  int lat;			/* has latency percentiles (not oneway) */
+  double p50, p99, p999;	/* ns */
+} result_t;
+
+/* whether name is in the comma-separated list (an empty list has all names) */
+static int
+in_list(const char* list, const char* name)
+{
+  size_t len = strlen(name);
+  const char* s = list;
+  if (list[0] == '\0')
+    {
+      return 1;
+    }
+  while ((s = strstr(s, name)) != NULL)
+    {
+      if ((s == list || s[-1] == ',') && (s[len] == ',' || s[len] == '\0'))
+	{
+	  return 1;
+	}
+      s += len;
+    }
+  return 0;
+}
+
+static uint32_t*
+parse_cores(char* str, int n)
+{
+  uint32_t* c = (uint32_t*) malloc(n * sizeof(uint32_t));
+  assert(c != NULL);
+  char* s = strdup(str);
+  char* save = NULL;
+  char* tok = strtok_r(s, ",", &save);
+  int i;
+  for (i = 0; i < n; i++)
+    {
+      if (tok != NULL)
+	{
+	  c[i] = atoi(tok);
+	  tok = strtok_r(NULL, ",", &save);
+	}
+      else
+	{
+	  c[i] = (i > 0) ? c[i - 1] + 1 : 0;	/* continue after the last given core */
+	}
+    }
+  free(s);
+  return c;
+}
+
+int
+main(int argc, char **argv)
+{
+  struct option long_options[] =
+    {
+      // These options don't set a flag
+      {"help",        no_argument, NULL, 'h'},
+      {"transports",  required_argument, NULL, 't'},
+      {"patterns",    required_argument, NULL, 'w'},
+      {"num-procs",   required_argument, NULL, 'n'},
+      {"num-ops",     required_argument, NULL, 'm'},
+      {"reps",        required_argument, NULL, 'r'},
+      {"cores",       required_argument, NULL, 'c'},
+      {"no-pin",      no_argument, NULL, 'P'},
+      {"csv",         no_argument, NULL, 'v'},
+      {NULL, 0, NULL, 0}
+    };
+
+  char* tr_list = "";
+  char* pat_list = "";
+  char* cores_str = NULL;
+  uint32_t k;
+  int i, c;
+  while (1)
+    {
+      i = 0;
+      c = getopt_long(argc, argv, "ht:w:n:m:r:c:Pv", long_options, &i);
+
+      if (c == -1)
+	break;
+
+      if (c == 0 && long_options[i].flag == 0)
+	c = long_options[i].val;
+
+      switch (c)
+	{
+	case 0:
+	  /* Flag is automatically set */
+	  break;
+	case 'h':
+	  printf("ipc_compare -- Compare ssmp with the standard IPC mechanisms\n"
+		 "\n"
+		 "Usage:\n"
+		 "  ./ipc_compare [options...]\n"
+		 "\n"
+		 "Options:\n"
+		 "  -h, --help\n"
+		 "        Print this message\n"
+		 "  -t, --transports <list>\n"
+		 "        Comma-separated transports (default: all):\n");
+	  for (k = 0; k < NUM_TRANSPORTS; k++)
+	    {
+	      printf("          %-8s %s\n", transports[k].name, transports[k].desc);
+	    }
+	  printf("  -w, --patterns <list>\n"
+		 "        Comma-separated patterns: oneway, roundtrip, client_server (default: all)\n"
+		 "  -n, --num-procs <int>\n"
+		 "        Number of processes\n"
+		 "  -m, --num-ops <int>\n"
+		 "        Operations per process and repetition\n"
+		 "  -r, --reps <int>\n"
+		 "        Measured repetitions (after one warm-up repetition)\n"
+		 "  -c, --cores <list>\n"
+		 "        Comma-separated cores of the processes (default 0, 1, ...)\n"
+		 "  -P, --no-pin\n"
+		 "        Do not pin the processes\n"
+		 "  -v, --csv\n"
+		 "        Print CSV instead of a table\n"
+		 );
+	  exit(0);
+	case 't':
+	  tr_list = optarg;
+	  break;
+	case 'w':
+	  pat_list = optarg;
+	  break;
+	case 'n':
+	  num_procs = atoi(optarg);
+	  break;
+	case 'm':
+	  num_ops = atoi(optarg);
+	  break;
+	case 'r':
+	  num_reps = atoi(optarg);
+	  break;
+	case 'c':
+	  cores_str = optarg;
+	  break;
+	case 'P':
+	  pin = 0;
+	  break;
+	case 'v':
+	  csv = 1;
+	  break;
+	case '?':
+	  printf("Use -h or --help for help\n");
+	  exit(0);
+	default:
+	  exit(1);
+	}
+    }
+
+  int tr_sel[NUM_TRANSPORTS], pat_sel[NUM_PATTERNS], num_tr = 0, num_pat = 0;
+  for (k = 0; k < NUM_TRANSPORTS; k++)
+    {
+      num_tr += (tr_sel[k] = in_list(tr_list, transports[k].name));
+    }
+  for (k = 0; k < NUM_PATTERNS; k++)
+    {
+      num_pat += (pat_sel[k] = in_list(pat_list, patterns[k].name));
+    }
+  if (num_tr == 0 || num_pat == 0)
+    {
+      printf("** no known transport / pattern selected (use -h for the lists)\n");
+      exit(1);
+    }
+  if (num_procs < 2 || num_reps < 1)
+    {
+      printf("** need at least 2 processes and one repetition\n");
+      exit(1);
+    }
+
+  cores = parse_cores(cores_str ? cores_str : "0", num_procs);
+
+  ID = 0;
+  getticks_correction = getticks_correction_calc();
+  ssmp_init(num_procs);
+  for (k = 0; k < NUM_TRANSPORTS; k++)
+    {
+      if (tr_sel[k])
+	{
+	  transports[k].init();
+	}
+    }
+
+  int rank;
+  for (rank = 1; rank < num_procs; rank++)
+    {
+      pid_t child = fork();
+      if (child < 0)
+	{
+	  P("Failure in fork():\n%s", strerror(errno));
+	}
+      else if (child == 0)
+	{
+	  goto fork_done;
+	}
+    }
+  rank = 0;
+
+ fork_done:
+  ID = rank;
+
+  if (pin)
+    {
+      set_cpu(cores[ID]);
+    }
+
+  ssmp_mem_init(ID, num_procs);
+
+  result_t* results = (result_t*) calloc(NUM_TRANSPORTS * NUM_PATTERNS, sizeof(result_t));
+  double* vals = (double*) malloc(num_procs * sizeof(double));
+  double* reps = (double*) malloc(num_reps * sizeof(double));
+  assert(results != NULL && vals != NULL && reps != NULL);
+  int num_results = 0;
+
+  uint32_t p, t;
+  int r;
+  for (p = 0; p < NUM_PATTERNS; p++)
+    {
+      if (!pat_sel[p] || (patterns[p].pairs && num_procs % 2))
+	{
+	  continue;
+	}
+      for (t = 0; t < NUM_TRANSPORTS; t++)
+	{
+	  if (!tr_sel[t])
+	    {
+	      continue;
+	    }
+	  tr = &transports[t];
+	  for (r = -1; r < num_reps; r++)
+	    {
+	      ssmp_barrier_wait(0);
+	      double val = patterns[p].run(num_ops);
+	      ssmp_barrier_wait(0);
+
+	      ssmp_gather(0, &val, vals, sizeof(double));
+	      if (r < 0)
+		{
+		  PF_EXCLUDE(0);
+		}
+	      else if (ID == 0)
+		{
+		  reps[r] = 0;
+		  for (i = 0; i < num_procs; i++)
+		    {
+		      reps[r] += vals[i];
+		    }
+		}
+	    }
+
+	  PF_MERGE;
+
+	  if (ID == 0)
+	    {
+	      result_t* res = &results[num_results++];
+	      res->p = &patterns[p];
+	      res->t = tr;
+	      for (r = 0; r < num_reps; r++)
+		{
+		  res->mean += reps[r] / num_reps;
+		}
+	      for (r = 0; r < num_reps; r++)
+		{
+		  res->stddev += (reps[r] - res->mean) * (reps[r] - res->mean);
+		}
+	      res->stddev = (num_reps > 1) ? sqrt(res->stddev / (num_reps - 1)) : 0;
+#if defined(DO_TIMINGS)
+	      if (pf_has_percentiles(0))
+		{
+		  res->lat = 1;
+		  res->p50 = ticks_to_ns(pf_percentile(0, 0.5));
+		  res->p99 = ticks_to_ns(pf_percentile(0, 0.99));
+		  res->p999 = ticks_to_ns(pf_percentile(0, 0.999));
+		}
+#endif
+	    }
+	}
+    }
+
+  if (ID == 0)
+    {
+      if (csv)
+	{
+	  printf("pattern,transport,procs,ops,reps,unit,mean,stddev,p50_ns,p99_ns,p999_ns,slower_than_ssmp\n");
+	}
+      else
+	{
+	  printf("%d processes, %u ops x %d repetitions%s\n", num_procs, num_ops, num_reps,
+		 pin ? "" : ", not pinned");
+	  printf("(x slower than ssmp: throughput of ssmp / throughput of the transport; "
+		 "no latencies for oneway)\n");
+	  printf("%-14s %-8s %16s %8s %12s %12s %12s %8s\n", "pattern", "transport",
+		 "throughput", "stddev%", "p50 ns", "p99 ns", "p99.9 ns", "x slower");
+	}
+
+      double ssmp_mean = 0;
+      for (i = 0; i < num_results; i++)
+	{
+	  result_t* res = &results[i];
+	  if (strcmp(res->t->name, "ssmp") == 0)
+	    {
+	      ssmp_mean = res->mean;
+	    }
+	  else if (i == 0 || results[i - 1].p != res->p)
+	    {
+	      ssmp_mean = 0;	/* ssmp not selected */
+	    }
+	  double vs = (ssmp_mean > 0 && res->mean > 0) ? ssmp_mean / res->mean : 0;
+
+	  /* the columns without a value: empty in CSV, "-" in the table */
+	  char lat[3][16], slower[16];
+	  double p[3] = { res->p50, res->p99, res->p999 };
+	  int k;
+	  for (k = 0; k < 3; k++)
+	    {
+	      if (res->lat)
+		{
+		  sprintf(lat[k], "%.1f", p[k]);
+		}
+	      else
+		{
+		  strcpy(lat[k], csv ? "" : "-");
+		}
+	    }
+	  if (vs > 0)
+	    {
+	      sprintf(slower, csv ? "%.3g" : "%.3gx", vs);
+	    }
+	  else
+	    {
+	      strcpy(slower, csv ? "" : "-");
+	    }
+
+	  if (csv)
+	    {
+	      printf("%s,%s,%d,%u,%d,%s,%.2f,%.2f,%s,%s,%s,%s\n", res->p->name, res->t->name,
+		     num_procs, num_ops, num_reps, res->p->unit, res->mean, res->stddev,
+		     lat[0], lat[1], lat[2], slower);
+	    }
+	  else
+	    {
+	      printf("%-14s %-8s %16.0f %8.1f %12s %12s %12s %8s\n", res->p->name,
+		     res->t->name, res->mean, res->mean ? 100 * res->stddev / res->mean : 0,
+		     lat[0], lat[1], lat[2], slower);
+	    }
+	}
+    }
+
+  free(results);
+  free(vals);
+  free(reps);
+  ssmp_term();
+  return 0;
+}
@@ -27,11 +27,55 @@
 int num_procs = 2;
 long long int num_msgs = 10000000;
 ticks getticks_correction;
-uint8_t ID;
+uint32_t ID;
 uint32_t wait_cycles_after = 0;
 int core1 = 0;
 int core2 = 1;
 int core_offs = 0;
+int init_opts = 0;
+int json = 0;
+int stamp = 0;
+int use_inline = 0;
+int use_seq = 0;
+
+/* the functions of the library, their inline fast path (-i), or the rings with
+   sequence numbers (-q) */
+#define SEND(to, msg)							\
+  do {									\
+    if (use_seq) ssmp_seq_send(to, msg);				\
+    else if (use_inline) ssmp_send_inline(to, msg);			\
+    else ssmp_send(to, msg);						\
+  } while (0)
+#define RECV_FROM(from, msg)						\
+  do {									\
+    if (use_seq) ssmp_seq_recv_from(from, msg);				\
+    else if (use_inline) ssmp_recv_from_inline(from, msg);		\
+    else ssmp_recv_from(from, msg);					\
+  } while (0)
+#define SEND_IS_FREE(to)						\
+  (use_seq ? ssmp_seq_send_is_free(to) : ssmp_send_is_free(to))
+
+/* the hardware counters (SSMP_PF_EVENTS) of the whole loop of a process, on a
+   position without samples: the lines a message moves are counted by the events
+   of its sender and of its receiver (e.g., HITM snoops or L2 misses) */
+#define PF_LOOP 3
+#if defined(DO_TIMINGS)
+#  define PF_LOOP_START()						\
+  do { if (pf_pmu_state_ != PF_PMU_OFF) pf_pmu_entry(PF_LOOP); } while (0)
+#  define PF_LOOP_STOP()						\
+  do { if (pf_pmu_state_ == PF_PMU_ON) pf_pmu_exit(PF_LOOP); } while (0)
+#  define PF_LOOP_ON()     (pf_pmu_state_ == PF_PMU_ON)
+#  define PF_LOOP_NUM()    pf_pmu_num
+#  define PF_LOOP_NAME(e)  pf_pmu_names[e]
+#  define PF_LOOP_SUM(e)   pf_pmu_sum[PF_LOOP][e]
+#else
+#  define PF_LOOP_START()
+#  define PF_LOOP_STOP()
+#  define PF_LOOP_ON()     0
+#  define PF_LOOP_NUM()    0
+#  define PF_LOOP_NAME(e)  ""
+#  define PF_LOOP_SUM(e)   0
+#endif
 
 int
 main(int argc, char **argv) 
@@ -54,6 +98,11 @@ main(int argc, char **argv)
       {"core1", required_argument, NULL, 'x'},
       {"core2", required_argument, NULL, 'y'},
       {"core-offset", required_argument, NULL, 'o'},
+      {"warmup",      no_argument, NULL, 'w'},
+      {"json",        no_argument, NULL, 'j'},
+      {"timestamp",   no_argument, NULL, 't'},
+      {"inline",      no_argument, NULL, 'i'},
+      {"seq",         no_argument, NULL, 'q'},
       {NULL, 0, NULL, 0}
     };
 
@@ -61,7 +110,7 @@ main(int argc, char **argv)
   while (1)
     {
       i = 0;
-      c = getopt_long(argc, argv, "hn:m:d:x:y:o:", long_options, &i);
+      c = getopt_long(argc, argv, "hn:m:d:x:y:o:wjtiq", long_options, &i);
 
       if (c == -1)
 	break;
@@ -99,6 +148,24 @@ main(int argc, char **argv)
 		"        on the consecutive cores starting from the given offset.\n"
 		"        For example, if the offset is 2, proc 3 with be placed on\n"
 		"        core 2, proc 4 on core 3, etc.\n"
+		"  -w, --warmup\n"
+		"        Prefault the message memory and exchange a message over\n"
+		"        every pair before measuring (SSMP_OPT_[PREFAULT|WARMUP])\n"
+		"  -j, --json\n"
+		"        Print the merged results of all processes as JSON\n"
+		"  -t, --timestamp\n"
+		"        Synchronize the clocks (SSMP_OPT_CLOCK_SYNC), stamp every message\n"
+		"        and record the one-way latency of every message at the receiver\n"
+		"  -i, --inline\n"
+		"        Send and receive with the inline fast path (ssmp_send_inline,\n"
+		"        ssmp_recv_from_inline) instead of the functions of libssmp\n"
+		"  -q, --seq\n"
+		"        Send and receive over the rings with sequence numbers\n"
+		"        (SSMP_OPT_SEQ: ssmp_seq_send, ssmp_seq_recv_from) and print the\n"
+		"        accesses to the ack lines\n"
+		"  With SSMP_PF_EVENTS (e.g., the HITM snoops or the L2 misses of the\n"
+		"  platform), the events of the loops of the sender and the receiver per\n"
+		"  message, i.e., the lines a message moves\n"
 		);
 	  exit(0);
 	case 'n':
@@ -119,6 +186,21 @@ main(int argc, char **argv)
 	case 'o':
 	  core_offs = atoi(optarg);
 	  break;
+	case 'w':
+	  init_opts = SSMP_OPT_PREFAULT | SSMP_OPT_WARMUP;
+	  break;
+	case 'j':
+	  json = 1;
+	  break;
+	case 't':
+	  stamp = 1;
+	  break;
+	case 'i':
+	  use_inline = 1;
+	  break;
+	case 'q':
+	  use_seq = 1;
+	  break;
 	case '?':
 	  PRINT("Use -h or --help for help\n");
 	  exit(0);
@@ -131,7 +213,7 @@ main(int argc, char **argv)
 
   ID = 0;
   printf("processes: %-10d / msgs: %10lld / delay after: %u\n", num_procs, num_msgs, wait_cycles_after);
-  printf("core1: %3d / core2: %3d", core1, core2);
+  printf("core1: %3d / core2: %3d / %s", core1, core2, use_seq ? "seq" : (use_inline ? "inline" : "library"));
   if (num_procs > 2)
     {
       printf(" / core3: %3d / core4: %3d / etc.", core_offs, core_offs + 1);
@@ -145,7 +227,7 @@ main(int argc, char **argv)
 
   getticks_correction = getticks_correction_calc();
 
-  ssmp_init(num_procs);
+  ssmp_init_opt(num_procs, init_opts | (stamp ? SSMP_OPT_CLOCK_SYNC : 0) | (use_seq ? SSMP_OPT_SEQ : 0));
 
   int rank;
   for (rank = 1; rank < num_procs; rank++)
@@ -194,7 +276,8 @@ main(int argc, char **argv)
   assert(msgp != NULL);
   
   PF_MSG(0, "receiving");
-  PF_MSG(1, "sending");
+  PF_MSG(1, "sending (roundtrip)");
+  PF_MSG(2, "one-way latency");
 
   /* PFDINIT(num_msgs); */
 
@@ -209,13 +292,21 @@ main(int argc, char **argv)
       uint32_t out = num_msgs - 1;
       uint32_t expected = 0;
 
+      PF_LOOP_START();
       PF_START(0);
       while(1) 
 	{
-	  ssmp_recv_from(from, msgp);
+	  RECV_FROM(from, msgp);
+
+	  if (stamp)
+	    {
+	      ticks now = getticks_global();
+	      ticks sent = (((ticks) (uint32_t) msgp->w3) << 32) | (uint32_t) msgp->w2;
+	      PF_SAMPLE(2, (now > sent) ? now - sent : 0);
+	    }
 
 #if defined(ROUNDTRIP)
-	  ssmp_send(from, msgp);
+	  SEND(from, msgp);
 #endif
 
 	  if (msgp->w0 == out) 
@@ -229,6 +320,7 @@ main(int argc, char **argv)
 	    }
 	}
       PF_STOP(0);
+      PF_LOOP_STOP();
 	
       total_samples[0] = msgp->w0 + 1;
     }
@@ -237,14 +329,30 @@ main(int argc, char **argv)
       uint32_t to = ID - 1;
       uint32_t num_msgs1 = num_msgs;
 
+      PF_LOOP_START();
       for (num_msgs1 = 0; num_msgs1 < num_msgs; num_msgs1++)
 	{
 	  msgp->w0 = num_msgs1;
 
-	  ssmp_send(to, msgp);
+#if defined(ROUNDTRIP)
+	  PF_START(1);
+#endif
+	  if (stamp)
+	    {
+	      /* stamp when the buffer is free, so that waiting for it is not counted */
+	      while (!SEND_IS_FREE(to))
+		{
+		  PAUSE;
+		}
+	      ticks now = getticks_global();
+	      msgp->w2 = (int32_t) now;
+	      msgp->w3 = (int32_t) (now >> 32);
+	    }
+	  SEND(to, msgp);
 
 #if defined(ROUNDTRIP)
-	  ssmp_recv_from(to, msgp);
+	  RECV_FROM(to, msgp);
+	  PF_STOP(1);
 
 	  if (msgp->w0 != num_msgs1)
 	    {
@@ -257,6 +365,7 @@ main(int argc, char **argv)
 	      wait_cycles(wait_cycles_after);
 	    }
 	}
+      PF_LOOP_STOP();
     }
 
 
@@ -265,10 +374,38 @@ main(int argc, char **argv)
     {
       if (co == ssmp_id())
 	{
+	  if (stamp)
+	    {
+	      printf("[%02d] Clock offset to core 0: %lld ticks\n", ID, (long long) ssmp_clock_offset());
+	    }
 	  PF_PRINT;
+	  uint32_t e;
+	  for (e = 0; e < PF_LOOP_NUM(); e++)
+	    {
+	      printf("[%02d] %s per message: %.3f\n", ID, PF_LOOP_NAME(e),
+		     (double) PF_LOOP_SUM(e) / num_msgs);
+	    }
+	  if (use_seq)
+	    {
+	      ssmp_seq_counters_t* sc = &ssmp_seq_counters;
+	      printf("[%02d] ack lines: %.3f reads, %.3f new counts, %.3f stores per message\n", ID,
+		     (double) sc->ack_loads / num_msgs, (double) sc->ack_misses / num_msgs,
+		     (double) sc->ack_stores / num_msgs);
+	      /* without counters: a message moves its line to the receiver once
+		 (the receiver never writes to it), and the ack line moves to the
+		 sender when it reads a new count */
+	      if (!PF_LOOP_ON())
+#if !defined(ROUNDTRIP)
+		if (ID % 2)
+#endif
+		  {
+		    printf("[%02d] line transfers per message sent: %.3f (estimate, set SSMP_PF_EVENTS to measure)\n",
+			   ID, 1 + (double) sc->ack_misses / num_msgs);
+		  }
+	    }
 	  if (total_sum_ticks[0] > 0)
 	    {
-	      double secs = total_sum_ticks[0] / (REF_SPEED_GHZ * 1.e9);
+	      double secs = ticks_to_secs(total_sum_ticks[0]);
 	      printf("[%02d] Throughput (core): %.1f", ID, num_msgs/secs);
 #if defined(ROUNDTRIP)
 	      printf(" Roundtrips/s\n");
@@ -280,6 +417,30 @@ main(int argc, char **argv)
       ssmp_barrier_wait(0);
     }
 
+  PF_MERGE;
+  if (ID == 0 && PF_LOOP_ON())
+    {
+      /* the sums of the senders and of the receivers of all pairs */
+      uint32_t e;
+      for (e = 0; e < PF_LOOP_NUM(); e++)
+	{
+	  printf("[%02d] %s per message, sender + receiver: %.3f\n", ID, PF_LOOP_NAME(e),
+		 (double) PF_LOOP_SUM(e) / (num_msgs * (num_procs / 2)));
+	}
+    }
+  if (ID == 0 && (num_procs > 2 || json))
+    {
+      printf("---- merged (%d processes)\n", num_procs);
+      if (json)
+	{
+	  PF_PRINT_JSON;
+	}
+      else
+	{
+	  PF_PRINT;
+	}
+    }
+
   free((void*) msgp);
   ssmp_term();
   return 0;
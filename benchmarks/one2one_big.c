@@ -20,12 +20,110 @@
 #include "common.h"
 #include "ssmp.h"
 
+/*
+   Bandwidth of big messages: for every placement of the two processes and every
+   message size (one, or a sweep that doubles from min to max), the sender sends
+   messages with ssmp_send_big and the receiver takes them with
+   ssmp_recv_from_big. Reports GB/s, the cycles per byte of the sender and of the
+   receiver, and the bandwidth of memcpy on one core for the same volume (the
+   copy that handing the buffer over would save). The chunk size is fixed at
+   build time: make CHUNK=<bytes> one2one_big.
+*/
+
 int num_procs = 2;
 long long int num_msgs = 100000;
 size_t siz_data = 16 * 1024;
-uint8_t ID;
+size_t siz_min = 0, siz_max = 0;	/* sweep */
+size_t budget = 0;			/* max bytes per size (0: num_msgs messages) */
+uint32_t ID;
 int core1 = 0;
 int core2 = 1;
+int auto_placements = 0;
+
+typedef struct placement
+{
+  const char* name;
+  int core1, core2;
+} placement_t;
+
+/* the topology entry what (e.g., core_id) of cpu, -1 if unknown */
+static int
+cpu_topology(int cpu, const char* what)
+{
+  char path[128];
+  int v = -1;
+  sprintf(path, "/sys/devices/system/cpu/cpu%d/topology/%s", cpu, what);
+  FILE* f = fopen(path, "r");
+  if (f != NULL)
+    {
+      if (fscanf(f, "%d", &v) != 1)
+	{
+	  v = -1;
+	}
+      fclose(f);
+    }
+  return v;
+}
+
+/* cpu 0 with: its hyper-thread sibling, another core of its socket, a core of
+   another socket (the ones that exist) */
+static int
+find_placements(placement_t* pl)
+{
+  int cpus = sysconf(_SC_NPROCESSORS_ONLN), cpu, n = 0;
+  int smt = -1, socket = -1, cross = -1;
+  int pkg0 = cpu_topology(0, "physical_package_id"), core0 = cpu_topology(0, "core_id");
+  for (cpu = 1; cpu < cpus; cpu++)
+    {
+      int pkg = cpu_topology(cpu, "physical_package_id"), core = cpu_topology(cpu, "core_id");
+      if (pkg == pkg0 && core == core0 && smt < 0)
+	{
+	  smt = cpu;
+	}
+      else if (pkg == pkg0 && core != core0 && socket < 0)
+	{
+	  socket = cpu;
+	}
+      else if (pkg != pkg0 && cross < 0)
+	{
+	  cross = cpu;
+	}
+    }
+
+  if (smt > 0)
+    {
+      pl[n].name = "smt";
+      pl[n].core1 = 0;
+      pl[n++].core2 = smt;
+    }
+  if (socket > 0)
+    {
+      pl[n].name = "socket";
+      pl[n].core1 = 0;
+      pl[n++].core2 = socket;
+    }
+  if (cross > 0)
+    {
+      pl[n].name = "cross";
+      pl[n].core1 = 0;
+      pl[n++].core2 = cross;
+    }
+  return n;
+}
+
+static size_t
+parse_size(const char* s)
+{
+  char* end;
+  size_t v = strtoull(s, &end, 10);
+  switch (*end)
+    {
+    case 'k': case 'K': return v << 10;
+    case 'm': case 'M': return v << 20;
+    case 'g': case 'G': return v << 30;
+    }
+  return v;
+}
 
 int
 main(int argc, char** argv)
@@ -36,8 +134,11 @@ main(int argc, char** argv)
       {"help", no_argument, NULL, 'h'},
       {"num-msgs", required_argument, NULL, 'n'},
       {"size-msg", required_argument, NULL, 's'},
+      {"sweep", required_argument, NULL, 'r'},
+      {"budget", required_argument, NULL, 'b'},
       {"core1", required_argument, NULL, 'x'},
       {"core2", required_argument, NULL, 'y'},
+      {"placements", no_argument, NULL, 'a'},
       {NULL, 0, NULL, 0}
     };
 
@@ -45,7 +146,7 @@ main(int argc, char** argv)
  while (1)
    {
      i = 0;
-     c = getopt_long(argc, argv, "hn:s:x:y:", long_options, &i);
+     c = getopt_long(argc, argv, "hn:s:r:b:x:y:a", long_options, &i);
 
      if (c == -1)
        break;
@@ -68,20 +169,37 @@ main(int argc, char** argv)
 	       "  -h, --help\n"
 	       "        Print this message\n"
 	       "  -n, --num-msgs <int>\n"
-	       "        Number of messages to send\n"
+	       "        Number of messages to send (per size)\n"
 	       "  -s, --size-msg <int>\n"
-	       "        Size of a message in bytes\n"
+	       "        Size of a message in bytes (k, m, g suffixes)\n"
+	       "  -r, --sweep <min:max>\n"
+	       "        Sweep the sizes from min to max, doubling (e.g., 64:256m)\n"
+	       "  -b, --budget <int>\n"
+	       "        Max bytes to send per size (default with -r: 1g)\n"
 	       "  -x, --core1 <int>\n"
 	       "        On which core to put the receiver process\n"
 	       "  -y, --core2 <int>\n"
 	       "        On which core to put the sender process\n"
+	       "  -a, --placements\n"
+	       "        Run with core 0 and its hyper-thread sibling, a core of the same\n"
+	       "        socket, and a core of another socket (instead of -x / -y)\n"
 	       );
 	 exit(0);
        case 'n':
-	 num_msgs = atoi(optarg);
+	 num_msgs = atoll(optarg);
 	 break;
        case 's':
-	 siz_data = atoi(optarg);
+	 siz_data = parse_size(optarg);
+	 break;
+       case 'r':
+	 {
+	   char* colon = strchr(optarg, ':');
+	   siz_min = parse_size(optarg);
+	   siz_max = (colon != NULL) ? parse_size(colon + 1) : siz_min;
+	 }
+	 break;
+       case 'b':
+	 budget = parse_size(optarg);
 	 break;
        case 'x':
 	 core1 = atoi(optarg);
@@ -89,6 +207,9 @@ main(int argc, char** argv)
        case 'y':
 	 core2 = atoi(optarg);
 	 break;
+       case 'a':
+	 auto_placements = 1;
+	 break;
        case '?':
 	 PRINT("Use -h or --help for help\n");
 
@@ -98,12 +219,36 @@ main(int argc, char** argv)
        }
    }
 
+ if (siz_min == 0)
+   {
+     siz_min = siz_max = siz_data;
+   }
+ else if (budget == 0)
+   {
+     budget = 1ULL << 30;
+   }
+ if (siz_min == 0 || siz_max < siz_min || num_msgs < 1)
+   {
+     PRINT("** give sizes > 0, min <= max, and at least one message\n");
+     exit(1);
+   }
+
+ placement_t placements[3];
+ int num_placements = 1;
+ placements[0].name = "manual";
+ placements[0].core1 = core1;
+ placements[0].core2 = core2;
+ if (auto_placements && (num_placements = find_placements(placements)) == 0)
+   {
+     PRINT("** no second cpu to place the sender on\n");
+     exit(1);
+   }
+
  ID = 0;
  printf("NUM of msgs      : %lld\n", num_msgs);
- printf("Size of msg      : %lu\n", (long unsigned) siz_data);
- printf("Core receiver    : %d\n", core1);
- printf("Core sender      : %d\n", core2);
-
+ printf("Size of msg      : %lu - %lu\n", (long unsigned) siz_min, (long unsigned) siz_max);
+ printf("Size of chunk    : %d\n", SSMP_CHUNK_SIZE);
+ fflush(stdout);
 
  ssmp_init(num_procs);
 
@@ -124,84 +269,102 @@ main(int argc, char** argv)
  fork_done:
  ID = rank;
 
+ set_cpu((ID == 0) ? placements[0].core1 : placements[0].core2);
+ ssmp_mem_init(ID, num_procs);
+
  if (ID == 0)
    {
-     set_cpu(core1);
+     printf("%-8s %5s %5s %12s %10s %9s %9s %9s %11s %9s %8s\n", "place", "recv", "send",
+	    "size", "msgs", "GB/s", "send c/B", "recv c/B", "memcpy GB/s", "memcpy c/B", "/memcpy");
    }
- else
-   {
-     set_cpu(core2);
-   }
-
- ssmp_mem_init(ID, num_procs);
-
- char* data = (char*) malloc(siz_data);
- assert(data != NULL);
 
- for (i = 0; i < siz_data; i++)
+ int p;
+ for (p = 0; p < num_placements; p++)
    {
-     data[i] = 1;
-   }
+     placement_t* pl = &placements[p];
+     if (p > 0)
+       {
+	 set_cpu((ID == 0) ? pl->core1 : pl->core2);
+       }
 
- ssmp_barrier_wait(0);
+     size_t size;
+     for (size = siz_min; size <= siz_max; size <<= 1)
+       {
+	 long long int msgs = num_msgs, m;
+	 if (budget && size * msgs > budget)
+	   {
+	     msgs = (budget / size) ? (budget / size) : 1;
+	   }
 
- double _start = wtime();
- ticks _start_ticks = getticks();
+	 /* allocated (and first touched) on the current core */
+	 char* data = (char*) malloc(size);
+	 char* copy = (ID == 0) ? (char*) malloc(size) : NULL;
+	 assert(data != NULL && (ID != 0 || copy != NULL));
+	 memset(data, (ID == 0) ? 0 : 1, size);
 
- ssmp_msg_t msg;
- long long int num_msgs1 = num_msgs;
+	 /* memcpy on the core of the receiver, same volume */
+	 ticks t_copy = 0;
+	 if (ID == 0)
+	   {
+	     memset(copy, 1, size);
+	     memcpy(data, copy, size);
+	     ticks t0 = getticks_fenced();
+	     for (m = 0; m < msgs; m++)
+	       {
+		 memcpy(data, copy, size);
+	       }
+	     t_copy = getticks_fenced() - t0;
+	     memset(data, 0, size);
+	   }
 
+	 ssmp_barrier_wait(0);
 
- if (ID % 2 == 0)
-   {
-     while (num_msgs1--)
-       {
-	 ssmp_recv(&msg);
-	 ssmp_recv_from_big(msg.sender, data, msg.w0);
-	 if (num_msgs1 == num_msgs-1)
+	 ticks t0 = getticks_fenced();
+	 if (ID == 0)
 	   {
-	     size_t l, sum = 0;
-	     for(l = 0; l < siz_data; l++)
+	     for (m = 0; m < msgs; m++)
 	       {
-		 sum += data[l];
+		 ssmp_recv_from_big(1, data, size);
 	       }
-	     if (sum != msg.w1)
-	       { 
-		 P("** warning: got sum: %lu, instead of %d", (long unsigned) sum, msg.w1); 
+	   }
+	 else
+	   {
+	     for (m = 0; m < msgs; m++)
+	       {
+		 ssmp_send_big(0, data, size);
 	       }
 	   }
-       }
-   }
- else
-   {
-     int to = ID-1;
+	 ticks t[2];
+	 t[ID] = getticks_fenced() - t0;
 
-     while (num_msgs1--)
-       {
-	 msg.w0 = siz_data; msg.w1 = siz_data;
-	 ssmp_send(to, &msg);
-	 ssmp_send_big(to, data, siz_data);
-       }
-   }
+	 ssmp_gather(0, &t[ID], t, sizeof(ticks));
 
-  
- ticks _end_ticks = getticks();
- double _end = wtime();
+	 if (ID == 0)
+	   {
+	     size_t l, bad = 0;
+	     for (l = 0; l < size; l++)
+	       {
+		 bad += (data[l] != 1);
+	       }
+	     if (bad)
+	       {
+		 P("** warning: %lu corrupted bytes in a message of %lu", (long unsigned) bad,
+		   (long unsigned) size);
+	       }
 
- if (ID == 1)
-   {
-     double _time = _end - _start;
-     ticks _ticks = _end_ticks - _start_ticks;
-     ticks _ticksm =(ticks) ((double)_ticks / num_msgs);
-     double lat = (double) (1000*1000*1000*_time) / num_msgs;
-     double throughput_M = ((num_msgs * siz_data) / _time) / (1024 * 1024);
-
-     printf("sent %lld msgs\n\t"
-	    "in %f secs\n\t"
-	    "%.1f ns latency\n\t"
-	    "%llu ticks/msg\n"
-	    "throughput: %10.2f MB/s = %.2f GB/s\n",
-	    num_msgs, _time, lat, (long long unsigned) _ticksm, throughput_M, throughput_M / 1024);
+	     double bytes = (double) size * msgs;
+	     double gbs = bytes / ticks_to_secs(t[0]) / 1e9;
+	     double copy_gbs = bytes / ticks_to_secs(t_copy ? t_copy : 1) / 1e9;
+	     printf("%-8s %5d %5d %12lu %10lld %9.2f %9.3f %9.3f %11.2f %9.3f %8.2f\n",
+		    pl->name, pl->core1, pl->core2, (long unsigned) size, msgs, gbs,
+		    t[1] / bytes, t[0] / bytes, copy_gbs, t_copy / bytes, gbs / copy_gbs);
+	     fflush(stdout);
+	   }
+
+	 free(data);
+	 free(copy);
+	 ssmp_barrier_wait(0);
+       }
    }
 
  ssmp_barrier_wait(1);
@@ -0,0 +1,239 @@
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <inttypes.h>
+#include <unistd.h>
+#include <time.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <assert.h>
+#include <getopt.h>
+
+#include "common.h"
+#include "ssmp.h"
+#include "measurements.h"
+
+/* 
+   Core 0 serves roundtrips from the last num_active cores, receiving with
+   ssmp_recv (any core) or ssmp_recv_color_start, while the rest of the cores
+   stay idle. Shows how the cost of receiving from any core grows with the
+   number of processes (with more than 64 processes on x86, through the doorbell).
+*/
+
+uint32_t num_procs = 2;
+uint32_t num_active = 1;
+uint32_t num_msgs = 1000000;
+uint32_t recv_color = 0;
+uint32_t ID;
+
+int 
+color_client(int id)
+{
+  return (id != 0);
+}
+
+int 
+color_active(int id)
+{
+  return (id != 0 && id >= num_procs - num_active);
+}
+
+int 
+main(int argc, char **argv) 
+{
+  struct option long_options[] =
+    {
+      // These options don't set a flag
+      {"help",        no_argument, NULL, 'h'},
+      {"num-msgs",    required_argument, NULL, 'm'},
+      {"num-procs",   required_argument, NULL, 'n'},
+      {"active",      required_argument, NULL, 'a'},
+      {"color",       no_argument, NULL, 'c'},
+      {NULL, 0, NULL, 0}
+    };
+
+  int i, c;
+  while (1)
+    {
+      i = 0;
+      c = getopt_long(argc, argv, "hn:m:a:c", long_options, &i);
+
+      if (c == -1)
+	break;
+
+      if (c == 0 && long_options[i].flag == 0)
+	c = long_options[i].val;
+
+      switch (c)
+	{
+	case 0:
+	  /* Flag is automatically set */
+	  break;
+	case 'h':
+	  PRINT("recv_any -- Testing receiving from any core with many processes\n"
+		"\n"
+		"Usage:\n"
+		"  ./recv_any [options...]\n"
+		"\n"
+		"Options:\n"
+		"  -h, --help\n"
+		"        Print this message\n"
+		"  -n, --num-procs <int>\n"
+		"        Number of processes (up to SSMP_MAX_UES)\n"
+		"  -m, --num-msgs <int>\n"
+		"        Number of roundtrips per active client\n"
+		"  -a, --active <int>\n"
+		"        Number of active clients (the last ones)\n"
+		"  -c, --color\n"
+		"        Receive with ssmp_recv_color_start instead of ssmp_recv\n"
+		);
+	  exit(0);
+	case 'n':
+	  num_procs = atoi(optarg);
+	  break;
+	case 'm':
+	  num_msgs = atoi(optarg);
+	  break;
+	case 'a':
+	  num_active = atoi(optarg);
+	  break;
+	case 'c':
+	  recv_color = 1;
+	  break;
+	case '?':
+	  PRINT("Use -h or --help for help\n");
+	  exit(0);
+	default:
+	  exit(1);
+	}
+    }
+
+  if (num_active > num_procs - 1)
+    {
+      num_active = num_procs - 1;
+    }
+
+  ID = 0;
+  printf("processes: %-10d / active: %-6d / msgs: %10u / recv: %s\n", 
+	 num_procs, num_active, num_msgs, recv_color ? "ssmp_recv_color_start" : "ssmp_recv");
+
+  fflush(stdout);
+
+  ssmp_init(num_procs);
+
+  uint32_t rank;
+  for (rank = 1; rank < num_procs; rank++) 
+    {
+      pid_t child = fork();
+      if (child < 0) {
+	P("Failure in fork():\n%s", strerror(errno));
+      } else if (child == 0) 
+	{
+	  goto fork_done;
+	}
+    }
+  rank = 0;
+
+ fork_done:
+  ID = rank;
+
+  set_cpu(id_to_core[ID]);
+
+  ticks t_init = getticks();
+  ssmp_mem_init(ID, num_procs);
+  t_init = getticks() - t_init;
+
+  ssmp_color_buf_t *cbuf = NULL;
+  if (ID == 0) 
+    {
+      cbuf = (ssmp_color_buf_t *) malloc(sizeof(ssmp_color_buf_t));
+      assert(cbuf != NULL);
+      ssmp_color_buf_init(cbuf, color_client);
+    }
+
+  ssmp_msg_t *msg;
+  msg = (ssmp_msg_t *) memalign(SSMP_CACHE_LINE_SIZE, sizeof(ssmp_msg_t));
+  assert(msg != NULL);
+
+  ssmp_barrier_wait(0);
+
+  /* ********************************************************************************
+     main functionality
+  *********************************************************************************/
+
+  ticks t_start = 0, t_end = 0;
+  if (ID == 0) 
+    {
+      uint32_t total = num_active * num_msgs;
+
+      t_start = getticks();
+      while (total--)
+	{
+	  if (recv_color)
+	    {
+	      ssmp_recv_color_start(cbuf, msg);
+	    }
+	  else
+	    {
+	      ssmp_recv(msg);
+	    }
+	  ssmp_send(msg->sender, msg);
+	}
+      t_end = getticks();
+    }
+  else if (color_active(ID))
+    {
+      uint32_t m;
+      t_start = getticks();
+      for (m = 0; m < num_msgs; m++)
+	{
+	  msg->w0 = m;
+	  ssmp_send(0, msg);
+	  ssmp_recv_from(0, msg);
+	  if (msg->w0 != m) 
+	    {
+	      P("Roundtrip failed: sent %u, recved %d", m, msg->w0);
+	    }
+	}
+      t_end = getticks();
+    }
+
+  ssmp_barrier_wait(0);
+
+  uint32_t co;
+  for (co = 0; co < ssmp_num_ues(); co++)
+    {
+      if (co == ssmp_id())
+	{
+	  if (co == 0)
+	    {
+	      PRINT("mem init    : %llu cycles", (unsigned long long) t_init);
+	      PRINT("server      : %.1f cycles per handled roundtrip", 
+		    (double) (t_end - t_start) / (num_active * num_msgs));
+	    }
+	  else if (color_active(co))
+	    {
+	      PRINT("client      : %.1f cycles per roundtrip", (double) (t_end - t_start) / num_msgs);
+	    }
+	}
+      ssmp_barrier_wait(0);
+    }
+
+  if (ID == 0)
+    {
+      ssmp_color_buf_free(cbuf);
+      free(cbuf);
+    }
+
+  free(msg);
+  ssmp_term();
+  return 0;
+}
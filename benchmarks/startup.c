@@ -0,0 +1,160 @@
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <inttypes.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <sched.h>
+#include <assert.h>
+#include <getopt.h>
+
+#include "common.h"
+#include "ssmp.h"
+#include "measurements.h"
+
+/* 
+   Startup cost: for 2, 4, ... up to num_procs processes, the launcher calls
+   ssmp_init and forks, every other process calls ssmp_mem_init and sends one
+   message to core 0. Core 0 reports the cycles from before ssmp_init to the
+   first and to the last of these messages.
+*/
+
+uint32_t num_procs = 512;
+uint32_t num_reps = 10;
+uint32_t ID;
+
+static void
+startup(uint32_t n, ticks* t_first, ticks* t_all)
+{
+  ticks t_start = getticks();
+  ssmp_init(n);
+
+  uint32_t rank;
+  for (rank = 1; rank < n; rank++) 
+    {
+      pid_t child = fork();
+      if (child < 0) {
+	P("Failure in fork():\n%s", strerror(errno));
+      } else if (child == 0) 
+	{
+	  goto fork_done;
+	}
+    }
+  rank = 0;
+
+ fork_done:
+  ID = rank;
+  set_cpu(id_to_core[ID]);
+  ssmp_mem_init(rank, n);
+
+  ssmp_msg_t msg;
+  if (rank != 0)
+    {
+      ssmp_send(0, &msg);
+      ssmp_term();
+      exit(0);
+    }
+
+  uint32_t m;
+  for (m = 1; m < n; m++)
+    {
+      ssmp_recv(&msg);
+      if (m == 1)
+	{
+	  *t_first = getticks() - t_start;
+	}
+    }
+  *t_all = getticks() - t_start;
+
+  ssmp_term();
+  while (wait(NULL) > 0);
+}
+
+int 
+main(int argc, char **argv) 
+{
+  struct option long_options[] =
+    {
+      // These options don't set a flag
+      {"help",        no_argument, NULL, 'h'},
+      {"num-procs",   required_argument, NULL, 'n'},
+      {"repetitions", required_argument, NULL, 'r'},
+      {NULL, 0, NULL, 0}
+    };
+
+  int i, c;
+  while (1)
+    {
+      i = 0;
+      c = getopt_long(argc, argv, "hn:r:", long_options, &i);
+
+      if (c == -1)
+	break;
+
+      if (c == 0 && long_options[i].flag == 0)
+	c = long_options[i].val;
+
+      switch (c)
+	{
+	case 0:
+	  /* Flag is automatically set */
+	  break;
+	case 'h':
+	  PRINT("startup -- Testing the time from ssmp_init to the first messages\n"
+		"\n"
+		"Usage:\n"
+		"  ./startup [options...]\n"
+		"\n"
+		"Options:\n"
+		"  -h, --help\n"
+		"        Print this message\n"
+		"  -n, --num-procs <int>\n"
+		"        Maximum number of processes (2, 4, ... up to this)\n"
+		"  -r, --repetitions <int>\n"
+		"        Number of startups per number of processes\n"
+		);
+	  exit(0);
+	case 'n':
+	  num_procs = atoi(optarg);
+	  break;
+	case 'r':
+	  num_reps = atoi(optarg);
+	  break;
+	case '?':
+	  PRINT("Use -h or --help for help\n");
+	  exit(0);
+	default:
+	  exit(1);
+	}
+    }
+
+  printf("%-10s %20s %20s\n", "processes", "first msg (cycles)", "all msgs (cycles)");
+
+  uint32_t n;
+  for (n = 2; n <= num_procs; n <<= 1)
+    {
+      double first = 0, all = 0;
+      uint32_t r;
+      for (r = 0; r < num_reps; r++)
+	{
+	  ticks t_first = 0, t_all = 0;
+	  fflush(stdout);
+	  startup(n, &t_first, &t_all);
+	  first += t_first;
+	  all += t_all;
+	}
+
+      printf("%-10u %20.0f %20.0f\n", n, first / num_reps, all / num_reps);
+      if (n < num_procs && (n << 1) > num_procs)
+	{
+	  n = num_procs >> 1;	/* finish with num_procs */
+	}
+    }
+
+  return 0;
+}
@@ -6,5 +6,5 @@
 #define P(args...) printf("[%02d] ", ID); printf(args); printf("\n"); fflush(stdout)
 #define PRINT P
 
-extern uint8_t ID;
+extern uint32_t ID;
 #endif
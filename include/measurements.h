@@ -40,21 +40,9 @@ extern "C" {
 
 extern ticks getticks_correction_calc();
 
+/* ticks per ns, calibrated at run time (see ticks_per_ns in ssmp.h) */
 #ifndef REF_SPEED_GHZ
-#  if defined(OPTERON)
-#    define REF_SPEED_GHZ           2.1
-#  elif defined(XEON)
-#    define REF_SPEED_GHZ           2.1
-#  elif defined(TILERA)
-#    define REF_SPEED_GHZ           1.2
-#  elif defined(NIAGARA)
-#    define REF_SPEED_GHZ           1.17
-#  elif defined(COREi7)
-#    define REF_SPEED_GHZ           2.8
-#  else
-#    warning "Need to set REF_SPEED_GHZ for the platform, using default of 2.1 GHz"
-#    define REF_SPEED_GHZ           2.1
-#  endif
+#  define REF_SPEED_GHZ           ticks_per_ns()
 #endif  /* REF_SPEED_GHZ */
 
 #ifndef DO_TIMINGS
@@ -67,6 +55,9 @@ extern ticks getticks_correction_calc();
 #  define PF_PRINT		/* report results */
 #  define PF_EXCLUDE(pos)    	/* exclude entry from the report */
 #  define PF_CORRECTION 	/* calculate the necessary correction due to getticks */
+#  define PF_PRINT_JSON		/* report results, one JSON object per position */
+#  define PF_MERGE		/* merge the results of all processes on process 0 */
+#  define PF_SAMPLE(pos, t)	/* add a sample of t ticks to position pos */
 #else
 #define DO_TIMINGS_TICKS
 #  define PF_MSG(pos, msg)        SET_PROF_MSG_POS(pos, msg)
@@ -76,12 +67,16 @@ extern ticks getticks_correction_calc();
 #  define PF_PRINT                REPORT_TIMINGS_SECS
 #  define PF_EXCLUDE(pos)         EXCLUDE_ENTRY(pos)
 #  define PF_CORRECTION           MEASUREREMENT_CORRECTION
+#  define PF_PRINT_JSON           REPORT_TIMINGS_JSON
+#  define PF_MERGE                REPORT_TIMINGS_MERGE
+#  define PF_SAMPLE(pos, t)       ADD_SAMPLE_POS(pos, t)
 #endif
 
 #define PFIN                    PF_START
 #define PFOUT                   PF_STOP
 
 #include <stdio.h>
+#include <string.h>
 #include <math.h>
 
 #if defined DO_TIMINGS_TICKS
@@ -99,6 +94,57 @@ extern ticks getticks_correction_calc();
   extern uint64_t total_sum_ticks[ENTRY_TIMES_SIZE];
   extern long long total_samples[ENTRY_TIMES_SIZE];
   extern const char *measurement_msgs[ENTRY_TIMES_SIZE];
+
+/* log-linear histogram of the samples of every position: values below
+   PF_HIST_SUB have one bucket each, then every power of two is split in
+   PF_HIST_SUB buckets, hence a bucket is at most 1/PF_HIST_SUB (~3%) wide */
+#  define PF_HIST_SUB_BITS 5
+#  define PF_HIST_SUB      (1 << PF_HIST_SUB_BITS)
+#  define PF_HIST_BUCKETS  ((64 - PF_HIST_SUB_BITS + 1) << PF_HIST_SUB_BITS)
+
+  extern uint64_t pf_hist[ENTRY_TIMES_SIZE][PF_HIST_BUCKETS];
+  extern uint64_t pf_max_ticks[ENTRY_TIMES_SIZE];
+
+  static inline uint32_t
+  pf_hist_bucket(uint64_t v)
+  {
+    if (v < PF_HIST_SUB)
+      {
+	return (uint32_t) v;
+      }
+    uint32_t e = 63 - __builtin_clzll(v);
+    return ((e - PF_HIST_SUB_BITS + 1) << PF_HIST_SUB_BITS) + ((v >> (e - PF_HIST_SUB_BITS)) & (PF_HIST_SUB - 1));
+  }
+
+  /* whether every sample of pos is in its histogram, i.e., it was not timed
+     as a whole loop with total_samples set by hand */
+  extern int pf_has_percentiles(int pos);
+  /* the value at quantile q (0 < q <= 1) of position pos, in ticks (0 for a
+     position without percentiles) */
+  extern ticks pf_percentile(int pos, double q);
+  extern void pf_print_percentiles(int pos);
+  extern void pf_print_json(int start, int end);
+  extern void pf_merge(int start, int end);
+
+/* hardware counters (Linux perf_event), selected with the environment variable
+   SSMP_PF_EVENTS, e.g., "instructions,cache-misses,r01d2" (see pf_pmu_init):
+   opened by the first PF_START of every process and read with rdpmc when the
+   kernel permits it. Unset, PF_START / PF_STOP only test pf_pmu_state_ */
+#  define PF_PMU_MAX 4
+
+  enum pf_pmu_state_t {
+    PF_PMU_OFF, PF_PMU_ON, PF_PMU_UNINIT
+  };
+
+  extern enum pf_pmu_state_t pf_pmu_state_;
+  extern uint32_t pf_pmu_num;
+  extern const char* pf_pmu_names[PF_PMU_MAX];
+  extern uint64_t pf_pmu_sum[ENTRY_TIMES_SIZE][PF_PMU_MAX];
+  extern void pf_pmu_init(void);
+  extern void pf_pmu_entry(int pos);
+  extern void pf_pmu_exit(int pos);
+  extern void pf_pmu_print(int pos);
+
 #  define MEASUREREMENT_CORRECTION getticks_correction_calc();
 #  define SET_PROF_MSG(msg) SET_PROF_MSG_POS(0, msg) 
 #  define ENTRY_TIME ENTRY_TIME_POS(0)
@@ -109,22 +155,44 @@ extern ticks getticks_correction_calc();
 
 #  define ENTRY_TIME_POS(position)					\
 do {									\
-  entry_time[position] = getticks();					\
+  if (pf_pmu_state_ != PF_PMU_OFF) {					\
+    pf_pmu_entry(position);						\
+  }									\
+  entry_time[position] = getticks_fenced();				\
   entry_time_valid[position] = M_TRUE;					\
 } while (0);
 
+#  define ADD_SAMPLE_POS(position, t)					\
+  do {									\
+    ticks _pf_t = (t);							\
+    total_sum_ticks[position] += _pf_t;					\
+    total_samples[position]++;						\
+    pf_hist[position][pf_hist_bucket(_pf_t)]++;				\
+    if (_pf_t > pf_max_ticks[position]) {				\
+      pf_max_ticks[position] = _pf_t;					\
+    }									\
+  } while (0)
+
 #  define EXIT_TIME_POS(position)					\
   do {									\
-    ticks exit_time = getticks();					\
+    ticks exit_time = getticks_fenced();				\
     if (entry_time_valid[position]) {					\
       entry_time_valid[position] = M_FALSE;				\
-      total_sum_ticks[position] += (exit_time - entry_time[position] - getticks_correction); \
-      total_samples[position]++;					\
+      ticks _pf_d = exit_time - entry_time[position];			\
+      _pf_d = (_pf_d > getticks_correction) ? _pf_d - getticks_correction : 0; \
+      ADD_SAMPLE_POS(position, _pf_d);					\
+      if (pf_pmu_state_ == PF_PMU_ON) {					\
+	pf_pmu_exit(position);						\
+      }									\
 }} while (0);
 
 #  define EXCLUDE_ENTRY(position)                                         \
         do {                                                            \
         total_samples[position] = 0;                                    \
+        total_sum_ticks[position] = 0;                                  \
+        memset(pf_hist[position], 0, sizeof(pf_hist[position]));        \
+        pf_max_ticks[position] = 0;                                     \
+        memset(pf_pmu_sum[position], 0, sizeof(pf_pmu_sum[position]));  \
         } while(0);
 
 #  ifndef _MEASUREMENTS_ID_
@@ -141,6 +209,8 @@ do {									\
 	printf("[%02d]%s:\n", i, measurement_msgs[i]);			\
 	printf("  samples: %-16llu| ticks: %-16llu| avg ticks: %-16llu\n", \
 		total_samples[i], total_sum_ticks[i], total_sum_ticks[i] / total_samples[i]);\
+	pf_print_percentiles(i);					\
+	pf_pmu_print(i);						\
         }                                                               \
     }                                                                   \
 }                                                                       \
@@ -155,8 +225,8 @@ while (0);
       if (total_samples[i]) {						\
 	printf("[%02d]%s:\n", i, measurement_msgs[i]);			\
 	printf("  samples: %-16llu | secs: %-4.10f | avg ticks: %-4.10f\n", \
-	       total_samples[i], total_sum_ticks[i] / (REF_SPEED_GHZ * 1.e9), \
-	       (total_sum_ticks[i] / total_samples[i])/ (REF_SPEED_GHZ * 1.e9)); \
+	       total_samples[i], ticks_to_secs(total_sum_ticks[i]),		\
+	       ticks_to_secs(total_sum_ticks[i] / total_samples[i]));		\
       }									\
     }                                                                   \
   }									\
@@ -168,6 +238,9 @@ while (0);
 #  define REPORT_TIMINGS_SECS_RANGE(start,end)	\
         prints_ticks_stats(start, end);
 
+#  define REPORT_TIMINGS_JSON pf_print_json(0, ENTRY_TIMES_SIZE);
+#  define REPORT_TIMINGS_MERGE pf_merge(0, ENTRY_TIMES_SIZE);
+
 
 #else  /* !DO_TIMINGS_TICKS */
 #  define ENTRY_TIME
@@ -176,6 +249,9 @@ while (0);
 #  define REPORT_TIMINGS_RANGE(x,y)
 #  define ENTRY_TIME_POS(X)
 #  define EXIT_TIME_POS(X)
+#  define ADD_SAMPLE_POS(X, t)
+#  define REPORT_TIMINGS_JSON
+#  define REPORT_TIMINGS_MERGE
 #endif
 
 #ifdef	__cplusplus
@@ -34,6 +34,7 @@
 #include <sys/stat.h>
 #include <sys/mman.h>
 #include <sys/time.h>
+#include <time.h>
 #include <unistd.h>
 #include <stdlib.h>
 #include <stdio.h>
@@ -43,6 +44,7 @@
 #include <sched.h>
 #include <inttypes.h>
 #include <malloc.h>
+#include <stdatomic.h>
 
 #define SSMP 1
 
@@ -53,18 +55,57 @@
 /* ------------------------------------------------------------------------------- */
 /* settings */
 /* ------------------------------------------------------------------------------- */
-#define SSMP_MEM_NAME        "/ssmp_mem2"
-#define USE_ATOMIC           0		/* set to 1 to use atomic ops for synchronizing
-					   msg flags */
 #define SSMP_NUM_BARRIERS    16 /* number of available barriers */
+#define SSMP_MAX_UES         1024 /* max number of processes */
 #define SSMP_CACHE_LINE_SIZE 64
 #define SSMP_FLAG_TYPE       volatile uint8_t
 
+/*
+  memory ordering of the flags (make ORDER=<mode>). The flag (state) of a buffer is
+  the only synchronization of a message: the writer copies the data, then stores
+  the flag; the reader loads the flag, then reads the data. The flags are accessed
+  with the C11 atomics of <stdatomic.h>:
+  SSMP_ORDER_ACQ_REL  acquire loads, release stores (default). On x86 and sparc
+                      (TSO) both are plain moves: no fence, the compiler only keeps
+                      the data before the store / after the load
+  SSMP_ORDER_SEQ_CST  sequentially consistent loads and stores: every store of a
+                      flag is an xchg on x86 (the full fence of the mfence presets)
+  SSMP_ORDER_RMW      acquire / release, and the receivers take the messages with
+                      compare-and-swap (SSMP_PRESET_CAS) by default
+*/
+#define SSMP_ORDER_ACQ_REL   0
+#define SSMP_ORDER_SEQ_CST   1
+#define SSMP_ORDER_RMW       2
+#ifndef SSMP_ORDER
+#  define SSMP_ORDER         SSMP_ORDER_ACQ_REL
+#endif
+
+#if SSMP_ORDER == SSMP_ORDER_SEQ_CST
+#  define SSMP_ORDER_LOAD    memory_order_seq_cst
+#  define SSMP_ORDER_STORE   memory_order_seq_cst
+#else
+#  define SSMP_ORDER_LOAD    memory_order_acquire
+#  define SSMP_ORDER_STORE   memory_order_release
+#endif
+
+#define SSMP_FLAG_ATOMIC(f)     ((volatile _Atomic uint8_t*) (f))
+#define SSMP_FLAG_LOAD(f)       atomic_load_explicit(SSMP_FLAG_ATOMIC(f), SSMP_ORDER_LOAD)
+#define SSMP_FLAG_STORE(f, v)   atomic_store_explicit(SSMP_FLAG_ATOMIC(f), (v), SSMP_ORDER_STORE)
+
+/* 1 if *flag was old (and is now new) */
+static inline int
+ssmp_flag_cas(SSMP_FLAG_TYPE* flag, uint8_t old, uint8_t new)
+{
+  uint8_t expected = old;
+  return atomic_compare_exchange_strong_explicit(SSMP_FLAG_ATOMIC(flag), &expected, new,
+						 memory_order_acq_rel, memory_order_acquire);
+}
+
 /* ------------------------------------------------------------------------------- */
 /* defines */
 /* ------------------------------------------------------------------------------- */
 
-extern uint8_t id_to_core[];
+extern uint32_t id_to_core[];
 extern const uint8_t node_to_node_hops[8][8];
 typedef uint64_t ticks;
 
@@ -72,6 +113,13 @@ typedef uint64_t ticks;
 #define SSMP_BUF_MESSG       1
 #define SSMP_BUF_LOCKD       2
 
+/* options of ssmp_init_opt */
+#define SSMP_OPT_PREFAULT    0x1 /* ssmp_mem_init maps and locks the message memory */
+#define SSMP_OPT_WARMUP      0x2 /* ssmp_mem_init sends a message over every pair */
+#define SSMP_OPT_CLOCK_SYNC  0x4 /* ssmp_mem_init calls ssmp_clock_sync */
+#define SSMP_OPT_AUTOTUNE    0x8 /* ssmp_init loads (or measures) the protocol profile, see ssmp_tune */
+#define SSMP_OPT_SEQ         0x10 /* ssmp_init maps the rings of ssmp_seq_send / ssmp_seq_recv_from */
+
 #ifdef SSMP_DEBUG
 #  define PD(args...) printf("[%d] ", ssmp_id_); printf(args); printf("\n"); fflush(stdout)
 #else
@@ -118,6 +166,9 @@ typedef struct
   SSMP_FLAG_TYPE state;
 } ssmp_chunk_t;
 
+/* usable bytes of a chunk (the last byte is the state flag) */
+#define SSMP_CHUNK_DATA (SSMP_CHUNK_SIZE - 1)
+
 
 /*
   type used for color-based function, i.e. functions that operate
@@ -128,17 +179,107 @@ typedef struct ALIGNED(SSMP_CACHE_LINE_SIZE) ssmp_color_buf_struct
   uint64_t num_ues;
   SSMP_FLAG_TYPE** buf_state;
   volatile ssmp_msg_t** buf;
-  uint8_t* from;
+  uint32_t* from;
+  uint32_t start_recv_from;	/* where the next ssmp_recv_color_start starts from (a
+				   core id when receiving through the doorbell) */
+  uint64_t* mask;		/* the senders, as a bitmap of core ids (doorbell receive) */
 } ssmp_color_buf_t;
 
+/*
+  how a core exchanges messages with a peer: how it waits for the flag of the
+  buffer, and how it then updates the flag. ssmp_mem_init fills the entry of every
+  peer (ssmp_proto_peer) from the topology class of the two cores and the preset of
+  the class (the platform default, or the fastest one on this machine, see
+  ssmp_tune), so that send and receive only call through the entry
+*/
+#define SSMP_WAIT_LOAD       0	/* poll the flag with loads */
+#define SSMP_WAIT_LFENCE     1	/* loads, each followed by an lfence (not needed for the
+				   ordering: the acquire load keeps the data after it) */
+#define SSMP_WAIT_CAS        2	/* compare-and-swap the flag to SSMP_BUF_LOCKD, SSMP_WAIT_TIME
+				   cycles between tries */
+#define SSMP_WAIT_NUM        3
+
+#define SSMP_BACKOFF_NONE    0
+#define SSMP_BACKOFF_PAUSE   1	/* a pause between the polls */
+#define SSMP_BACKOFF_RAMP    2	/* 0, 1, .. 63 pauses between the polls */
+#define SSMP_BACKOFF_NUM     3
+
+#define SSMP_UPDATE_STORE    0	/* a (release) store */
+#define SSMP_UPDATE_MFENCE   1	/* a store and a full fence (mfence) */
+#define SSMP_UPDATE_XCHG     2	/* an atomic exchange */
+#define SSMP_UPDATE_NUM      3
+
+typedef struct ssmp_proto
+{
+  void (*wait_fn)(SSMP_FLAG_TYPE* flag, uint8_t value); /* until *flag is value */
+  int (*poll_fn)(SSMP_FLAG_TYPE* flag, uint8_t value);	/* one poll of wait_fn: 1 if *flag was value */
+  void (*update_fn)(SSMP_FLAG_TYPE* flag, uint8_t value); /* set *flag to value */
+  uint8_t wait;			/* SSMP_WAIT_* */
+  uint8_t backoff;		/* SSMP_BACKOFF_* */
+  uint8_t prefetch;		/* 1: prefetchw (x86) the line before every poll */
+  uint8_t update;		/* SSMP_UPDATE_* */
+  uint8_t fast;			/* 1: loads and a store (no CAS, no XCHG), the inline fast
+				   path can take the buffer (see ssmp_x86_inline.h) */
+} ssmp_proto_t;
+
+/* named settings of ssmp_proto_t, the candidates of ssmp_tune */
+typedef struct ssmp_proto_preset
+{
+  const char* name;
+  uint8_t wait, backoff, prefetch, update;
+} ssmp_proto_preset_t;
+
+#define SSMP_PRESET_SPIN           0 /* loads */
+#define SSMP_PRESET_PAUSE          1 /* loads and pause (generic) */
+#define SSMP_PRESET_BACKOFF        2 /* loads, lfence and pauses (Xeon, same socket) */
+#define SSMP_PRESET_PREFETCHW      3 /* prefetchw, loads and pauses (Opteron) */
+#define SSMP_PRESET_CAS            4 /* compare-and-swap (SSMP_ORDER_RMW; Xeon, across sockets) */
+#define SSMP_PRESET_BACKOFF_MFENCE 5 /* backoff, mfence after updates */
+#define SSMP_PRESET_CAS_MFENCE     6 /* cas, mfence after updates */
+#define SSMP_PRESET_NUM            7
+
+/* the topology classes of two cores */
+#define SSMP_TOPO_SMT        0	/* hyper-threads of the same core */
+#define SSMP_TOPO_L3         1	/* cores that share the last-level cache */
+#define SSMP_TOPO_SOCKET     2	/* other cores of the same socket */
+#define SSMP_TOPO_REMOTE     3	/* cores of different sockets */
+#define SSMP_TOPO_NUM        4
+
+/*
+  group of cores, the equivalent of an MPI communicator. The members are numbered
+  with local ranks 0 .. num_ues - 1. Everything that a group operation needs
+  (members, receive buffers, the schedule of the collectives) is computed once,
+  when the group is created.
+*/
+#define SSMP_GROUP_NONE      -1 /* split color of the cores that join no group */
+
+typedef struct ALIGNED(SSMP_CACHE_LINE_SIZE) ssmp_group_struct
+{
+  uint32_t num_ues;		/* number of members */
+  int32_t rank;			/* local rank of this core, -1 if not a member (a non member
+				   can still receive from the members) */
+  uint32_t* members;		/* local rank -> core id */
+  int32_t* rank_of;		/* core id -> local rank, -1 for non members */
+  uint32_t* steps;		/* the steps of the pairwise exchange (alltoall) */
+  uint32_t* local_first;	/* the other members, the ones on our socket first */
+  char* scratch;		/* the blocks of the allgather, grown on demand */
+  size_t scratch_size;
+  ssmp_color_buf_t cbuf;	/* the receive buffers of the other members */
+} ssmp_group_t;
+
 /* ------------------------------------------------------------------------------- */
 /* init / term the MP system */
 /* ------------------------------------------------------------------------------- */
 
-/* initialize the system: called before forking */
+/* initialize the system: called before forking, the processes inherit its memory */
 extern void ssmp_init(int num_procs);
+/* as ssmp_init, with SSMP_OPT_* options */
+extern void ssmp_init_opt(int num_procs, int opts);
 /* initilize the memory structures of the system: called by every proc after forking  */
 extern void ssmp_mem_init(int id, int num_ues);
+/* as ssmp_mem_init, but only the cores in peers can send to this core: only their
+   buffers are touched and polled */
+extern void ssmp_mem_init_peers(int id, int num_ues, const uint32_t* peers, uint32_t num_peers);
 /* terminate the system */
 extern void ssmp_term(void);
 
@@ -163,6 +304,59 @@ extern inline void ssmp_send_big(int to, void* data, size_t length);
 /* broadcast msg to every other core */
 extern inline void ssmp_broadcast(ssmp_msg_t* msg);
 
+/* ------------------------------------------------------------------------------- */
+/* groups */
+/* ------------------------------------------------------------------------------- */
+
+/* the group of all cores */
+extern ssmp_group_t* ssmp_group_world();
+/* collective over the members of parent (like MPI_Comm_split): the members that
+   give the same color form group, where they are ranked by key (ties: by rank in
+   parent). Members with color SSMP_GROUP_NONE get an empty group */
+extern void ssmp_group_split(ssmp_group_t* parent, int color, int key, ssmp_group_t* group);
+/* local (non collective) creation: the members are the cores for which color(id)
+   returns 1, ranked by core id. color is only called while creating the group.
+   Replaces ssmp_color_buf_init: this core does not need to be a member in order
+   to receive from the members */
+extern void ssmp_group_init_color(ssmp_group_t* group, int (*color)(int));
+extern void ssmp_group_free(ssmp_group_t* group);
+
+/* blocking receive from any other member of the group. Sender (core id) at msg->sender */
+extern inline void ssmp_recv_group(ssmp_group_t* group, ssmp_msg_t* msg);
+/* fair version: starts from the member after the last sender */
+extern inline void ssmp_recv_group_start(ssmp_group_t* group, ssmp_msg_t* msg);
+/* dissemination barrier: log2(num_ues) rounds, on flags of its own (not the
+   message buffers, so messages may be in flight) */
+extern void ssmp_group_barrier(ssmp_group_t* group);
+
+/* ------------------------------------------------------------------------------- */
+/* collective functions */
+/* ------------------------------------------------------------------------------- */
+
+/* All cores must call the collectives in the same order, without outstanding
+   point-to-point messages between them. length is the size (in bytes) of the
+   data block of a single core. Blocks that fit in a message go through the
+   message buffers, bigger ones through the big-message (chunk) path. 
+   The ssmp_group_* versions operate on the members of a group; root and the
+   block order are in local ranks. */
+
+extern void ssmp_group_gather(ssmp_group_t* group, int root, void* sdata, void* rdata, size_t length);
+extern void ssmp_group_scatter(ssmp_group_t* group, int root, void* sdata, void* rdata, size_t length);
+extern void ssmp_group_allgather(ssmp_group_t* group, void* sdata, void* rdata, size_t length);
+extern void ssmp_group_alltoall(ssmp_group_t* group, void* sdata, void* rdata, size_t length);
+
+/* root receives the length bytes of sdata of every core in rdata (num_ues * length),
+   ordered by core id */
+extern void ssmp_gather(int root, void* sdata, void* rdata, size_t length);
+/* root sends the id-th block of length bytes of sdata (num_ues * length) to core id */
+extern void ssmp_scatter(int root, void* sdata, void* rdata, size_t length);
+/* every core receives the blocks of all cores in rdata (num_ues * length). Bruck's
+   algorithm: log2(num_ues) steps */
+extern void ssmp_allgather(void* sdata, void* rdata, size_t length);
+/* core i sends the j-th block of sdata to core j, which stores it as the i-th block
+   of rdata. Pairwise exchange: num_ues - 1 steps */
+extern void ssmp_alltoall(void* sdata, void* rdata, size_t length);
+
 /* ------------------------------------------------------------------------------- */
 /* receiving functions (blocking) */
 /* ------------------------------------------------------------------------------- */
@@ -175,10 +369,61 @@ extern inline void ssmp_recv_from_big(int from, void* data, size_t length);
 /* blocking receive from any other process. Sender at msg->sender */
 extern inline void ssmp_recv(ssmp_msg_t* msg);
 
+/* ------------------------------------------------------------------------------- */
+/* tagged messages (not on the Tilera) */
+/* ------------------------------------------------------------------------------- */
+
+#define SSMP_ANY_SOURCE -1
+#define SSMP_ANY_TAG    -1
+/* buckets (power of 2) of the hash table on the tag of the unexpected messages */
+#define SSMP_TAG_HASH_SIZE 64
+
+/* send msg to core to with tag (>= 0) */
+extern inline void ssmp_send_tag(uint32_t to, ssmp_msg_t* msg, int tag);
+/* blocking receive of the oldest message from core from (or SSMP_ANY_SOURCE) with
+   tag (or SSMP_ANY_TAG). The non matching messages that arrive in the meantime are
+   kept in the unexpected queue; the messages of a sender are received in send order.
+   Sender at msg->sender, tag at msg->tag. Do not mix with the untagged receives on
+   the same senders: they do not see the unexpected queue */
+extern void ssmp_recv_tag(int from, int tag, ssmp_msg_t* msg);
+/* non-blocking: if a matching message is available, copy it to msg (with sender and
+   tag) without consuming it and return 1, else return 0 */
+extern int ssmp_probe(int from, int tag, ssmp_msg_t* msg);
+
+/* ------------------------------------------------------------------------------- */
+/* sequence-numbered rings (SSMP_OPT_SEQ, see ssmp_seq.c) */
+/* ------------------------------------------------------------------------------- */
+
+#ifndef SSMP_SEQ_SLOTS		/* messages in flight from a core to another */
+#  define SSMP_SEQ_SLOTS     8
+#endif
+#ifndef SSMP_SEQ_ACK_BATCH	/* the receiver acknowledges every .. messages (<= SSMP_SEQ_SLOTS) */
+#  define SSMP_SEQ_ACK_BATCH ((SSMP_SEQ_SLOTS + 1) / 2)
+#endif
+
+/* the accesses of this core to the ack lines */
+typedef struct ssmp_seq_counters
+{
+  uint64_t ack_loads;		/* a send read the ack line (the ring looked full) */
+  uint64_t ack_misses;		/* reads that found a new count: the line came from the receiver */
+  uint64_t ack_stores;		/* the receiver wrote an ack line */
+} ssmp_seq_counters_t;
+extern ssmp_seq_counters_t ssmp_seq_counters;
+
+/* the messages of a pair of cores go either through these or through the other
+   functions, never both. ssmp_seq_send blocks while SSMP_SEQ_SLOTS messages are in
+   flight; the receiver never writes to the line of a message */
+extern void ssmp_seq_send(uint32_t to, volatile ssmp_msg_t* msg);
+extern int ssmp_seq_send_is_free(uint32_t to);
+extern void ssmp_seq_recv_from(uint32_t from, volatile ssmp_msg_t* msg);
+extern int ssmp_seq_recv_is_ready(uint32_t from);
+
 /* ------------------------------------------------------------------------------- */
 /* color-based recv fucntions */
 /* ------------------------------------------------------------------------------- */
 
+/* (the group functions supersede these: a group caches the same buffers) */
+
 /* initialize the color buf data structure to be used with consequent ssmp_recv_color
    calls. A node is considered a participant if the call to color(ID) returns 1 */
 extern void ssmp_color_buf_init(ssmp_color_buf_t* cbuf, int (*color)(int));
@@ -197,9 +442,12 @@ extern inline void ssmp_recv_color_start(ssmp_color_buf_t* cbuf, ssmp_msg_t* msg
 extern int ssmp_color_app(int id);
 
 extern inline ssmp_barrier_t*  ssmp_get_barrier(int barrier_num);
-/* initialize a barrier. The participants of the barrier can be provided either as a bitmap (supports
- upto 64 participants), or as a color function. The color function has priority over the bitmap. */
+/* initialize a barrier. The participants of the barrier can be provided either as a bitmap (of
+ cores 0 .. 63, all ones means all cores), or as a color function. The color function has
+ priority over the bitmap. The number of participants is computed once, here. */
 extern inline void ssmp_barrier_init(int barrier_num, long long int participants, int (*color)(int));
+/* initialize a barrier with a bitmap of any number of cores: bit (id % 64) of participants[id / 64] */
+extern void ssmp_barrier_init_mask(int barrier_num, const uint64_t* participants);
 /* wait on a barrier until all participants reach this call*/
 extern inline void ssmp_barrier_wait(int barrier_num);
 
@@ -222,8 +470,24 @@ extern void set_cpu(int cpu);
 
 /* get the value of the timestamp counter of the core */
 extern inline ticks getticks(void);
-/* the cost (in cycles) of a getticks call */
+/* getticks, not reordered with the instructions around it (for measurements) */
+extern inline ticks getticks_fenced(void);
+/* the cost (in cycles) of a getticks_fenced call */
 extern ticks getticks_correction;
+/* the frequency of getticks: calibrated by ssmp_init (or by the first call), from
+   CPUID leaf 0x15 on x86 or measured against CLOCK_MONOTONIC_RAW. The environment
+   variable SSMP_TSC_GHZ overrides it */
+extern double ticks_per_ns(void);
+extern double ticks_to_ns(ticks t);
+extern double ticks_to_secs(ticks t);
+
+/* estimate the offset of the ticks of every core to the ticks of core 0 over
+   messages: all cores call it, without pending messages */
+extern void ssmp_clock_sync(void);
+/* the ticks of this core minus the ticks of core 0 (0 before ssmp_clock_sync) */
+extern int64_t ssmp_clock_offset(void);
+/* getticks_fenced, in the time base of core 0 */
+extern inline ticks getticks_global(void);
 
 /* round up to next higher power of 2 (return x if it's already a power
    of 2) for 32-bit numbers */
@@ -254,6 +518,41 @@ xorshf96(unsigned long* x, unsigned long* y, unsigned long* z)
   return *z;
 }
 
+/* ------------------------------------------------------------------------------- */
+/* the protocol per peer */
+/* ------------------------------------------------------------------------------- */
+
+/* the protocol of every peer of this core: filled by ssmp_mem_init */
+extern ssmp_proto_t ssmp_proto_peer[SSMP_MAX_UES];
+/* the preset of every topology class (SSMP_TOPO_*), inherited by the forked processes */
+extern uint8_t ssmp_proto_class_preset[SSMP_TOPO_NUM];
+extern const ssmp_proto_preset_t ssmp_proto_presets[SSMP_PRESET_NUM];
+extern const char* ssmp_topo_names[SSMP_TOPO_NUM];
+/* the cycles of a roundtrip with every preset, per class (0: not measured) */
+extern double ssmp_proto_cycles[SSMP_TOPO_NUM][SSMP_PRESET_NUM];
+
+/* the topology class of two core ids: SMT and L3 from the sysfs of Linux, the
+   socket from the platform (ssmp_cores_on_same_socket) */
+extern int ssmp_proto_class(uint32_t id1, uint32_t id2);
+/* set up p (the functions too) from a preset */
+extern void ssmp_proto_make(ssmp_proto_t* p, const ssmp_proto_preset_t* preset);
+/* read the topology of cores 0 .. num_procs - 1: called by ssmp_init, before forking */
+extern void ssmp_proto_topo_init(int num_procs);
+/* fill ssmp_proto_peer for core id */
+extern void ssmp_proto_init(int id, int num_ues);
+
+/* load the profile of this machine, or (if there is none, or force) measure a
+   roundtrip with every preset on a pair of cores of every class, keep the fastest
+   and write the profile. Called before forking. The profile is the file in the
+   environment variable SSMP_PROFILE, else $HOME/.ssmp_profile. Returns 1 if the
+   presets were measured, 0 if they were loaded */
+extern int ssmp_tune(int force);
+/* the path of the profile */
+extern const char* ssmp_tune_profile(void);
+
+/* the platform the library runs as (e.g., "generic", "opteron", "xeon" on x86:
+   detected at startup, or given in the environment variable SSMP_PLATFORM) */
+extern const char* ssmp_platform_name(void);
 /* returns 1 if the two cores are on the same socket, else 0 */
 extern inline uint32_t ssmp_cores_on_same_socket(uint32_t core1, uint32_t core2);
 /* get the ssmp_id_ */
@@ -268,12 +567,21 @@ extern inline int ssmp_num_ues();
 
 extern void ssmp_init_platf(int num_procs);
 extern void ssmp_mem_init_platf(int id, int num_ues);
+extern void ssmp_mem_init_peers_platf(int id, int num_ues, const uint32_t* peers, uint32_t num_peers);
+extern void ssmp_group_init(int num_procs);
+extern void ssmp_group_world_init(void);
+extern void ssmp_group_term(void);
+extern void ssmp_coll_schedule(ssmp_group_t* group);
 extern void ssmp_term_platf(void);
+extern void ssmp_seq_init(int num_procs);
+extern void ssmp_seq_mem_init(int id, int num_ues);
+extern void ssmp_seq_term(void);
 extern inline void ssmp_send_platf(uint32_t to, volatile ssmp_msg_t* msg);
 extern inline int ssmp_send_is_free_platf(uint32_t to);
 extern inline void ssmp_send_no_sync_platf(uint32_t to, volatile ssmp_msg_t* msg);
 extern inline void ssmp_send_big_platf(int to, void* data, size_t length);
 extern inline void ssmp_recv_from_platf(uint32_t from, volatile ssmp_msg_t* msg);
+extern inline int ssmp_recv_is_ready_platf(uint32_t from);
 extern inline void ssmp_recv_from_big_platf(int from, void* data, size_t length);
 extern inline void ssmp_recv_platf(ssmp_msg_t* msg);
 extern void ssmp_color_buf_init_platf(ssmp_color_buf_t* cbuf, int (*color)(int));
@@ -281,9 +589,37 @@ extern void ssmp_color_buf_free_platf(ssmp_color_buf_t* cbuf);
 extern inline void ssmp_recv_color_platf(ssmp_color_buf_t* cbuf, ssmp_msg_t* msg);
 extern inline void ssmp_recv_color_start_platf(ssmp_color_buf_t* cbuf, ssmp_msg_t* msg);
 extern inline void ssmp_barrier_init_platf(int barrier_num, long long int participants, int (*color)(int));
+extern void ssmp_barrier_init_mask_platf(int barrier_num, const uint64_t* participants);
 extern inline void ssmp_barrier_wait_platf(int barrier_num);
 extern void set_cpu_platf(int cpu);
 extern void set_numa_platf(int cpu);
+extern inline uint32_t ssmp_cores_on_same_socket_platf(uint32_t core1, uint32_t core2);
 extern inline ticks getticks_platf(void);
+extern inline ticks getticks_fenced_platf(void);
+/* the frequency of getticks if the platform reports it, otherwise 0 */
+extern double ticks_per_ns_platf(void);
+
+#include "ssmp_stats.h"
+#include "ssmp_trace.h"
+
+/* ssmp_send_inline, ssmp_recv_from_inline, ssmp_recv_from_try_inline: the
+   fast path of send and receive, inlined into the application */
+#if defined(__x86_64__) | defined(__i386__)
+#  include "ssmp_x86_inline.h"
+#else
+#  define ssmp_send_inline      ssmp_send
+#  define ssmp_recv_from_inline ssmp_recv_from
+
+static inline int
+ssmp_recv_from_try_inline(uint32_t from, volatile ssmp_msg_t* msg)
+{
+  if (!ssmp_recv_is_ready_platf(from))
+    {
+      return 0;
+    }
+  ssmp_recv_from(from, msg);
+  return 1;
+}
+#endif
 
 #endif
@@ -35,7 +35,8 @@
 #include <sys/processor.h>
 #include <sys/procset.h>
 
-#if defined(__sparcv8)
+#if defined(SSMP_CHUNK_SIZE)
+#elif defined(__sparcv8)
 #  define SSMP_CHUNK_SIZE 1024
 #else
 #  define SSMP_CHUNK_SIZE 8192
@@ -55,6 +56,7 @@
 #else
 #  define SSMP_CACHE_LINE_DW   7
 #endif
+#define SSMP_MSG_PAYLOAD (SSMP_CACHE_LINE_DW * 8) /* bytes copied by memcpy64 */
 
 #define _mm_pause() PAUSE
 
@@ -65,21 +67,21 @@ typedef struct ALIGNED(SSMP_CACHE_LINE_SIZE) ssmp_msg
   int32_t w1;
   int32_t w2;
   int32_t w3;
-  uint8_t pad[3];
   union 
   {
     SSMP_FLAG_TYPE state;
-    volatile uint8_t sender;
+    volatile uint32_t sender;
   };
+  uint32_t tag;			/* set by ssmp_send_tag */
 } ssmp_msg_t;
 
 typedef struct ALIGNED(SSMP_CACHE_LINE_SIZE) ssmp_buf
 {
-  char data[19];
+  char data[16];
   union 
   {
     SSMP_FLAG_TYPE state;
-    volatile uint8_t sender;
+    volatile uint32_t sender;
   };
 } ssmp_buf_t;
 #else
@@ -98,17 +100,17 @@ typedef struct ALIGNED(SSMP_CACHE_LINE_SIZE) ssmp_msg
   {
     SSMP_FLAG_TYPE state;
     volatile uint32_t sender;
-    volatile uint64_t pad;
   };
+  uint32_t tag;			/* set by ssmp_send_tag */
 } ssmp_msg_t;
 
 typedef struct ALIGNED(SSMP_CACHE_LINE_SIZE) ssmp_buf
 {
-  char data[SSMP_CACHE_LINE_SIZE - 1];
+  char data[SSMP_CACHE_LINE_SIZE - 4];
   union 
   {
     SSMP_FLAG_TYPE state;
-    volatile uint8_t sender;
+    volatile uint32_t sender;
   };
 } ssmp_buf_t;
 #endif
@@ -116,12 +118,14 @@ typedef struct ALIGNED(SSMP_CACHE_LINE_SIZE) ssmp_buf
 /* barrier type */
 typedef struct ALIGNED(SSMP_CACHE_LINE_SIZE)
 {
-  volatile uint64_t participants; /* the participants of a barrier can be given
-				     either by this, as bits (0 -> no, 1 ->participate */
+  volatile uint64_t participants[SSMP_MAX_UES / 64]; /* the participants of a barrier can be
+						       given either by this, as bits (0 -> no,
+						       1 ->participate, bit id % 64 of word id / 64) */
   int (*color)(int); /* or as a color function: if the function return 0 -> no participant, 
 			1 -> participant. The color function has priority over the lluint participants*/
   volatile uint32_t ticket;
   volatile uint32_t cleared;
+  uint32_t num_participants;	/* computed by ssmp_barrier_init */
 } ssmp_barrier_t;
 
 static inline void
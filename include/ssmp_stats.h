@@ -0,0 +1,140 @@
+/*   
+ *   File: ssmp_stats.h
+ *   Author: Vasileios Trigonakis <vasileios.trigonakis@epfl.ch>
+ *   Description: per-core live statistics, read by ssmp_stat
+ *   ssmp_stats.h is part of ssmp
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (C) 2013  Vasileios Trigonakis
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef _SSMP_STATS_H_
+#define _SSMP_STATS_H_
+
+/* 
+   With SSMP_STATS (make STATS=1, the default), every core counts its traffic in its own part
+   of a shared segment, named after the pid of the process that called
+   ssmp_init (which removes the name when it exits). The counters are written with plain stores by their core only;
+   ssmp_stat maps the segment read-only and prints rates.
+*/
+
+#define SSMP_STATS_NAME      "/ssmp_stats%d"
+#define SSMP_STATS_MAGIC     0x73736d70	/* "ssmp" */
+
+typedef struct ALIGNED(SSMP_CACHE_LINE_SIZE) ssmp_stats_hdr
+{
+  uint32_t magic;
+  uint32_t num_ues;
+  uint64_t core_size;		/* bytes of the counters of a core */
+} ssmp_stats_hdr_t;
+
+/* the counters of a core, followed by num_ues ssmp_stats_peer_t */
+typedef struct ALIGNED(SSMP_CACHE_LINE_SIZE) ssmp_stats_core
+{
+  volatile uint64_t pid;	/* 0 before ssmp_mem_init */
+  volatile uint64_t wait_since;	/* getticks() at the start of the current wait, or 0 */
+  volatile uint64_t send_spins;	/* reads of a full buffer in the send functions */
+  volatile uint64_t send_wait_ticks;
+  volatile uint64_t recv_spins;	/* reads of an empty buffer in ssmp_recv_from */
+  volatile uint64_t recv_wait_ticks; /* + the whole receive from any core */
+  volatile uint64_t barrier_waits;
+  volatile uint64_t barrier_wait_ticks;
+  volatile uint64_t big_bytes_sent;
+  volatile uint64_t big_send_ticks;
+  volatile uint64_t big_bytes_recv;
+  volatile uint64_t big_recv_ticks;
+} ssmp_stats_core_t;
+
+typedef struct ssmp_stats_peer
+{
+  volatile uint64_t msgs_sent;
+  volatile uint64_t bytes_sent;
+  volatile uint64_t msgs_recv;
+  volatile uint64_t bytes_recv;
+} ssmp_stats_peer_t;
+
+#if defined(SSMP_STATS)
+extern ssmp_stats_core_t* ssmp_stats_core_;
+extern ssmp_stats_peer_t* ssmp_stats_peer_;
+
+extern void ssmp_stats_init(int num_procs);
+extern void ssmp_stats_mem_init(int id);
+extern void ssmp_stats_term(void);
+
+#  define SSMP_STATS_INIT(num_procs)     ssmp_stats_init(num_procs)
+#  define SSMP_STATS_MEM_INIT(id)        ssmp_stats_mem_init(id)
+#  define SSMP_STATS_TERM()              ssmp_stats_term()
+
+#  define SSMP_STATS_SENT(to, bytes)				\
+  do {								\
+    ssmp_stats_peer_[to].msgs_sent++;				\
+    ssmp_stats_peer_[to].bytes_sent += (bytes);			\
+  } while (0)
+#  define SSMP_STATS_RECV(from, bytes)				\
+  do {								\
+    ssmp_stats_peer_[from].msgs_recv++;				\
+    ssmp_stats_peer_[from].bytes_recv += (bytes);		\
+  } while (0)
+
+/* the failed polls of the current wait, counted by the wait loops (the wait
+   functions of the protocols and those of ssmp_seq) */
+extern uint64_t ssmp_stats_polls_;
+#  define SSMP_STATS_POLL()              ssmp_stats_polls_++
+
+/* call (that waits as it needs) directly if ready, else time it and add its polls
+   and ticks to the given counters: ready is checked once, so the stats do not wait
+   in place of the protocol */
+#  define SSMP_STATS_WAIT(ready, call, spins, wait_ticks)	\
+  do {								\
+    if (ready)							\
+      {								\
+	call;							\
+      }								\
+    else							\
+      {								\
+	ticks _t = getticks();					\
+	ssmp_stats_core_->wait_since = _t;			\
+	ssmp_stats_polls_ = 0;					\
+	call;							\
+	ssmp_stats_core_->wait_since = 0;			\
+	ssmp_stats_core_->spins += ssmp_stats_polls_;		\
+	ssmp_stats_core_->wait_ticks += getticks() - _t;	\
+      }								\
+  } while (0)
+
+#  define SSMP_STATS_TICKS_START()       ticks _stats_t = getticks()
+#  define SSMP_STATS_TICKS_STOP(counter) ssmp_stats_core_->counter += getticks() - _stats_t
+#  define SSMP_STATS_ADD(counter, v)     ssmp_stats_core_->counter += (v)
+#else
+#  define SSMP_STATS_INIT(num_procs)
+#  define SSMP_STATS_MEM_INIT(id)
+#  define SSMP_STATS_TERM()
+#  define SSMP_STATS_SENT(to, bytes)
+#  define SSMP_STATS_RECV(from, bytes)
+#  define SSMP_STATS_POLL()
+#  define SSMP_STATS_WAIT(ready, call, spins, wait_ticks) call
+#  define SSMP_STATS_TICKS_START()
+#  define SSMP_STATS_TICKS_STOP(counter)
+#  define SSMP_STATS_ADD(counter, v)
+#endif	/* SSMP_STATS */
+
+#endif	/* _SSMP_STATS_H_ */
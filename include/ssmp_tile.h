@@ -39,7 +39,9 @@
 #include <tmc/cmem.h>
 #include <arch/cycle.h> 
 
-#define SSMP_CHUNK_SIZE 8192
+#ifndef SSMP_CHUNK_SIZE
+#  define SSMP_CHUNK_SIZE 8192
+#endif
 
 #define TILE_SMALL_MSG
 #define TILE_1WORD_MSG__
@@ -84,11 +86,11 @@ typedef struct ALIGNED(SSMP_CACHE_LINE_SIZE) ssmp_msg
 
 typedef struct ALIGNED(SSMP_CACHE_LINE_SIZE) ssmp_buf
 {
-  char data[15];
+  char data[12];
   union 
   {
     SSMP_FLAG_TYPE state;
-    volatile uint8_t sender;
+    volatile uint32_t sender;
   };
 } ssmp_buf_t;
 
@@ -100,17 +102,17 @@ typedef struct ALIGNED(SSMP_CACHE_LINE_SIZE) ssmp_msg
   {
     int32_t w1;
     SSMP_FLAG_TYPE state;
-    volatile uint8_t sender;
+    volatile uint32_t sender;
   };
 } ssmp_msg_t;
 
 typedef struct ALIGNED(SSMP_CACHE_LINE_SIZE) ssmp_buf
 {
-  char data[7];
+  char data[4];
   union 
   {
     SSMP_FLAG_TYPE state;
-    volatile uint8_t sender;
+    volatile uint32_t sender;
   };
 } ssmp_buf_t;
 
@@ -136,11 +138,11 @@ typedef struct ALIGNED(SSMP_CACHE_LINE_SIZE) ssmp_msg
 
 typedef struct ALIGNED(SSMP_CACHE_LINE_SIZE) ssmp_buf
 {
-  char data[SSMP_CACHE_LINE_SIZE - 1];
+  char data[SSMP_CACHE_LINE_SIZE - 4];
   union 
   {
     SSMP_FLAG_TYPE state;
-    volatile uint8_t sender;
+    volatile uint32_t sender;
   };
 } ssmp_buf_t;
 #endif
@@ -148,6 +150,14 @@ typedef struct ALIGNED(SSMP_CACHE_LINE_SIZE) ssmp_buf
 typedef tmc_sync_barrier_t ssmp_barrier_t;
 
 extern cpu_set_t cpus;
+#if defined(TILE_SMALL_MSG)
+#  define SSMP_MSG_PAYLOAD 12
+#elif defined(TILE_1WORD_MSG)
+#  define SSMP_MSG_PAYLOAD 4
+#else
+#  define SSMP_MSG_PAYLOAD 56
+#endif
+
 #if defined(__tilepro__)
 #  define SSMP_MSG_NUM_WORDS 16
 #else
@@ -0,0 +1,119 @@
+/*   
+ *   File: ssmp_trace.h
+ *   Author: Vasileios Trigonakis <vasileios.trigonakis@epfl.ch>
+ *   Description: per-core event tracing, dumped by ssmp_trace
+ *   ssmp_trace.h is part of ssmp
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (C) 2013  Vasileios Trigonakis
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef _SSMP_TRACE_H_
+#define _SSMP_TRACE_H_
+
+/* 
+   With SSMP_TRACE (make TRACE=1), every core appends an event for each send,
+   receive and barrier to its own ring in a shared segment, named after the pid of
+   the process that called ssmp_init. An event is stamped with getticks() when the
+   operation starts and keeps the ticks until it completes (including the waiting).
+   A ring keeps the last SSMP_TRACE_EVENTS events (or the value of the environment
+   variable of the same name, rounded up to a power of two). The segment outlives
+   the application, so that ssmp_trace can convert it to a Chrome trace.
+*/
+
+#define SSMP_TRACE_NAME      "/ssmp_trace%d"
+#define SSMP_TRACE_MAGIC     0x73737472	/* "sstr" */
+#define SSMP_TRACE_EVENTS    16384
+
+enum ssmp_trace_type
+  {
+    SSMP_TRACE_SEND = 1,	/* ssmp_send, ssmp_send_no_sync */
+    SSMP_TRACE_SEND_BIG,
+    SSMP_TRACE_RECV,		/* ssmp_recv_from */
+    SSMP_TRACE_RECV_ANY,	/* ssmp_recv, ssmp_recv_color[_start], ssmp_recv_group[_start] */
+    SSMP_TRACE_RECV_BIG,
+    SSMP_TRACE_BARRIER,		/* arg: the barrier */
+  };
+
+typedef struct ALIGNED(SSMP_CACHE_LINE_SIZE) ssmp_trace_hdr
+{
+  uint32_t magic;
+  uint32_t num_ues;
+  uint64_t ring_events;		/* a power of two */
+  uint64_t ring_size;		/* bytes of the ring of a core */
+} ssmp_trace_hdr_t;
+
+typedef struct ssmp_trace_event
+{
+  uint64_t ts;			/* getticks() at the start */
+  uint64_t dur;			/* ticks until completion */
+  uint32_t type;
+  uint32_t peer;
+  uint32_t bytes;
+  uint32_t arg;
+} ssmp_trace_event_t;
+
+/* the ring of a core, followed by ring_events ssmp_trace_event_t */
+typedef struct ALIGNED(SSMP_CACHE_LINE_SIZE) ssmp_trace_ring
+{
+  volatile uint64_t head;	/* events ever written: the next is at head % ring_events */
+  volatile uint64_t pid;	/* 0 before ssmp_mem_init */
+} ssmp_trace_ring_t;
+
+#if defined(SSMP_TRACE)
+extern ssmp_trace_ring_t* ssmp_trace_ring_;
+extern ssmp_trace_event_t* ssmp_trace_events_;
+extern uint64_t ssmp_trace_mask_;
+
+extern void ssmp_trace_init(int num_procs);
+extern void ssmp_trace_mem_init(int id);
+extern void ssmp_trace_term(void);
+
+static inline void
+ssmp_trace_event(uint32_t type, uint32_t peer, uint32_t bytes, uint32_t arg, ticks start)
+{
+  uint64_t head = ssmp_trace_ring_->head;
+  ssmp_trace_event_t* e = ssmp_trace_events_ + (head & ssmp_trace_mask_);
+  e->ts = start;
+  e->dur = getticks() - start;
+  e->type = type;
+  e->peer = peer;
+  e->bytes = bytes;
+  e->arg = arg;
+  ssmp_trace_ring_->head = head + 1;
+}
+
+#  define SSMP_TRACE_INIT(num_procs)     ssmp_trace_init(num_procs)
+#  define SSMP_TRACE_MEM_INIT(id)        ssmp_trace_mem_init(id)
+#  define SSMP_TRACE_TERM()              ssmp_trace_term()
+#  define SSMP_TRACE_START()             ticks _trace_t = getticks()
+#  define SSMP_TRACE_EVENT(type, peer, bytes, arg)	\
+  ssmp_trace_event(type, peer, bytes, arg, _trace_t)
+#else
+#  define SSMP_TRACE_INIT(num_procs)
+#  define SSMP_TRACE_MEM_INIT(id)
+#  define SSMP_TRACE_TERM()
+#  define SSMP_TRACE_START()
+#  define SSMP_TRACE_EVENT(type, peer, bytes, arg)
+#endif	/* SSMP_TRACE */
+
+#endif	/* _SSMP_TRACE_H_ */
@@ -30,8 +30,11 @@
 #ifndef _SSMP_X86_H_
 #define _SSMP_X86_H_
 
-#define SSMP_CHUNK_SIZE 8192
+#ifndef SSMP_CHUNK_SIZE		/* bytes of the big-message buffer of a core (make CHUNK=...) */
+#  define SSMP_CHUNK_SIZE 8192
+#endif
 #define SSMP_WAIT_TIME  66
+#define SSMP_MSG_PAYLOAD 56	/* bytes of a ssmp_msg_t before the state/sender word */
 
 #if !defined(PREFETCH) 
 #  define PREFETCHW(x) asm volatile("prefetchw %0" :: "m" (*(unsigned long*)x)) /* write */
@@ -57,30 +60,60 @@ typedef struct ALIGNED(SSMP_CACHE_LINE_SIZE) ssmp_msg
   {
     SSMP_FLAG_TYPE state;
     volatile uint32_t sender;
-    volatile uint64_t pad;
   };
+  uint32_t tag;			/* set by ssmp_send_tag */
 } ssmp_msg_t;
 
+/* copy all of msg but the flag to the buffer buf: the flag is stored after it */
+static inline void
+ssmp_msg_copy_data(volatile ssmp_msg_t* buf, const volatile ssmp_msg_t* msg)
+{
+  memcpy((void*) buf, (const void*) msg, SSMP_MSG_PAYLOAD);
+  buf->tag = msg->tag;
+}
+
 typedef struct ALIGNED(SSMP_CACHE_LINE_SIZE) ssmp_buf
 {
-  char data[SSMP_CACHE_LINE_SIZE - 1];
+  char data[SSMP_CACHE_LINE_SIZE - 4];
   union 
   {
     SSMP_FLAG_TYPE state;
-    volatile uint8_t sender;
+    volatile uint32_t sender;
   };
 } ssmp_buf_t;
 
+/* 
+   doorbell: with more than SSMP_DOORBELL_MIN_UES processes, a sender also sets its bit
+   in the doorbell of the receiver, so that receiving from any core scans one bit per
+   sender instead of one message buffer per sender. One word (64 senders) per line
+*/
+#define SSMP_DOORBELL_MIN_UES 64
+
+typedef struct ALIGNED(SSMP_CACHE_LINE_SIZE) ssmp_doorbell
+{
+  volatile uint64_t bits;
+  uint8_t pad[SSMP_CACHE_LINE_SIZE - sizeof(uint64_t)];
+} ssmp_doorbell_t;
+
+extern int ssmp_doorbell_on;
+extern void ssmp_doorbell_ring_platf(uint32_t to);
+extern void ssmp_recv_doorbell_platf(const uint64_t* mask, uint32_t* start, ssmp_msg_t* msg);
+
+/* the registers a, b, c, d of cpuid for leaf (subleaf 0) */
+extern void ssmp_cpuid(uint32_t leaf, uint32_t* a, uint32_t* b, uint32_t* c, uint32_t* d);
+
 
 /* barrier type */
 typedef struct ALIGNED(SSMP_CACHE_LINE_SIZE)
 {
-  volatile uint64_t participants; /* the participants of a barrier can be given
-				     either by this, as bits (0 -> no, 1 ->participate */
+  volatile uint64_t participants[SSMP_MAX_UES / 64]; /* the participants of a barrier can be
+						       given either by this, as bits (0 -> no,
+						       1 ->participate, bit id % 64 of word id / 64) */
   int (*color)(int); /* or as a color function: if the function return 0 -> no participant, 
 			1 -> participant. The color function has priority over the lluint participants*/
   volatile uint32_t ticket;
   volatile uint32_t cleared;
+  uint32_t num_participants;	/* computed by ssmp_barrier_init */
 } ssmp_barrier_t;
 
 /*********************************************************************************
@@ -0,0 +1,121 @@
+/*   
+ *   File: ssmp_x86_inline.h
+ *   Author: Vasileios Trigonakis <vasileios.trigonakis@epfl.ch>
+ *   Description: inline fast path of send and receive on x86
+ *   ssmp_x86_inline.h is part of ssmp
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (C) 2013  Vasileios Trigonakis
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef _SSMP_X86_INLINE_H_
+#define _SSMP_X86_INLINE_H_
+
+/*
+  ssmp_send, ssmp_recv_from are two calls per message from libssmp.a (the
+  function and its _platf part), plus the indirect calls of the protocol of the
+  peer. The _inline versions below are compiled into the application: when the
+  buffer is ready at the first look and the protocol of the peer has a plain
+  poll and update (ssmp_proto_t.fast), the message is copied right there.
+  Otherwise (waiting, CAS or XCHG protocols, doorbells) they call the functions
+  of the library. The statistics and the trace are kept the same way, as long as
+  the application is compiled with the SSMP_STATS / SSMP_TRACE of the library.
+*/
+
+extern volatile ssmp_msg_t** ssmp_recv_buf;
+extern volatile ssmp_msg_t** ssmp_send_buf;
+
+static inline void
+ssmp_send_inline(uint32_t to, volatile ssmp_msg_t* msg)
+{
+  volatile ssmp_msg_t* tmpm = ssmp_send_buf[to];
+  const ssmp_proto_t* proto = &ssmp_proto_peer[to];
+  if (__builtin_expect(!proto->fast || ssmp_doorbell_on || SSMP_FLAG_LOAD(&tmpm->state) != SSMP_BUF_EMPTY, 0))
+    {
+      ssmp_send(to, msg);
+      return;
+    }
+
+  SSMP_TRACE_START();
+  ssmp_msg_copy_data(tmpm, msg);
+  SSMP_FLAG_STORE(&tmpm->state, SSMP_BUF_MESSG);
+  if (proto->update == SSMP_UPDATE_MFENCE)
+    {
+      atomic_thread_fence(memory_order_seq_cst);
+    }
+  SSMP_STATS_SENT(to, sizeof(ssmp_msg_t));
+  SSMP_TRACE_EVENT(SSMP_TRACE_SEND, to, sizeof(ssmp_msg_t), 0);
+}
+
+/* copy the message of from (that is there) and free the buffer */
+static inline void
+ssmp_recv_from_ready_inline(uint32_t from, volatile ssmp_msg_t* tmpm, volatile ssmp_msg_t* msg,
+			    const ssmp_proto_t* proto)
+{
+  SSMP_TRACE_START();
+  if (proto->wait == SSMP_WAIT_LFENCE)
+    {
+      _mm_lfence();
+    }
+  memcpy((void*) msg, (const void*) tmpm, SSMP_CACHE_LINE_SIZE);
+  SSMP_FLAG_STORE(&tmpm->state, SSMP_BUF_EMPTY);
+  if (proto->update == SSMP_UPDATE_MFENCE)
+    {
+      atomic_thread_fence(memory_order_seq_cst);
+    }
+  SSMP_STATS_RECV(from, sizeof(ssmp_msg_t));
+  SSMP_TRACE_EVENT(SSMP_TRACE_RECV, from, sizeof(ssmp_msg_t), 0);
+}
+
+static inline void
+ssmp_recv_from_inline(uint32_t from, volatile ssmp_msg_t* msg)
+{
+  volatile ssmp_msg_t* tmpm = ssmp_recv_buf[from];
+  const ssmp_proto_t* proto = &ssmp_proto_peer[from];
+  if (__builtin_expect(!proto->fast || SSMP_FLAG_LOAD(&tmpm->state) != SSMP_BUF_MESSG, 0))
+    {
+      ssmp_recv_from(from, msg);
+      return;
+    }
+  ssmp_recv_from_ready_inline(from, tmpm, msg, proto);
+}
+
+/* receive the message of from if there is one: returns 1 if it did, 0 otherwise */
+static inline int
+ssmp_recv_from_try_inline(uint32_t from, volatile ssmp_msg_t* msg)
+{
+  volatile ssmp_msg_t* tmpm = ssmp_recv_buf[from];
+  if (SSMP_FLAG_LOAD(&tmpm->state) != SSMP_BUF_MESSG)
+    {
+      return 0;
+    }
+  const ssmp_proto_t* proto = &ssmp_proto_peer[from];
+  if (__builtin_expect(!proto->fast, 0))
+    {
+      ssmp_recv_from(from, msg);
+      return 1;
+    }
+  ssmp_recv_from_ready_inline(from, tmpm, msg, proto);
+  return 1;
+}
+
+#endif	/* _SSMP_X86_INLINE_H_ */
@@ -30,6 +30,12 @@
 #define EXINLINED
 #include "measurements.h"
 
+#if defined(DO_TIMINGS) && defined(__linux__)
+#  include <linux/perf_event.h>
+#  include <sys/syscall.h>
+#  include <pthread.h>
+#endif
+
 #ifdef DO_TIMINGS
 ticks entry_time[ENTRY_TIMES_SIZE];
 enum timings_bool_t entry_time_valid[ENTRY_TIMES_SIZE] = {M_FALSE, M_FALSE, M_FALSE, M_FALSE, M_FALSE, M_FALSE, M_FALSE, M_FALSE, M_FALSE, M_FALSE, M_FALSE, M_FALSE, M_FALSE, M_FALSE, M_FALSE, M_FALSE};
@@ -37,6 +43,9 @@ ticks total_sum_ticks[ENTRY_TIMES_SIZE] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0
 long long total_samples[ENTRY_TIMES_SIZE] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
 const char *measurement_msgs[ENTRY_TIMES_SIZE];
 ticks getticks_correction = 0;
+uint64_t pf_hist[ENTRY_TIMES_SIZE][PF_HIST_BUCKETS];
+uint64_t pf_max_ticks[ENTRY_TIMES_SIZE];
+static uint32_t pf_merged_procs = 1;
 
 void 
 prints_ticks_stats(int start, int end) 
@@ -66,12 +75,12 @@ prints_ticks_stats(int start, int end)
 	{
 	  printf("[%02d]%s:\n", i, measurement_msgs[i]);
 	  double ticks_perc = 100 * ((double) total_sum_ticks[i] / tticks);
-	  double secs = total_sum_ticks[i] / (REF_SPEED_GHZ * 1.e9);
+	  double secs = ticks_to_secs(total_sum_ticks[i]);
 	  int s = (int) trunc(secs);
 	  int ms = (int) trunc((secs - s) * 1000);
 	  int us = (int) trunc(((secs - s) * 1000000) - (ms * 1000));
 	  int ns = (int) trunc(((secs - s) * 1000000000) - (ms * 1000000) - (us * 1000));
-	  double secsa = (total_sum_ticks[i] / total_samples[i]) / (REF_SPEED_GHZ * 1.e9);
+	  double secsa = ticks_to_secs(total_sum_ticks[i] / total_samples[i]);
 	  int sa = (int) trunc(secsa);
 	  int msa = (int) trunc((secsa - sa) * 1000);
 	  int usa = (int) trunc(((secsa - sa) * 1000000) - (msa * 1000));
@@ -81,6 +90,8 @@ prints_ticks_stats(int start, int end)
 		 s, ms, us, ns,
 		 sa, msa, usa, nsa,
 		 (double) total_sum_ticks[i]/total_samples[i]);
+	  pf_print_percentiles(i);
+	  pf_pmu_print(i);
 	}
     }
   /* if (have_output) */
@@ -90,4 +101,473 @@ prints_ticks_stats(int start, int end)
   /*   } */
 }
 
+/* ------------------------------------------------------------------------------- */
+/* histograms */
+/* ------------------------------------------------------------------------------- */
+
+/* the highest value that falls in bucket b */
+static ticks
+pf_hist_bucket_high(uint32_t b)
+{
+  if (b < PF_HIST_SUB)
+    {
+      return b;
+    }
+
+  uint32_t shift = (b >> PF_HIST_SUB_BITS) - 1;
+  ticks low = ((ticks) (PF_HIST_SUB + (b & (PF_HIST_SUB - 1)))) << shift;
+  return low + ((1ULL << shift) - 1);
+}
+
+/* the number of samples in the histogram of pos. It is smaller than
+   total_samples[pos] when a benchmark times a whole loop with one PF_START /
+   PF_STOP and then sets total_samples to the iterations: such a position has
+   an average, but no distribution */
+static uint64_t
+pf_hist_count(int pos)
+{
+  uint32_t b;
+  uint64_t count = 0;
+  for (b = 0; b < PF_HIST_BUCKETS; b++)
+    {
+      count += pf_hist[pos][b];
+    }
+  return count;
+}
+
+int
+pf_has_percentiles(int pos)
+{
+  return total_samples[pos] > 0 && pf_hist_count(pos) == (uint64_t) total_samples[pos];
+}
+
+ticks
+pf_percentile(int pos, double q)
+{
+  uint32_t b;
+  uint64_t count = pf_hist_count(pos);
+
+  if (count == 0 || !pf_has_percentiles(pos))
+    {
+      return 0;
+    }
+
+  uint64_t target = (uint64_t) ceil(q * count);
+  if (target == 0)
+    {
+      target = 1;
+    }
+
+  uint64_t cum = 0;
+  for (b = 0; b < PF_HIST_BUCKETS; b++)
+    {
+      cum += pf_hist[pos][b];
+      if (cum >= target)
+	{
+	  ticks high = pf_hist_bucket_high(b);
+	  return (high < pf_max_ticks[pos]) ? high : pf_max_ticks[pos];
+	}
+    }
+
+  return pf_max_ticks[pos];
+}
+
+void
+pf_print_percentiles(int pos)
+{
+  if (!pf_has_percentiles(pos))
+    {
+      return;
+    }
+  printf("  p50: %-10llu | p90: %-10llu | p99: %-10llu | p99.9: %-10llu | max: %-10llu (ticks)\n",
+	 (unsigned long long) pf_percentile(pos, 0.5),
+	 (unsigned long long) pf_percentile(pos, 0.9),
+	 (unsigned long long) pf_percentile(pos, 0.99),
+	 (unsigned long long) pf_percentile(pos, 0.999),
+	 (unsigned long long) pf_max_ticks[pos]);
+}
+
+void
+pf_print_json(int start, int end)
+{
+  int i;
+  for (i = start; i < end; i++)
+    {
+      if (!total_samples[i])
+	{
+	  continue;
+	}
+
+      printf("{\"id\": %d, \"procs\": %u, \"pos\": %d, \"msg\": \"%s\", \"samples\": %lld, "
+	     "\"sum_ticks\": %llu, \"avg_ticks\": %.1f",
+	     ssmp_id(), pf_merged_procs, i, measurement_msgs[i] ? measurement_msgs[i] : "",
+	     total_samples[i], (unsigned long long) total_sum_ticks[i],
+	     (double) total_sum_ticks[i] / total_samples[i]);
+      if (pf_has_percentiles(i))
+	{
+	  printf(", \"p50\": %llu, \"p90\": %llu, \"p99\": %llu, \"p999\": %llu, \"max\": %llu",
+		 (unsigned long long) pf_percentile(i, 0.5),
+		 (unsigned long long) pf_percentile(i, 0.9),
+		 (unsigned long long) pf_percentile(i, 0.99),
+		 (unsigned long long) pf_percentile(i, 0.999),
+		 (unsigned long long) pf_max_ticks[i]);
+	}
+      printf(", \"ghz\": %.3f", ticks_per_ns());
+
+      uint32_t e;
+      for (e = 0; e < pf_pmu_num; e++)
+	{
+	  printf("%s\"%s\": %llu", e ? ", " : ", \"pmu\": {", pf_pmu_names[e],
+		 (unsigned long long) pf_pmu_sum[i][e]);
+	}
+      printf("%s}\n", pf_pmu_num ? "}" : "");
+    }
+  fflush(stdout);
+}
+
+/* 
+ * all processes must call it: the results of positions [start, end) are
+ * summed up the tree of a binomial reduction, so that process 0 ends up
+ * with the results of all processes. Uses the big-message path.
+ */
+#define PF_MERGE_POS_WORDS (PF_HIST_BUCKETS + 3 + PF_PMU_MAX)
+
+void
+pf_merge(int start, int end)
+{
+  uint32_t id = ssmp_id(), num_ues = ssmp_num_ues();
+  size_t size = (1 + (end - start) * PF_MERGE_POS_WORDS) * sizeof(uint64_t);
+  uint64_t* buf = (uint64_t*) malloc(size);
+  if (buf == NULL)
+    {
+      perror("malloc @ pf_merge");
+      exit(-1);
+    }
+
+  uint32_t dist;
+  int i;
+  pf_merged_procs = 1;
+  for (dist = 1; dist < num_ues; dist <<= 1)
+    {
+      if (id & dist)
+	{
+	  uint64_t* b = buf;
+	  *b++ = pf_merged_procs;
+	  for (i = start; i < end; i++)
+	    {
+	      memcpy(b, pf_hist[i], sizeof(pf_hist[i]));
+	      b += PF_HIST_BUCKETS;
+	      *b++ = total_samples[i];
+	      *b++ = total_sum_ticks[i];
+	      *b++ = pf_max_ticks[i];
+	      memcpy(b, pf_pmu_sum[i], sizeof(pf_pmu_sum[i]));
+	      b += PF_PMU_MAX;
+	    }
+	  ssmp_send_big(id - dist, buf, size);
+	  break;
+	}
+      else if (id + dist < num_ues)
+	{
+	  ssmp_recv_from_big(id + dist, buf, size);
+	  uint64_t* b = buf;
+	  pf_merged_procs += *b++;
+	  for (i = start; i < end; i++)
+	    {
+	      uint32_t k;
+	      for (k = 0; k < PF_HIST_BUCKETS; k++)
+		{
+		  pf_hist[i][k] += b[k];
+		}
+	      b += PF_HIST_BUCKETS;
+	      total_samples[i] += *b++;
+	      total_sum_ticks[i] += *b++;
+	      if (*b > pf_max_ticks[i])
+		{
+		  pf_max_ticks[i] = *b;
+		}
+	      b++;
+	      for (k = 0; k < PF_PMU_MAX; k++)
+		{
+		  pf_pmu_sum[i][k] += *b++;
+		}
+	    }
+	}
+    }
+
+  free(buf);
+}
+
+/* ------------------------------------------------------------------------------- */
+/* hardware counters */
+/* ------------------------------------------------------------------------------- */
+
+enum pf_pmu_state_t pf_pmu_state_ = PF_PMU_UNINIT;
+uint32_t pf_pmu_num = 0;
+const char* pf_pmu_names[PF_PMU_MAX];
+uint64_t pf_pmu_sum[ENTRY_TIMES_SIZE][PF_PMU_MAX];
+static uint64_t pf_pmu_start[ENTRY_TIMES_SIZE][PF_PMU_MAX];
+
+#if defined(__linux__)
+
+static int pf_pmu_fds[PF_PMU_MAX];
+static struct perf_event_mmap_page* pf_pmu_pages[PF_PMU_MAX];
+
+#  define PF_PMU_CACHE(cache, op, res)					\
+  (PERF_COUNT_HW_CACHE_##cache | (PERF_COUNT_HW_CACHE_OP_##op << 8) | (PERF_COUNT_HW_CACHE_RESULT_##res << 16))
+
+static const struct
+{
+  const char* name;
+  uint32_t type;
+  uint64_t config;
+} pf_pmu_events[] =
+  {
+    {"cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {"instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {"cache-references", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_REFERENCES},
+    {"cache-misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+    {"branch-misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+    {"stalled-cycles-frontend", PERF_TYPE_HARDWARE, PERF_COUNT_HW_STALLED_CYCLES_FRONTEND},
+    {"stalled-cycles-backend", PERF_TYPE_HARDWARE, PERF_COUNT_HW_STALLED_CYCLES_BACKEND},
+    {"l1d-load-misses", PERF_TYPE_HW_CACHE, PF_PMU_CACHE(L1D, READ, MISS)},
+    {"llc-load-misses", PERF_TYPE_HW_CACHE, PF_PMU_CACHE(LL, READ, MISS)},
+    {"dtlb-load-misses", PERF_TYPE_HW_CACHE, PF_PMU_CACHE(DTLB, READ, MISS)},
+    {"page-faults", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS},
+    {"context-switches", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES},
+    {"task-clock", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK},
+  };
+
+#  define PF_PMU_DEFAULT "cycles,instructions,cache-misses,stalled-cycles-backend"
+
+static inline uint64_t
+pf_pmu_read(uint32_t e)
+{
+#  if defined(__x86_64__) || defined(__i386__)
+  struct perf_event_mmap_page* pc = pf_pmu_pages[e];
+  if (pc != NULL)
+    {
+      uint32_t seq, idx;
+      uint64_t count;
+      do
+	{
+	  seq = pc->lock;
+	  __asm__ __volatile__ ("" : : : "memory");
+	  idx = pc->index;
+	  count = pc->offset;
+	  if (pc->cap_user_rdpmc && idx)
+	    {
+	      uint32_t lo, hi;
+	      __asm__ __volatile__ ("rdpmc" : "=a" (lo), "=d" (hi) : "c" (idx - 1));
+	      uint32_t shift = 64 - pc->pmc_width;
+	      int64_t pmc = (int64_t) ((((uint64_t) hi) << 32) | lo);
+	      count += (pmc << shift) >> shift;
+	    }
+	  __asm__ __volatile__ ("" : : : "memory");
+	}
+      while (pc->lock != seq);
+
+      if (pc->cap_user_rdpmc && idx)
+	{
+	  return count;
+	}
+    }
+#  endif
+  uint64_t v = 0;
+  if (read(pf_pmu_fds[e], &v, sizeof(v)) != sizeof(v))
+    {
+      return 0;
+    }
+  return v;
+}
+
+static void
+pf_pmu_close()
+{
+  uint32_t e;
+  for (e = 0; e < pf_pmu_num; e++)
+    {
+      if (pf_pmu_pages[e] != NULL)
+	{
+	  munmap(pf_pmu_pages[e], getpagesize());
+	  pf_pmu_pages[e] = NULL;
+	}
+      close(pf_pmu_fds[e]);
+    }
+}
+
+/* the counters of the parent are not the ones of the child */
+static void
+pf_pmu_atfork_child()
+{
+  if (pf_pmu_state_ == PF_PMU_ON)
+    {
+      pf_pmu_close();
+      pf_pmu_num = 0;
+      pf_pmu_state_ = PF_PMU_UNINIT;
+    }
+}
+
+/* 
+ * SSMP_PF_EVENTS is a comma-separated list of up to PF_PMU_MAX of the names in
+ * pf_pmu_events, or of raw events as r<hex> (e.g., the HITM snoops of the
+ * platform), or "default" for PF_PMU_DEFAULT. The events form a group, so that
+ * they are counted together.
+ */
+void
+pf_pmu_init()
+{
+  static int atfork = 0;
+  static char* list = NULL;
+  pf_pmu_state_ = PF_PMU_OFF;
+  pf_pmu_num = 0;
+
+  char* env = getenv("SSMP_PF_EVENTS");
+  if (env == NULL || *env == '\0')
+    {
+      return;
+    }
+  if (strcmp(env, "default") == 0)
+    {
+      env = PF_PMU_DEFAULT;
+    }
+
+  if (!atfork)
+    {
+      pthread_atfork(NULL, NULL, pf_pmu_atfork_child);
+      atfork = 1;
+    }
+
+  free(list);
+  list = strdup(env);
+  char* save = NULL;
+  char* name;
+  for (name = strtok_r(list, ",", &save); name != NULL; name = strtok_r(NULL, ",", &save))
+    {
+      if (pf_pmu_num == PF_PMU_MAX)
+	{
+	  printf("** SSMP_PF_EVENTS: at most %d events, ignoring %s\n", PF_PMU_MAX, name);
+	  break;
+	}
+
+      struct perf_event_attr attr;
+      memset(&attr, 0, sizeof(attr));
+      attr.size = sizeof(attr);
+      attr.exclude_hv = 1;
+
+      uint32_t k, n = sizeof(pf_pmu_events) / sizeof(pf_pmu_events[0]);
+      for (k = 0; k < n; k++)
+	{
+	  if (strcmp(name, pf_pmu_events[k].name) == 0)
+	    {
+	      attr.type = pf_pmu_events[k].type;
+	      attr.config = pf_pmu_events[k].config;
+	      break;
+	    }
+	}
+      if (k == n)
+	{
+	  if (name[0] != 'r' || sscanf(name + 1, "%llx", (unsigned long long*) &attr.config) != 1)
+	    {
+	      printf("** SSMP_PF_EVENTS: unknown event %s\n", name);
+	      continue;
+	    }
+	  attr.type = PERF_TYPE_RAW;
+	}
+      /* software events (e.g., context switches) happen in the kernel */
+      attr.exclude_kernel = (attr.type != PERF_TYPE_SOFTWARE);
+
+      int group = pf_pmu_num ? pf_pmu_fds[0] : -1;
+      int fd = syscall(__NR_perf_event_open, &attr, 0, -1, group, 0);
+      if (fd < 0)
+	{
+	  char err[128];
+	  snprintf(err, sizeof(err), "perf_event_open (%s)", name);
+	  perror(err);
+	  continue;
+	}
+
+      pf_pmu_fds[pf_pmu_num] = fd;
+      pf_pmu_pages[pf_pmu_num] = (struct perf_event_mmap_page*) mmap(NULL, getpagesize(), PROT_READ,
+								     MAP_SHARED, fd, 0);
+      if (pf_pmu_pages[pf_pmu_num] == MAP_FAILED)
+	{
+	  pf_pmu_pages[pf_pmu_num] = NULL;
+	}
+      pf_pmu_names[pf_pmu_num] = name;
+      pf_pmu_num++;
+    }
+
+  if (pf_pmu_num)
+    {
+      pf_pmu_state_ = PF_PMU_ON;
+    }
+}
+
+void
+pf_pmu_entry(int pos)
+{
+  if (pf_pmu_state_ == PF_PMU_UNINIT)
+    {
+      pf_pmu_init();
+      if (pf_pmu_state_ != PF_PMU_ON)
+	{
+	  return;
+	}
+    }
+
+  uint32_t e;
+  for (e = 0; e < pf_pmu_num; e++)
+    {
+      pf_pmu_start[pos][e] = pf_pmu_read(e);
+    }
+}
+
+void
+pf_pmu_exit(int pos)
+{
+  uint64_t now[PF_PMU_MAX];
+  uint32_t e;
+  for (e = 0; e < pf_pmu_num; e++)
+    {
+      now[e] = pf_pmu_read(e);
+    }
+  for (e = 0; e < pf_pmu_num; e++)
+    {
+      pf_pmu_sum[pos][e] += now[e] - pf_pmu_start[pos][e];
+    }
+}
+
+#else  /* !__linux__ */
+
+void
+pf_pmu_init()
+{
+  pf_pmu_state_ = PF_PMU_OFF;
+}
+
+void
+pf_pmu_entry(int pos)
+{
+  pf_pmu_init();
+}
+
+void
+pf_pmu_exit(int pos)
+{
+}
+
+#endif	/* __linux__ */
+
+void
+pf_pmu_print(int pos)
+{
+  uint32_t e;
+  for (e = 0; e < pf_pmu_num; e++)
+    {
+      printf("  %-24s total: %-16llu | avg: %.1f\n", pf_pmu_names[e],
+	     (unsigned long long) pf_pmu_sum[pos][e],
+	     total_samples[pos] ? (double) pf_pmu_sum[pos][e] / total_samples[pos] : 0.0);
+    }
+}
+
 #endif
@@ -0,0 +1,337 @@
+/*   
+ *   File: ssmp_stat.c
+ *   Author: Vasileios Trigonakis <vasileios.trigonakis@epfl.ch>
+ *   Description: prints the live statistics of a running ssmp application
+ *   ssmp_stat.c is part of ssmp
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (C) 2013  Vasileios Trigonakis
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include <getopt.h>
+#include <dirent.h>
+#include <time.h>
+#include <signal.h>
+
+#include "ssmp.h"
+
+/* 
+   Maps the statistics segment of an ssmp application (SSMP_STATS) read-only and
+   prints, every interval, the rates of every core, the fraction of the time it
+   waited in send, receive and barriers, how long it has been blocked in its
+   current wait, and the pairs with the most messages.
+*/
+
+typedef struct pair_rate
+{
+  uint32_t from, to;
+  double msgs, bytes;
+} pair_rate_t;
+
+static ssmp_stats_hdr_t* stats;
+static uint32_t num_ues;
+
+static ssmp_stats_core_t*
+stats_core(uint32_t core)
+{
+  return (ssmp_stats_core_t*) ((char*) (stats + 1) + core * stats->core_size);
+}
+
+static ssmp_stats_peer_t*
+stats_peers(uint32_t core)
+{
+  return (ssmp_stats_peer_t*) (stats_core(core) + 1);
+}
+
+/* the counters of all cores; the sent messages and bytes per pair */
+static void
+snapshot(ssmp_stats_core_t* cores, uint64_t* msgs, uint64_t* bytes)
+{
+  uint32_t c, p;
+  for (c = 0; c < num_ues; c++)
+    {
+      memcpy(&cores[c], stats_core(c), sizeof(ssmp_stats_core_t));
+      ssmp_stats_peer_t* peers = stats_peers(c);
+      for (p = 0; p < num_ues; p++)
+	{
+	  msgs[c * num_ues + p] = peers[p].msgs_sent;
+	  bytes[c * num_ues + p] = peers[p].bytes_sent;
+	}
+    }
+}
+
+static int
+pair_rate_cmp(const void* a, const void* b)
+{
+  double ma = ((const pair_rate_t*) a)->msgs, mb = ((const pair_rate_t*) b)->msgs;
+  return (ma < mb) - (ma > mb);
+}
+
+/* the first /dev/shm/ssmp_stats<pid> of a running process (a killed application
+   leaves its segment behind) */
+static int
+find_pid()
+{
+  DIR* dir = opendir("/dev/shm");
+  if (dir == NULL)
+    {
+      return -1;
+    }
+
+  int pid = -1;
+  struct dirent* e;
+  while (pid < 0 && (e = readdir(dir)) != NULL)
+    {
+      if (sscanf(e->d_name, "ssmp_stats%d", &pid) == 1 && kill(pid, 0) < 0)
+	{
+	  pid = -1;
+	}
+    }
+  closedir(dir);
+  return pid;
+}
+
+static double
+now_secs()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int
+main(int argc, char** argv)
+{
+  struct option long_options[] =
+    {
+      // These options don't set a flag
+      {"help",        no_argument, NULL, 'h'},
+      {"pid",         required_argument, NULL, 'p'},
+      {"interval",    required_argument, NULL, 'i'},
+      {"count",       required_argument, NULL, 'c'},
+      {"top",         required_argument, NULL, 't'},
+      {NULL, 0, NULL, 0}
+    };
+
+  int pid = -1, count = 0, top = 10;
+  double interval = 1.0;
+
+  int i, c;
+  while (1)
+    {
+      i = 0;
+      c = getopt_long(argc, argv, "hp:i:c:t:", long_options, &i);
+
+      if (c == -1)
+	break;
+
+      if (c == 0 && long_options[i].flag == 0)
+	c = long_options[i].val;
+
+      switch (c)
+	{
+	case 0:
+	  /* Flag is automatically set */
+	  break;
+	case 'h':
+	  printf("ssmp_stat -- Live statistics of a running ssmp application\n"
+		 "\n"
+		 "Usage:\n"
+		 "  ./ssmp_stat [options...]\n"
+		 "\n"
+		 "Options:\n"
+		 "  -h, --help\n"
+		 "        Print this message\n"
+		 "  -p, --pid <int>\n"
+		 "        Pid of the process that called ssmp_init (default: the\n"
+		 "        first /dev/shm/ssmp_stats<pid>)\n"
+		 "  -i, --interval <double>\n"
+		 "        Seconds between two reports\n"
+		 "  -c, --count <int>\n"
+		 "        Number of reports (0: until the application terminates)\n"
+		 "  -t, --top <int>\n"
+		 "        Number of pairs with the most messages to print\n"
+		 );
+	  exit(0);
+	case 'p':
+	  pid = atoi(optarg);
+	  break;
+	case 'i':
+	  interval = atof(optarg);
+	  break;
+	case 'c':
+	  count = atoi(optarg);
+	  break;
+	case 't':
+	  top = atoi(optarg);
+	  break;
+	case '?':
+	  printf("Use -h or --help for help\n");
+	  exit(0);
+	default:
+	  exit(1);
+	}
+    }
+
+  if (pid < 0 && (pid = find_pid()) < 0)
+    {
+      printf("** no ssmp application with statistics is running\n");
+      exit(1);
+    }
+
+  char keyF[100];
+  sprintf(keyF, SSMP_STATS_NAME, pid);
+  int fd = shm_open(keyF, O_RDONLY, 0);
+  struct stat st;
+  if (fd < 0 || fstat(fd, &st) < 0)
+    {
+      perror("In shm_open");
+      exit(1);
+    }
+  if (st.st_size < sizeof(ssmp_stats_hdr_t))
+    {
+      printf("** %s is not an ssmp statistics segment\n", keyF);
+      exit(1);
+    }
+
+  stats = (ssmp_stats_hdr_t*) mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  if (stats == MAP_FAILED)
+    {
+      perror("mmap");
+      exit(1);
+    }
+  close(fd);
+
+  if (stats->magic != SSMP_STATS_MAGIC
+      || sizeof(ssmp_stats_hdr_t) + stats->num_ues * stats->core_size > (size_t) st.st_size)
+    {
+      printf("** %s is not an ssmp statistics segment\n", keyF);
+      exit(1);
+    }
+  num_ues = stats->num_ues;
+
+  ssmp_stats_core_t* cores[2];
+  uint64_t* msgs[2];
+  uint64_t* bytes[2];
+  for (i = 0; i < 2; i++)
+    {
+      cores[i] = (ssmp_stats_core_t*) malloc(num_ues * sizeof(ssmp_stats_core_t));
+      msgs[i] = (uint64_t*) malloc(num_ues * num_ues * sizeof(uint64_t));
+      bytes[i] = (uint64_t*) malloc(num_ues * num_ues * sizeof(uint64_t));
+    }
+  pair_rate_t* pairs = (pair_rate_t*) malloc(num_ues * num_ues * sizeof(pair_rate_t));
+  if (cores[1] == NULL || msgs[1] == NULL || bytes[1] == NULL || pairs == NULL)
+    {
+      perror("malloc @ ssmp_stat");
+      exit(1);
+    }
+
+  int cur = 0, tty = isatty(1), rep;
+  snapshot(cores[cur], msgs[cur], bytes[cur]);
+  double t_prev = now_secs();
+  ticks tk_prev = getticks();
+
+  for (rep = 0; count == 0 || rep < count; rep++)
+    {
+      usleep((useconds_t) (interval * 1e6));
+      int prev = cur;
+      cur = 1 - cur;
+      snapshot(cores[cur], msgs[cur], bytes[cur]);
+      double t_now = now_secs();
+      ticks tk_now = getticks();
+      double secs = t_now - t_prev;
+      double tk_per_sec = (tk_now - tk_prev) / secs;
+      t_prev = t_now;
+      tk_prev = tk_now;
+
+      if (tty)
+	{
+	  printf("\033[H\033[2J");
+	}
+      printf("ssmp_stat: %s, %u processes, %.2f s\n", keyF, num_ues, secs);
+      printf("%5s %8s %12s %12s %9s %9s %6s %6s %6s %9s %9s\n", "core", "pid",
+	     "msgs/s out", "msgs/s in", "MB/s out", "MB/s in", "send%", "recv%", "barr%",
+	     "big MB/s", "blocked s");
+
+      uint32_t co, p, alive = 0, num_pairs = 0;
+      for (co = 0; co < num_ues; co++)
+	{
+	  ssmp_stats_core_t* n = &cores[cur][co];
+	  ssmp_stats_core_t* o = &cores[prev][co];
+	  if (n->pid == 0)
+	    {
+	      continue;
+	    }
+	  alive++;
+
+	  double out = 0, in = 0, bout = 0, bin = 0;
+	  for (p = 0; p < num_ues; p++)
+	    {
+	      uint32_t s = co * num_ues + p, r = p * num_ues + co;
+	      double dm = msgs[cur][s] - msgs[prev][s];
+	      double db = bytes[cur][s] - bytes[prev][s];
+	      out += dm;
+	      bout += db;
+	      in += msgs[cur][r] - msgs[prev][r];
+	      bin += bytes[cur][r] - bytes[prev][r];
+	      if (dm > 0)
+		{
+		  pairs[num_pairs].from = co;
+		  pairs[num_pairs].to = p;
+		  pairs[num_pairs].msgs = dm / secs;
+		  pairs[num_pairs].bytes = db / secs;
+		  num_pairs++;
+		}
+	    }
+
+	  double big = (n->big_bytes_sent - o->big_bytes_sent) + (n->big_bytes_recv - o->big_bytes_recv);
+	  double big_secs = ((n->big_send_ticks - o->big_send_ticks)
+			     + (n->big_recv_ticks - o->big_recv_ticks)) / tk_per_sec;
+	  ticks since = n->wait_since;
+	  double blocked = (since != 0 && tk_now > since) ? (tk_now - since) / tk_per_sec : 0;
+
+	  printf("%5u %8llu %12.0f %12.0f %9.2f %9.2f %6.1f %6.1f %6.1f %9.2f %9.2f\n",
+		 co, (unsigned long long) n->pid, out / secs, in / secs,
+		 bout / secs / 1e6, bin / secs / 1e6,
+		 100 * (n->send_wait_ticks - o->send_wait_ticks) / tk_per_sec / secs,
+		 100 * (n->recv_wait_ticks - o->recv_wait_ticks) / tk_per_sec / secs,
+		 100 * (n->barrier_wait_ticks - o->barrier_wait_ticks) / tk_per_sec / secs,
+		 (big_secs > 0) ? big / big_secs / 1e6 : 0, blocked);
+	}
+
+      qsort(pairs, num_pairs, sizeof(pair_rate_t), pair_rate_cmp);
+      printf("top pairs:\n");
+      for (p = 0; p < num_pairs && p < top; p++)
+	{
+	  printf("%5u -> %-5u %12.0f msgs/s %9.2f MB/s\n",
+		 pairs[p].from, pairs[p].to, pairs[p].msgs, pairs[p].bytes / 1e6);
+	}
+      fflush(stdout);
+
+      if (stats->magic != SSMP_STATS_MAGIC || (alive == 0 && rep > 0))
+	{
+	  break;
+	}
+    }
+
+  return 0;
+}
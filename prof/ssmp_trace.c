@@ -0,0 +1,283 @@
+/*   
+ *   File: ssmp_trace.c
+ *   Author: Vasileios Trigonakis <vasileios.trigonakis@epfl.ch>
+ *   Description: converts the event rings of an ssmp application to a Chrome trace
+ *   ssmp_trace.c is part of ssmp
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (C) 2013  Vasileios Trigonakis
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include <getopt.h>
+#include <dirent.h>
+#include <time.h>
+
+#include "ssmp.h"
+
+/* 
+   Maps the trace segment of an ssmp application (SSMP_TRACE), while it runs or
+   after it terminated, and writes the events of all cores as a Chrome trace
+   (JSON, for chrome://tracing or ui.perfetto.dev): one track per core, one
+   complete event per operation, with the peer and the bytes as arguments.
+*/
+
+static const char* type_names[] =
+  {
+    "?", "send", "send_big", "recv", "recv_any", "recv_big", "barrier"
+  };
+
+/* the most recently modified /dev/shm/ssmp_trace<pid> */
+static int
+find_pid()
+{
+  DIR* dir = opendir("/dev/shm");
+  if (dir == NULL)
+    {
+      return -1;
+    }
+
+  int pid = -1, p;
+  time_t newest = 0;
+  struct dirent* e;
+  while ((e = readdir(dir)) != NULL)
+    {
+      struct stat st;
+      char path[300];
+      snprintf(path, sizeof(path), "/dev/shm/%s", e->d_name);
+      if (sscanf(e->d_name, "ssmp_trace%d", &p) == 1 && stat(path, &st) == 0
+	  && st.st_mtime >= newest)
+	{
+	  newest = st.st_mtime;
+	  pid = p;
+	}
+    }
+  closedir(dir);
+  return pid;
+}
+
+int
+main(int argc, char** argv)
+{
+  struct option long_options[] =
+    {
+      // These options don't set a flag
+      {"help",        no_argument, NULL, 'h'},
+      {"pid",         required_argument, NULL, 'p'},
+      {"output",      required_argument, NULL, 'o'},
+      {"ghz",         required_argument, NULL, 'g'},
+      {"unlink",      no_argument, NULL, 'u'},
+      {NULL, 0, NULL, 0}
+    };
+
+  int pid = -1, unlink_seg = 0;
+  double tpu = 0;
+  char* output = NULL;
+
+  int i, c;
+  while (1)
+    {
+      i = 0;
+      c = getopt_long(argc, argv, "hp:o:g:u", long_options, &i);
+
+      if (c == -1)
+	break;
+
+      if (c == 0 && long_options[i].flag == 0)
+	c = long_options[i].val;
+
+      switch (c)
+	{
+	case 0:
+	  /* Flag is automatically set */
+	  break;
+	case 'h':
+	  printf("ssmp_trace -- Convert the event trace of an ssmp application to a Chrome trace\n"
+		 "\n"
+		 "Usage:\n"
+		 "  ./ssmp_trace [options...]\n"
+		 "\n"
+		 "Options:\n"
+		 "  -h, --help\n"
+		 "        Print this message\n"
+		 "  -p, --pid <int>\n"
+		 "        Pid of the process that called ssmp_init (default: the\n"
+		 "        most recent /dev/shm/ssmp_trace<pid>)\n"
+		 "  -o, --output <file>\n"
+		 "        Write the JSON to file (default: stdout)\n"
+		 "  -g, --ghz <double>\n"
+		 "        Ticks per nanosecond (default: calibrated, see ticks_per_ns)\n"
+		 "  -u, --unlink\n"
+		 "        Remove the trace segment after converting it\n"
+		 );
+	  exit(0);
+	case 'p':
+	  pid = atoi(optarg);
+	  break;
+	case 'o':
+	  output = optarg;
+	  break;
+	case 'g':
+	  tpu = atof(optarg) * 1e3;
+	  break;
+	case 'u':
+	  unlink_seg = 1;
+	  break;
+	case '?':
+	  printf("Use -h or --help for help\n");
+	  exit(0);
+	default:
+	  exit(1);
+	}
+    }
+
+  if (pid < 0 && (pid = find_pid()) < 0)
+    {
+      printf("** no ssmp trace found in /dev/shm\n");
+      exit(1);
+    }
+
+  char keyF[100];
+  sprintf(keyF, SSMP_TRACE_NAME, pid);
+  int fd = shm_open(keyF, O_RDONLY, 0);
+  struct stat st;
+  if (fd < 0 || fstat(fd, &st) < 0)
+    {
+      perror("In shm_open");
+      exit(1);
+    }
+  if (st.st_size < sizeof(ssmp_trace_hdr_t))
+    {
+      printf("** %s is not an ssmp trace segment\n", keyF);
+      exit(1);
+    }
+
+  ssmp_trace_hdr_t* trace = (ssmp_trace_hdr_t*) mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  if (trace == MAP_FAILED)
+    {
+      perror("mmap");
+      exit(1);
+    }
+  close(fd);
+
+  if (trace->magic != SSMP_TRACE_MAGIC
+      || sizeof(ssmp_trace_hdr_t) + trace->num_ues * trace->ring_size > (size_t) st.st_size)
+    {
+      printf("** %s is not an ssmp trace segment\n", keyF);
+      exit(1);
+    }
+
+  uint32_t num_ues = trace->num_ues;
+  uint64_t ring_events = trace->ring_events;
+  ssmp_trace_event_t* events = (ssmp_trace_event_t*) malloc(ring_events * sizeof(ssmp_trace_event_t));
+  uint64_t* first = (uint64_t*) malloc(num_ues * sizeof(uint64_t));
+  uint64_t* last = (uint64_t*) malloc(num_ues * sizeof(uint64_t));
+  if (events == NULL || first == NULL || last == NULL)
+    {
+      perror("malloc @ ssmp_trace");
+      exit(1);
+    }
+
+  if (tpu == 0)
+    {
+      tpu = ticks_per_ns() * 1e3;
+    }
+
+  FILE* out = stdout;
+  if (output != NULL && (out = fopen(output, "w")) == NULL)
+    {
+      perror("fopen");
+      exit(1);
+    }
+
+  /* the events that are still in the rings, and the earliest timestamp */
+  uint32_t co;
+  ticks t_min = ~0ULL;
+  for (co = 0; co < num_ues; co++)
+    {
+      ssmp_trace_ring_t* ring = (ssmp_trace_ring_t*) ((char*) (trace + 1) + co * trace->ring_size);
+      ssmp_trace_event_t* ev = (ssmp_trace_event_t*) (ring + 1);
+      last[co] = ring->head;
+      first[co] = (last[co] > ring_events) ? last[co] - ring_events : 0;
+      if (last[co] > first[co] && ev[first[co] & (ring_events - 1)].ts < t_min)
+	{
+	  t_min = ev[first[co] & (ring_events - 1)].ts;
+	}
+    }
+
+  fprintf(out, "{\"displayTimeUnit\": \"ns\", \"otherData\": {\"segment\": \"%s\", \"ticks_per_us\": %.3f},\n"
+	  " \"traceEvents\": [\n", keyF, tpu);
+  int sep = 0;
+  uint64_t total = 0, lost = 0;
+  for (co = 0; co < num_ues; co++)
+    {
+      ssmp_trace_ring_t* ring = (ssmp_trace_ring_t*) ((char*) (trace + 1) + co * trace->ring_size);
+      ssmp_trace_event_t* ev = (ssmp_trace_event_t*) (ring + 1);
+      fprintf(out, "%s  {\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": %d, \"tid\": %u, "
+	      "\"args\": {\"name\": \"core %u (pid %llu)\"}}", sep ? ",\n" : "", pid, co, co,
+	      (unsigned long long) ring->pid);
+      sep = 1;
+
+      /* the application may still be running: copy, then drop what it overwrote meanwhile */
+      uint64_t e;
+      for (e = first[co]; e < last[co]; e++)
+	{
+	  events[e & (ring_events - 1)] = ev[e & (ring_events - 1)];
+	}
+      uint64_t head = ring->head;
+      if (head > ring_events && head - ring_events > first[co])
+	{
+	  lost += head - ring_events - first[co];
+	  first[co] = (head - ring_events < last[co]) ? head - ring_events : last[co];
+	}
+
+      for (e = first[co]; e < last[co]; e++)
+	{
+	  ssmp_trace_event_t* t = &events[e & (ring_events - 1)];
+	  uint32_t type = (t->type <= SSMP_TRACE_BARRIER) ? t->type : 0;
+	  double ts = (t->ts > t_min) ? (t->ts - t_min) / tpu : 0;
+	  fprintf(out, ",\n  {\"name\": \"%s\", \"cat\": \"ssmp\", \"ph\": \"X\", \"pid\": %d, \"tid\": %u, "
+		  "\"ts\": %.3f, \"dur\": %.3f, \"args\": {\"peer\": %u, \"bytes\": %u, \"arg\": %u, \"wait_ticks\": %llu}}",
+		  type_names[type], pid, co, ts, t->dur / tpu, t->peer, t->bytes, t->arg,
+		  (unsigned long long) t->dur);
+	  total++;
+	}
+    }
+  fprintf(out, "\n]}\n");
+  if (out != stdout)
+    {
+      fclose(out);
+    }
+
+  fprintf(stderr, "ssmp_trace: %s, %u processes, %llu events", keyF, num_ues, (unsigned long long) total);
+  if (lost)
+    {
+      fprintf(stderr, " (%llu overwritten while reading)", (unsigned long long) lost);
+    }
+  fprintf(stderr, "\n");
+
+  munmap(trace, st.st_size);
+  if (unlink_seg)
+    {
+      shm_unlink(keyF);
+    }
+  return 0;
+}
@@ -0,0 +1,140 @@
+/*   
+ *   File: ssmp_tune.c
+ *   Author: Vasileios Trigonakis <vasileios.trigonakis@epfl.ch>
+ *   Description: measures (or shows) the protocol profile of this machine
+ *   ssmp_tune.c is part of ssmp
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (C) 2013  Vasileios Trigonakis
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include <getopt.h>
+
+#include "ssmp.h"
+
+/* 
+   Loads the protocol profile of this machine (see ssmp_tune in ssmp.h), or
+   measures it if there is none or with -f, and prints the cycles of a roundtrip
+   with every preset for every topology class and the preset that ssmp uses.
+*/
+
+int
+main(int argc, char** argv)
+{
+  struct option long_options[] =
+    {
+      // These options don't set a flag
+      {"help",        no_argument, NULL, 'h'},
+      {"force",       no_argument, NULL, 'f'},
+      {"profile",     required_argument, NULL, 'p'},
+      {NULL, 0, NULL, 0}
+    };
+
+  int force = 0;
+
+  int i, c;
+  while (1)
+    {
+      i = 0;
+      c = getopt_long(argc, argv, "hfp:", long_options, &i);
+
+      if (c == -1)
+	break;
+
+      if (c == 0 && long_options[i].flag == 0)
+	c = long_options[i].val;
+
+      switch (c)
+	{
+	case 0:
+	  /* Flag is automatically set */
+	  break;
+	case 'h':
+	  printf("ssmp_tune -- Measure the fastest message protocol per topology class on this machine\n"
+		 "\n"
+		 "Usage:\n"
+		 "  ./ssmp_tune [options...]\n"
+		 "\n"
+		 "Options:\n"
+		 "  -h, --help\n"
+		 "        Print this message\n"
+		 "  -f, --force\n"
+		 "        Measure again, even if there is a profile of this machine\n"
+		 "  -p, --profile <file>\n"
+		 "        The profile (default: $SSMP_PROFILE, else $HOME/.ssmp_profile)\n"
+		 );
+	  exit(0);
+	case 'f':
+	  force = 1;
+	  break;
+	case 'p':
+	  setenv("SSMP_PROFILE", optarg, 1);
+	  break;
+	case '?':
+	  printf("Use -h or --help for help\n");
+	  exit(0);
+	default:
+	  exit(1);
+	}
+    }
+
+  static const char* wait_names[SSMP_WAIT_NUM] = { "load", "lfence", "cas" };
+  static const char* backoff_names[SSMP_BACKOFF_NUM] = { "none", "pause", "ramp" };
+  static const char* update_names[SSMP_UPDATE_NUM] = { "store", "mfence", "xchg" };
+
+  int measured = ssmp_tune(force);
+  printf("profile: %s (%s)\n", ssmp_tune_profile(), measured ? "measured" : "loaded");
+  printf("%-8s %-14s", "class", "uses");
+  int cls, w;
+  for (w = 0; w < SSMP_PRESET_NUM; w++)
+    {
+      printf(" %14s", ssmp_proto_presets[w].name);
+    }
+  printf("\n");
+
+  for (cls = 0; cls < SSMP_TOPO_NUM; cls++)
+    {
+      double* cycles = ssmp_proto_cycles[cls];
+      printf("%-8s %-14s", ssmp_topo_names[cls], ssmp_proto_presets[ssmp_proto_class_preset[cls]].name);
+      for (w = 0; w < SSMP_PRESET_NUM; w++)
+	{
+	  if (cycles[w] > 0)
+	    {
+	      printf(" %14.1f", cycles[w]);
+	    }
+	  else
+	    {
+	      printf(" %14s", "-");
+	    }
+	}
+      printf("%s\n", (cycles[ssmp_proto_class_preset[cls]] > 0) ? "" : "   (default: no such pair of cores)");
+    }
+
+  printf("\n%-14s %-8s %-8s %-8s %-8s\n", "preset", "wait", "backoff", "prefetch", "update");
+  for (w = 0; w < SSMP_PRESET_NUM; w++)
+    {
+      const ssmp_proto_preset_t* p = &ssmp_proto_presets[w];
+      printf("%-14s %-8s %-8s %-8s %-8s\n", p->name, wait_names[p->wait], backoff_names[p->backoff],
+	     p->prefetch ? "yes" : "no", update_names[p->update]);
+    }
+  return 0;
+}
@@ -33,7 +33,7 @@
 #include <sys/stat.h> 
 #include <sys/fcntl.h>
  
-uint8_t id_to_core[] =
+uint32_t id_to_core[] =
   {
     0, 8, 16, 24, 32, 40, 48, 56,
     9, 17, 25, 33, 41, 49, 57,
@@ -52,12 +52,13 @@ uint8_t id_to_core[] =
 
 int ssmp_num_ues_;
 int ssmp_id_;
+extern int ssmp_opts_;
 int last_recv_from;
 ssmp_barrier_t* ssmp_barrier;
-volatile int* ues_initialized;
 static uint32_t ssmp_my_core;
 
 static ssmp_msg_t* ssmp_mem;
+static size_t ssmp_mem_size;
 volatile ssmp_msg_t** ssmp_recv_buf;
 volatile ssmp_msg_t** ssmp_send_buf;
 static ssmp_chunk_t* ssmp_chunk_mem;
@@ -72,62 +73,30 @@ void
 ssmp_init_platf(int num_procs)
 {
 
-  //create the shared space which will be managed by the allocator
-  uint32_t sizem, sizeb, sizeui, sizecnk, size;;
+  /* one segment, inherited by the forked processes: ssmp_mem_init computes offsets */
+  size_t sizem, sizeb, sizecnk, size;
 
   sizem = (num_procs * num_procs) * sizeof(ssmp_msg_t);
   sizeb = SSMP_NUM_BARRIERS * sizeof(ssmp_barrier_t);
   SSMP_INC_ALIGN(sizeb);
-  sizeui = num_procs * sizeof(int);
-  SSMP_INC_ALIGN(sizeui);
   sizecnk = num_procs * sizeof(ssmp_chunk_t);
   SSMP_INC_ALIGN(sizecnk);
-  size = sizem + sizeb + sizeui + sizecnk;
+  size = sizem + sizeb + sizecnk;
 
-  char keyF[100];
-  sprintf(keyF, SSMP_MEM_NAME);
-
-  int ssmpfd = shm_open(keyF, O_CREAT | O_EXCL | O_RDWR, S_IRWXU | S_IRWXG);
-  if (ssmpfd<0)
-    {
-      if (errno != EEXIST)
-	{
-	  perror("In shm_open");
-	  exit(1);
-	}
-
-      //this time it is ok if it already exists
-      ssmpfd = shm_open(keyF, O_CREAT | O_RDWR, S_IRWXU | S_IRWXG);
-      if (ssmpfd<0)
-	{
-	  perror("In shm_open");
-	  exit(1);
-	}
-    }
-  else
-    {
-      if (ftruncate(ssmpfd, size) < 0) 
-	{
-	  perror("ftruncate failed\n");
-	  exit(1);
-	}
-    }
-
-  ssmp_mem = (ssmp_msg_t*) mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, ssmpfd, 0);
-  if ((unsigned long) ssmp_mem % SSMP_CACHE_LINE_SIZE)
-    {
-      printf("** the messaging buffers are not cache aligned.\n");
-    }
-  if (ssmp_mem == NULL)
+  ssmp_mem = (ssmp_msg_t*) mmap(NULL, size, PROT_READ | PROT_WRITE,
+				MAP_SHARED | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  if (ssmp_mem == MAP_FAILED)
     {
       perror("ssmp_mem = NULL\n");
       exit(134);
     }
+  ssmp_mem_size = size;
+
+  ssmp_num_ues_ = num_procs;	/* for ssmp_barrier_init */
 
   char* mem_just_int = (char*) ssmp_mem;
   ssmp_barrier = (ssmp_barrier_t*) (mem_just_int + sizem);
-  ues_initialized = (int*) (mem_just_int + sizem + sizeb);
-  ssmp_chunk_mem = (ssmp_chunk_t*) (mem_just_int + sizem + sizeb + sizeui);
+  ssmp_chunk_mem = (ssmp_chunk_t*) (mem_just_int + sizem + sizeb);
 
   int bar;
   for (bar = 0; bar < SSMP_NUM_BARRIERS; bar++) 
@@ -161,40 +130,38 @@ ssmp_mem_init_platf(int id, int num_ues)
       ssmp_chunk_buf[core] = ssmp_chunk_mem + core;
 
       ssmp_recv_buf[core] = ssmp_mem + (id * num_ues) + core;
-      ssmp_recv_buf[core]->state = 0;
 
       ssmp_send_buf[core] = ssmp_mem + (core * num_ues) + id;
     }
 
-  ssmp_chunk_buf[id]->state = 0;
-
-  ues_initialized[id] = 1;
-
-  /* SP("waiting for all to be initialized!"); */
-  int ue;
-  for (ue = 0; ue < num_ues; ue++) 
+  /* SSMP_OPT_PREFAULT: the whole segment, a few hundred KB for the cores of a
+     Niagara. Without the permission to lock it, map it by reading it */
+  if ((ssmp_opts_ & SSMP_OPT_PREFAULT) && mlock(ssmp_mem, ssmp_mem_size) < 0)
     {
-      while(!ues_initialized[ue]) 
+      long page = sysconf(_SC_PAGESIZE);
+      size_t offs;
+      for (offs = 0; offs < ssmp_mem_size; offs += page)
 	{
-	  _mm_pause();
-	  _mm_mfence();
-	};
+	  (void) *((volatile char*) ssmp_mem + offs);
+	}
     }
-  /* SP("\t\t\tall initialized!"); */
 }
 
+/* the buffers of all cores are in the segment mapped by ssmp_init_platf, so
+   declaring the peers saves nothing here */
 void
-ssmp_term_platf() 
+ssmp_mem_init_peers_platf(int id, int num_ues, const uint32_t* peers, uint32_t num_peers)
 {
-  if (ssmp_id_ == 0 && shm_unlink(SSMP_MEM_NAME) < 0)
-    {
-      printf("Could not unlink ssmp_mem\n");
-      fflush(stdout);
-    }
+  ssmp_mem_init_platf(id, num_ues);
+}
 
+void
+ssmp_term_platf() 
+{
   free(ssmp_recv_buf);
   free(ssmp_send_buf);
   free(ssmp_chunk_buf);
+  munmap(ssmp_mem, ssmp_mem_size);
 }
 
 
@@ -229,6 +196,7 @@ ssmp_color_buf_init_platf(ssmp_color_buf_t* cbuf, int (*color)(int))
     }
 
   cbuf->num_ues = num_ues;
+  cbuf->start_recv_from = 0;
 
   uint32_t size_buf = num_ues * sizeof(ssmp_msg_t*);
   uint32_t size_pad = 0;
@@ -253,15 +221,16 @@ ssmp_color_buf_init_platf(ssmp_color_buf_t* cbuf, int (*color)(int))
       exit(-1);
     }
   
-  uint32_t size_from = num_ues * sizeof(uint8_t);
+  uint32_t size_from = num_ues * sizeof(uint32_t);
   if (size_from % SSMP_CACHE_LINE_SIZE)
     {
-      size_pad = (SSMP_CACHE_LINE_SIZE - (size_from % SSMP_CACHE_LINE_SIZE)) / sizeof(uint8_t);
-      size_from += size_pad * sizeof(uint8_t);
+      size_pad = (SSMP_CACHE_LINE_SIZE - (size_from % SSMP_CACHE_LINE_SIZE)) / sizeof(uint32_t);
+      size_from += size_pad * sizeof(uint32_t);
     }
 
 
-  cbuf->from = (uint8_t*) memalign(SSMP_CACHE_LINE_SIZE, size_from);
+  cbuf->from = (uint32_t*) memalign(SSMP_CACHE_LINE_SIZE, size_from);
+  cbuf->mask = NULL;		/* no doorbell on the SPARC */
   if (cbuf->from == NULL)
     {
       perror("malloc @ ssmp_color_buf_init");
@@ -291,6 +260,34 @@ ssmp_color_buf_free_platf(ssmp_color_buf_t* cbuf)
   free(cbuf->from);
 }
 
+static void
+ssmp_barrier_set(int barrier_num, const uint64_t* participants, int (*color)(int))
+{
+  ssmp_barrier_t* b = &ssmp_barrier[barrier_num];
+  uint32_t ue, num_part = 0;
+  for (ue = 0; ue < ssmp_num_ues_; ue++)
+    {
+      if (color != NULL)
+	{
+	  num_part += (color(ue) != 0);
+	}
+      else
+	{
+	  num_part += (participants[ue / 64] >> (ue % 64)) & 1;
+	}
+    }
+
+  uint32_t w;
+  for (w = 0; w < SSMP_MAX_UES / 64; w++)
+    {
+      b->participants[w] = participants[w];
+    }
+  b->color = color;
+  b->num_participants = num_part;
+  b->ticket = 0;
+  b->cleared = 0;
+}
+
 void
 ssmp_barrier_init_platf(int barrier_num, long long int participants, int (*color)(int))
 {
@@ -298,10 +295,36 @@ ssmp_barrier_init_platf(int barrier_num, long long int participants, int (*color
     {
       return;
     }
-  ssmp_barrier[barrier_num].participants = 0xFFFFFFFFFFFFFFFF;
-  ssmp_barrier[barrier_num].color = color;
-  ssmp_barrier[barrier_num].ticket = 0;
-  ssmp_barrier[barrier_num].cleared = 0;
+
+  /* all ones -> all cores, else the bitmap of cores 0 .. 63 */
+  uint64_t bpar = (uint64_t) participants;
+  uint64_t mask[SSMP_MAX_UES / 64];
+  uint32_t w;
+  for (w = 0; w < SSMP_MAX_UES / 64; w++)
+    {
+      mask[w] = (bpar == 0xFFFFFFFFFFFFFFFF) ? bpar : 0;
+    }
+  mask[0] = bpar;
+
+  ssmp_barrier_set(barrier_num, mask, color);
+}
+
+void
+ssmp_barrier_init_mask_platf(int barrier_num, const uint64_t* participants)
+{
+  if (barrier_num >= SSMP_NUM_BARRIERS)
+    {
+      return;
+    }
+
+  uint64_t mask[SSMP_MAX_UES / 64];
+  uint32_t w;
+  for (w = 0; w < SSMP_MAX_UES / 64; w++)
+    {
+      mask[w] = (w < (ssmp_num_ues_ + 63) / 64) ? participants[w] : 0;
+    }
+
+  ssmp_barrier_set(barrier_num, mask, NULL);
 }
 
 void 
@@ -319,32 +342,20 @@ ssmp_barrier_wait_platf(int barrier_num)
   int (*col)(int);
   col = b->color;
 
-  uint64_t bpar = (uint64_t) b->participants;
-  uint32_t num_part = 0;
+  uint32_t num_part = b->num_participants;
 
-  int from;
-  for (from = 0; from < ssmp_num_ues_; from++) 
+  /* if there is a color function it has priority */
+  if (col != NULL) 
     {
-      /* if there is a color function it has priority */
-      if (col != NULL) 
+      if (!col(ssmp_id_))
 	{
-	  num_part += col(from);
-	  if (from == ssmp_id_ && !col(from))
-	    {
-	      return;
-	    }
-	}
-      else 
-	{
-	  uint32_t is_part = (uint32_t) (bpar & 0x0000000000000001);
-	  num_part += is_part;
-	  if (ssmp_id_ == from && !is_part)
-	    {
-	      return;
-	    }
-	  bpar >>= 1;
+	  return;
 	}
     }
+  else if (!((b->participants[ssmp_id_ / 64] >> (ssmp_id_ % 64)) & 1))
+    {
+      return;
+    }
   
   _mm_lfence();
   uint32_t reps = 1;
@@ -398,3 +409,17 @@ inline ticks getticks_platf(void)
   __asm__ __volatile__ ("rd %%tick, %0" : "=r" (ret) : "0" (ret));
   return ret;
 }
+
+inline ticks getticks_fenced_platf(void)
+{
+  ticks ret = 0;
+  __asm__ __volatile__ ("membar #Sync\n\trd %%tick, %0" : "=r" (ret) : "0" (ret) : "memory");
+  return ret;
+}
+
+/* measured against the clock */
+double
+ticks_per_ns_platf()
+{
+  return 0;
+}
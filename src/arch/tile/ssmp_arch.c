@@ -29,7 +29,7 @@
 
 #include "ssmp.h"
 
-uint8_t id_to_core[] =
+uint32_t id_to_core[] =
   {
     0, 1, 2, 3, 4, 5,
     6, 7, 8, 9, 10, 11,
@@ -116,6 +116,13 @@ ssmp_mem_init_platf(int id, int num_ues)
     }
 }
 
+/* messages go over the UDN: there are no buffers to restrict to the peers */
+void
+ssmp_mem_init_peers_platf(int id, int num_ues, const uint32_t* peers, uint32_t num_peers)
+{
+  ssmp_mem_init_platf(id, num_ues);
+}
+
 
 void
 ssmp_term_platf() 
@@ -166,6 +173,23 @@ ssmp_barrier_init_platf(int barrier_num, long long int participants, int (*color
   tmc_sync_barrier_init(ssmp_barrier + barrier_num, num_part);
 }
 
+void
+ssmp_barrier_init_mask_platf(int barrier_num, const uint64_t* participants)
+{
+  if (barrier_num >= SSMP_NUM_BARRIERS)
+    {
+      return;
+    }
+
+  uint32_t n, num_part = 0;
+  for (n = 0; n < ssmp_num_ues_; n++)
+    {
+      num_part += (participants[n / 64] >> (n % 64)) & 1;
+    }
+
+  tmc_sync_barrier_init(ssmp_barrier + barrier_num, num_part);
+}
+
 void 
 ssmp_barrier_wait_platf(int barrier_num) 
 {
@@ -202,3 +226,17 @@ getticks_platf()
 {
   return get_cycle_count();
 }
+
+inline ticks
+getticks_fenced_platf()
+{
+  _mm_mfence();
+  return get_cycle_count();
+}
+
+/* measured against the clock */
+double
+ticks_per_ns_platf()
+{
+  return 0;
+}
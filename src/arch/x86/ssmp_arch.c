@@ -36,9 +36,9 @@
 
 int ssmp_num_ues_;
 int ssmp_id_;
+extern int ssmp_opts_;
 int last_recv_from;
 ssmp_barrier_t* ssmp_barrier;
-volatile int* ues_initialized;
 static uint32_t ssmp_my_core;
 
 static ssmp_msg_t* ssmp_mem;
@@ -46,65 +46,58 @@ volatile ssmp_msg_t** ssmp_recv_buf;
 volatile ssmp_msg_t** ssmp_send_buf;
 static ssmp_chunk_t* ssmp_chunk_mem;
 ssmp_chunk_t** ssmp_chunk_buf;
+int ssmp_doorbell_on;		/* more than SSMP_DOORBELL_MIN_UES processes */
+static ssmp_doorbell_t* ssmp_doorbell;	/* own */
+static ssmp_doorbell_t** ssmp_send_doorbell;
+uint32_t* ssmp_peers;		/* the cores this core receives from, sorted */
+uint32_t ssmp_num_peers;
+static uint32_t ssmp_doorbell_words;
+static uint32_t ssmp_doorbell_word;	/* the bit of this core in the doorbells */
+static uint64_t ssmp_doorbell_bit;
+
+static size_t ssmp_mem_size;
+static char* ssmp_core_mem_base;
+static size_t ssmp_core_mem_size;	/* the buffers and the doorbell of a core */
 
 
 /* ------------------------------------------------------------------------------- */
 /* init / term the MP system */
 /* ------------------------------------------------------------------------------- */
 
+/*
+  One segment, created before forking and inherited by every process: the barriers,
+  the chunk buffers, and for every core the buffers of the other cores followed by
+  its doorbell. ssmp_mem_init only computes offsets. The pages of buffers that are
+  never used are never allocated.
+*/
 void
 ssmp_init_platf(int num_procs)
 {
-  //create the shared space which will be managed by the allocator
-  unsigned int sizeb, sizeui, sizecnk, size;;
+  size_t sizeb, sizecnk, size;
 
   sizeb = SSMP_NUM_BARRIERS * sizeof(ssmp_barrier_t);
   SSMP_INC_ALIGN(sizeb);
-  sizeui = num_procs * sizeof(int);
-  SSMP_INC_ALIGN(sizeui);
   sizecnk = num_procs * sizeof(ssmp_chunk_t);
   SSMP_INC_ALIGN(sizecnk);  
-  size = sizeb + sizeui + sizecnk;
-
-  char keyF[100];
-  sprintf(keyF, SSMP_MEM_NAME);
+  ssmp_core_mem_size = (num_procs - 1) * sizeof(ssmp_msg_t)
+    + ((num_procs + 63) / 64) * sizeof(ssmp_doorbell_t);
+  size = sizeb + sizecnk + num_procs * ssmp_core_mem_size;
 
-  int ssmpfd = shm_open(keyF, O_CREAT | O_EXCL | O_RDWR, S_IRWXU | S_IRWXG);
-  if (ssmpfd<0)
-    {
-      if (errno != EEXIST)
-	{
-	  perror("In shm_open");
-	  exit(1);
-	}
-
-      //this time it is ok if it already exists
-      ssmpfd = shm_open(keyF, O_CREAT | O_RDWR, S_IRWXU | S_IRWXG);
-      if (ssmpfd<0)
-	{
-	  perror("In shm_open");
-	  exit(1);
-	}
-    }
-  else
-    {
-      if (ftruncate(ssmpfd, size) < 0) {
-	perror("ftruncate failed\n");
-	exit(1);
-      }
-    }
-
-  ssmp_mem = (ssmp_msg_t*) mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, ssmpfd, 0);
-  if (ssmp_mem == NULL)
+  ssmp_mem = (ssmp_msg_t*) mmap(NULL, size, PROT_READ | PROT_WRITE,
+				MAP_SHARED | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  if (ssmp_mem == MAP_FAILED)
     {
       perror("ssmp_mem = NULL\n");
       exit(134);
     }
+  ssmp_mem_size = size;
+
+  ssmp_num_ues_ = num_procs;	/* for ssmp_barrier_init */
 
   char* mem_just_int = (char*) ssmp_mem;
   ssmp_barrier = (ssmp_barrier_t*) (mem_just_int);
-  ues_initialized = (volatile int*) (mem_just_int + sizeb);
-  ssmp_chunk_mem = (ssmp_chunk_t*) (mem_just_int + sizeb + sizeui);
+  ssmp_chunk_mem = (ssmp_chunk_t*) (mem_just_int + sizeb);
+  ssmp_core_mem_base = mem_just_int + sizeb + sizecnk;
 
   int bar;
   for (bar = 0; bar < SSMP_NUM_BARRIERS; bar++) 
@@ -116,160 +109,165 @@ ssmp_init_platf(int num_procs)
   _mm_mfence();
 }
 
+/* SSMP_OPT_PREFAULT: lock the pages of [addr, addr + len), which maps them. Without
+   the permission to lock (RLIMIT_MEMLOCK), they are only mapped, by reading them */
+static void
+ssmp_prefault(volatile void* addr, size_t len)
+{
+  static int mlock_failed = 0;
+  uintptr_t page = sysconf(_SC_PAGESIZE);
+  uintptr_t start = (uintptr_t) addr & ~(page - 1);
+  uintptr_t end = (uintptr_t) addr + len;
+
+  if (!mlock_failed && mlock((void*) start, end - start) == 0)
+    {
+      return;
+    }
+
+  if (!mlock_failed && ssmp_id_ == 0)
+    {
+      perror("** mlock @ ssmp_mem_init: prefaulting only");
+    }
+  mlock_failed = 1;
+
+  for (; start < end; start += page)
+    {
+      (void) *(volatile char*) start;
+    }
+}
+
+/* the buffers and the doorbell of core */
+static inline ssmp_msg_t*
+ssmp_core_mem(uint32_t core)
+{
+  return (ssmp_msg_t*) (ssmp_core_mem_base + core * ssmp_core_mem_size);
+}
+
+static int
+ssmp_peer_cmp(const void* a, const void* b)
+{
+  uint32_t pa = *(const uint32_t*) a, pb = *(const uint32_t*) b;
+  return (pa > pb) - (pa < pb);
+}
+
 void
 ssmp_mem_init_platf(int id, int num_ues) 
-{  
+{
+  uint32_t* peers = (uint32_t*) malloc(num_ues * sizeof(uint32_t));
+  if (peers == NULL)
+    {
+      perror("malloc@ ssmp_mem_init\n");
+      exit(-1);
+    }
+
+  uint32_t core, num_peers = 0;
+  for (core = 0; core < num_ues; core++)
+    {
+      if (core != id)
+	{
+	  peers[num_peers++] = core;
+	}
+    }
+
+  ssmp_mem_init_peers_platf(id, num_ues, peers, num_peers);
+  free(peers);
+}
+
+void
+ssmp_mem_init_peers_platf(int id, int num_ues, const uint32_t* peers, uint32_t num_peers)
+{
   ssmp_id_ = id;
   ssmp_num_ues_ = num_ues;
   last_recv_from = (id + 1) % num_ues;
+  ssmp_doorbell_on = (num_ues > SSMP_DOORBELL_MIN_UES);
+  ssmp_doorbell_words = (num_ues + 63) / 64;
+  ssmp_doorbell_word = id / 64;
+  ssmp_doorbell_bit = 1ULL << (id % 64);
 
   ssmp_recv_buf = (volatile ssmp_msg_t**) memalign(SSMP_CACHE_LINE_SIZE, num_ues * sizeof(ssmp_msg_t*));
   ssmp_send_buf = (volatile ssmp_msg_t**) memalign(SSMP_CACHE_LINE_SIZE, num_ues * sizeof(ssmp_msg_t*));
   ssmp_chunk_buf = (ssmp_chunk_t**) malloc(num_ues * sizeof(ssmp_chunk_t*));
-  if (ssmp_recv_buf == NULL || ssmp_send_buf == NULL || ssmp_chunk_buf == NULL)
+  ssmp_send_doorbell = (ssmp_doorbell_t**) malloc(num_ues * sizeof(ssmp_doorbell_t*));
+  ssmp_peers = (uint32_t*) malloc((num_peers + 1) * sizeof(uint32_t));
+  if (ssmp_recv_buf == NULL || ssmp_send_buf == NULL || ssmp_chunk_buf == NULL
+      || ssmp_send_doorbell == NULL || ssmp_peers == NULL)
     {
       perror("malloc@ ssmp_mem_init\n");
       exit(-1);
     }
 
-  char keyF[100];
-  unsigned int size = (num_ues - 1) * sizeof(ssmp_msg_t);
-  unsigned int core;
-  sprintf(keyF, "/ssmp_core%03d", id);
-  
-  if (num_ues == 1) return;
-
-  
-  int ssmpfd = shm_open(keyF, O_CREAT | O_EXCL | O_RDWR, S_IRWXU | S_IRWXG);
-  if (ssmpfd < 0)
+  /* sorted and without duplicates */
+  uint32_t core, p;
+  memcpy(ssmp_peers, peers, num_peers * sizeof(uint32_t));
+  qsort(ssmp_peers, num_peers, sizeof(uint32_t), ssmp_peer_cmp);
+  ssmp_num_peers = 0;
+  for (p = 0; p < num_peers; p++)
     {
-      if (errno != EEXIST)
+      if (ssmp_peers[p] >= num_ues)
 	{
-	  perror("In shm_open");
-	  exit(1);
+	  printf("** peer %u of core %d is not a core (%d cores)\n", ssmp_peers[p], id, num_ues);
+	  exit(-1);
 	}
-
-      ssmpfd = shm_open(keyF, O_CREAT | O_RDWR, S_IRWXU | S_IRWXG);
-      if (ssmpfd<0)
-	{
-	  perror("In shm_open");
-	  exit(1);
-	}
-    }
-  else
-    {
-      if (ftruncate(ssmpfd, size) < 0)
+      if (ssmp_peers[p] != id && (ssmp_num_peers == 0 || ssmp_peers[ssmp_num_peers - 1] != ssmp_peers[p]))
 	{
-	  perror("ftruncate failed\n");
-	  exit(1);
+	  ssmp_peers[ssmp_num_peers++] = ssmp_peers[p];
 	}
     }
+  ssmp_peers[ssmp_num_peers] = (ssmp_num_peers > 0) ? ssmp_peers[0] : id; /* for prefetching the next */
 
-  ssmp_msg_t* tmp = (ssmp_msg_t*) mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, ssmpfd, 0);
-  if ((unsigned long) tmp % SSMP_CACHE_LINE_SIZE)
-    {
-      printf("** the messaging buffers are not cache aligned.\n");
-    }
-  if (tmp == NULL)
-    {
-      perror("tmp = NULL\n");
-      exit(134);
-    }
-
+  /* the buffer of core in the memory of the core to: the other cores in order */
+  ssmp_msg_t* own = ssmp_core_mem(id);
   for (core = 0; core < num_ues; core++)
     {
       ssmp_chunk_buf[core] = ssmp_chunk_mem + core;
-      ssmp_chunk_buf[core]->state = 0;
-
-      if (id == core)
+      ssmp_recv_buf[core] = NULL;
+      if (core == id)
 	{
+	  ssmp_send_buf[core] = NULL;
+	  ssmp_send_doorbell[core] = NULL;
 	  continue;
 	}
-      ssmp_recv_buf[core] = tmp + ((core > id) ? (core - 1) : core);
-      ssmp_recv_buf[core]->state = 0;
-    }
 
-  /*********************************************************************************
-    initialized own buffer
-    ********************************************************************************
-    */
+      ssmp_msg_t* mem = ssmp_core_mem(core);
+      ssmp_send_buf[core] = mem + ((core < id) ? (id - 1) : id);
+      ssmp_send_doorbell[core] = (ssmp_doorbell_t*) (mem + num_ues - 1);
+    }
 
-  ssmp_barrier_wait(0);
-  
-  for (core = 0; core < num_ues; core++)
+  for (p = 0; p < ssmp_num_peers; p++)
     {
-      if (core == id)
-	{
-	  continue;
-	}
-
-      sprintf(keyF, "/ssmp_core%03d", core);
-  
-      int ssmpfd = shm_open(keyF, O_CREAT | O_EXCL | O_RDWR, S_IRWXU | S_IRWXG);
-      if (ssmpfd < 0)
-	{
-	  if (errno != EEXIST)
-	    {
-	      perror("In shm_open");
-	      exit(1);
-	    }
+      core = ssmp_peers[p];
+      ssmp_recv_buf[core] = own + ((core > id) ? (core - 1) : core);
+    }
+  ssmp_doorbell = (ssmp_doorbell_t*) (own + num_ues - 1);
 
-	  ssmpfd = shm_open(keyF, O_CREAT | O_RDWR, S_IRWXU | S_IRWXG);
-	  if (ssmpfd<0)
-	    {
-	      perror("In shm_open");
-	      exit(1);
-	    }
-	}
-      else
+  if (ssmp_opts_ & SSMP_OPT_PREFAULT)
+    {
+      /* the barriers and chunk buffers, the own buffers, and the buffers to send
+	 to, unless only some cores are declared as peers (then unknown) */
+      ssmp_prefault(ssmp_mem, ssmp_core_mem_base - (char*) ssmp_mem);
+      ssmp_prefault(own, ssmp_core_mem_size);
+      for (core = 0; core < num_ues && ssmp_num_peers == num_ues - 1; core++)
 	{
-	  if (ftruncate(ssmpfd, size) < 0)
+	  if (core == id)
 	    {
-	      perror("ftruncate failed\n");
-	      exit(1);
+	      continue;
 	    }
+	  ssmp_prefault(ssmp_send_buf[core], sizeof(ssmp_msg_t));
+	  ssmp_prefault(ssmp_send_doorbell[core] + ssmp_doorbell_word, sizeof(ssmp_doorbell_t));
 	}
-
-      ssmp_msg_t* tmp = (ssmp_msg_t*) mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, ssmpfd, 0);
-      if (tmp == NULL)
-	{
-	  perror("tmp = NULL\n");
-	  exit(134);
-	}
-
-      ssmp_send_buf[core] = tmp + ((core < id) ? (id - 1) : id);
-    }
-
-  ues_initialized[id] = 1;
-
-  /* SP("waiting for all to be initialized!"); */
-  int ue;
-  for (ue = 0; ue < num_ues; ue++)
-    {
-      while(!ues_initialized[ue]) 
-	{
-	  _mm_pause();
-	  _mm_mfence();
-	};
     }
-  /* SP("\t\t\tall initialized!"); */
 }
 
 
 void
 ssmp_term_platf() 
 {
-  if (ssmp_id_ == 0 && shm_unlink(SSMP_MEM_NAME) < 0)
-    {
-      shm_unlink("/ssmp_mem");
-    }
-  char keyF[100];
-  sprintf(keyF, "/ssmp_core%03d", ssmp_id_);
-  shm_unlink(keyF);
-
   free(ssmp_recv_buf);
   free(ssmp_send_buf);
   free(ssmp_chunk_buf);
+  free(ssmp_send_doorbell);
+  free(ssmp_peers);
+  munmap(ssmp_mem, ssmp_mem_size);
 }
 
 
@@ -297,7 +295,7 @@ ssmp_color_buf_init_platf(ssmp_color_buf_t* cbuf, int (*color)(int))
   uint32_t ue, num_ues = 0;
   for (ue = 0; ue < ssmp_num_ues_; ue++) 
     {
-      if (ue == ssmp_id_) 
+      if (ue == ssmp_id_ || ssmp_recv_buf[ue] == NULL) /* not a peer */
 	{
 	  participants[ue] = 0;
 	  continue;
@@ -311,6 +309,7 @@ ssmp_color_buf_init_platf(ssmp_color_buf_t* cbuf, int (*color)(int))
     }
 
   cbuf->num_ues = num_ues;
+  cbuf->start_recv_from = 0;
 
   uint32_t size_buf = num_ues * sizeof(ssmp_msg_t*);
   uint32_t size_pad = 0;
@@ -335,7 +334,7 @@ ssmp_color_buf_init_platf(ssmp_color_buf_t* cbuf, int (*color)(int))
       exit(-1);
     }
   
-  uint32_t size_from = num_ues * sizeof(uint8_t);
+  uint32_t size_from = num_ues * sizeof(uint32_t);
 
   if (size_from % SSMP_CACHE_LINE_SIZE)
     {
@@ -344,8 +343,9 @@ ssmp_color_buf_init_platf(ssmp_color_buf_t* cbuf, int (*color)(int))
     }
 
 
-  cbuf->from = (uint8_t*) malloc(size_from);
-  if (cbuf->from == NULL)
+  cbuf->from = (uint32_t*) malloc(size_from);
+  cbuf->mask = (uint64_t*) calloc((ssmp_num_ues_ + 63) / 64, sizeof(uint64_t));
+  if (cbuf->from == NULL || cbuf->mask == NULL)
     {
       perror("malloc @ ssmp_color_buf_init");
       exit(-1);
@@ -359,6 +359,7 @@ ssmp_color_buf_init_platf(ssmp_color_buf_t* cbuf, int (*color)(int))
 	  cbuf->buf[buf_num] = ssmp_recv_buf[ue];
 	  cbuf->buf_state[buf_num] = &ssmp_recv_buf[ue]->state;
 	  cbuf->from[buf_num] = ue;
+	  cbuf->mask[ue / 64] |= 1ULL << (ue % 64);
 	  buf_num++;
 	}
     }
@@ -373,6 +374,35 @@ ssmp_color_buf_free_platf(ssmp_color_buf_t* cbuf)
   free(cbuf->buf);
   free(cbuf->buf_state);
   free(cbuf->from);
+  free(cbuf->mask);
+}
+
+static void
+ssmp_barrier_set(int barrier_num, const uint64_t* participants, int (*color)(int))
+{
+  ssmp_barrier_t* b = &ssmp_barrier[barrier_num];
+  uint32_t ue, num_part = 0;
+  for (ue = 0; ue < ssmp_num_ues_; ue++)
+    {
+      if (color != NULL)
+	{
+	  num_part += (color(ue) != 0);
+	}
+      else
+	{
+	  num_part += (participants[ue / 64] >> (ue % 64)) & 1;
+	}
+    }
+
+  uint32_t w;
+  for (w = 0; w < SSMP_MAX_UES / 64; w++)
+    {
+      b->participants[w] = participants[w];
+    }
+  b->color = color;
+  b->num_participants = num_part;
+  b->ticket = 0;
+  b->cleared = 0;
 }
 
 void
@@ -382,10 +412,36 @@ ssmp_barrier_init_platf(int barrier_num, long long int participants, int (*color
     {
       return;
     }
-  ssmp_barrier[barrier_num].participants = 0xFFFFFFFFFFFFFFFF;
-  ssmp_barrier[barrier_num].color = color;
-  ssmp_barrier[barrier_num].ticket = 0;
-  ssmp_barrier[barrier_num].cleared = 0;
+
+  /* all ones -> all cores, else the bitmap of cores 0 .. 63 */
+  uint64_t bpar = (uint64_t) participants;
+  uint64_t mask[SSMP_MAX_UES / 64];
+  uint32_t w;
+  for (w = 0; w < SSMP_MAX_UES / 64; w++)
+    {
+      mask[w] = (bpar == 0xFFFFFFFFFFFFFFFF) ? bpar : 0;
+    }
+  mask[0] = bpar;
+
+  ssmp_barrier_set(barrier_num, mask, color);
+}
+
+void
+ssmp_barrier_init_mask_platf(int barrier_num, const uint64_t* participants)
+{
+  if (barrier_num >= SSMP_NUM_BARRIERS)
+    {
+      return;
+    }
+
+  uint64_t mask[SSMP_MAX_UES / 64];
+  uint32_t w;
+  for (w = 0; w < SSMP_MAX_UES / 64; w++)
+    {
+      mask[w] = (w < (ssmp_num_ues_ + 63) / 64) ? participants[w] : 0;
+    }
+
+  ssmp_barrier_set(barrier_num, mask, NULL);
 }
 
 void 
@@ -403,32 +459,20 @@ ssmp_barrier_wait_platf(int barrier_num)
   int (*col)(int);
   col = b->color;
 
-  uint64_t bpar = (uint64_t) b->participants;
-  uint32_t num_part = 0;
+  uint32_t num_part = b->num_participants;
 
-  int from;
-  for (from = 0; from < ssmp_num_ues_; from++) 
+  /* if there is a color function it has priority */
+  if (col != NULL) 
     {
-      /* if there is a color function it has priority */
-      if (col != NULL) 
-	{
-	  num_part += col(from);
-	  if (from == ssmp_id_ && !col(from))
-	    {
-	      return;
-	    }
-	}
-      else 
+      if (!col(ssmp_id_))
 	{
-	  uint32_t is_part = (uint32_t) (bpar & 0x0000000000000001);
-	  num_part += is_part;
-	  if (ssmp_id_ == from && !is_part)
-	    {
-	      return;
-	    }
-	  bpar >>= 1;
+	  return;
 	}
     }
+  else if (!((b->participants[ssmp_id_ / 64] >> (ssmp_id_ % 64)) & 1))
+    {
+      return;
+    }
   
   _mm_lfence();
   uint32_t reps = 1;
@@ -465,6 +509,96 @@ ssmp_barrier_wait_platf(int barrier_num)
   PD("<<Cleared barrier %d (v: %d)", barrier_num, version);
 }
 
+/* ------------------------------------------------------------------------------- */
+/* doorbell (more than SSMP_DOORBELL_MIN_UES processes) */
+/* ------------------------------------------------------------------------------- */
+
+/*
+  A sender sets its bit after writing the message. A receiver clears a bit before
+  checking the buffer of the sender: if the bit is set again later, the buffer is
+  checked again, thus no message is missed. The receives from a specific core do
+  not touch the doorbell, so a bit might be stale; clearing it is then enough.
+*/
+
+void
+ssmp_doorbell_ring_platf(uint32_t to)
+{
+  __sync_fetch_and_or(&ssmp_send_doorbell[to][ssmp_doorbell_word].bits, ssmp_doorbell_bit);
+}
+
+static inline int
+ssmp_doorbell_take(uint32_t from, ssmp_msg_t* msg)
+{
+  volatile ssmp_msg_t* tmpm = ssmp_recv_buf[from];
+  const ssmp_proto_t* proto = &ssmp_proto_peer[from];
+  if (!proto->poll_fn(&tmpm->state, SSMP_BUF_MESSG))
+    {
+      return 0;
+    }
+
+  memcpy((void*) msg, (const void*) tmpm, SSMP_CACHE_LINE_SIZE);
+  msg->sender = from;
+  proto->update_fn(&tmpm->state, SSMP_BUF_EMPTY);
+  return 1;
+}
+
+/* receive from any of the cores in mask (NULL: any core). With start != NULL, the
+   scan starts from core *start, which is then set to the core after the sender */
+void
+ssmp_recv_doorbell_platf(const uint64_t* mask, uint32_t* start, ssmp_msg_t* msg)
+{
+  uint32_t num_words = ssmp_doorbell_words;
+  uint32_t start_word = (start != NULL) ? (*start / 64) : 0;
+  uint32_t start_bit = (start != NULL) ? (*start % 64) : 0;
+
+  while (1)
+    {
+      /* num_words + 1 steps: the start word is split in the bits from start_bit on
+	 (first step) and the ones before it (last step) */
+      uint32_t i;
+      for (i = 0; i <= num_words; i++)
+	{
+	  uint32_t w = start_word + i;
+	  if (w >= num_words)
+	    {
+	      w -= num_words;
+	    }
+
+	  uint64_t bits = ssmp_doorbell[w].bits;
+	  if (mask != NULL)
+	    {
+	      bits &= mask[w];
+	    }
+	  if (i == 0)
+	    {
+	      bits &= ~0ULL << start_bit;
+	    }
+	  else if (i == num_words)
+	    {
+	      bits &= ~(~0ULL << start_bit);
+	    }
+
+	  while (bits)
+	    {
+	      uint32_t b = __builtin_ctzll(bits);
+	      bits &= bits - 1;
+	      __sync_fetch_and_and(&ssmp_doorbell[w].bits, ~(1ULL << b));
+
+	      uint32_t from = w * 64 + b;
+	      if (ssmp_doorbell_take(from, msg))
+		{
+		  if (start != NULL)
+		    {
+		      *start = (from + 1 == ssmp_num_ues_) ? 0 : from + 1;
+		    }
+		  return;
+		}
+	    }
+	}
+      _mm_pause();
+    }
+}
+
 /* ------------------------------------------------------------------------------- */
 /* help functions */
 /* ------------------------------------------------------------------------------- */
@@ -500,3 +634,48 @@ inline ticks getticks_platf(void)
   return ( (unsigned long long)lo)|( ((unsigned long long)hi)<<32 );
 }
 #endif
+
+/* lfence: rdtsc starts after the previous instructions completed, and the next
+   ones start after rdtsc */
+#if defined(__i386__)
+inline ticks getticks_fenced_platf(void)
+{
+  ticks ret;
+
+  __asm__ __volatile__("lfence\n\trdtsc\n\tlfence" : "=A" (ret) : : "memory");
+  return ret;
+}
+#elif defined(__x86_64__)
+inline ticks getticks_fenced_platf(void)
+{
+  unsigned hi, lo;
+  __asm__ __volatile__ ("lfence\n\trdtsc\n\tlfence" : "=a"(lo), "=d"(hi) : : "memory");
+  return ( (unsigned long long)lo)|( ((unsigned long long)hi)<<32 );
+}
+#endif
+
+void
+ssmp_cpuid(uint32_t leaf, uint32_t* a, uint32_t* b, uint32_t* c, uint32_t* d)
+{
+  __asm__ __volatile__ ("cpuid" : "=a" (*a), "=b" (*b), "=c" (*c), "=d" (*d) : "a" (leaf), "c" (0));
+}
+
+/* CPUID leaf 0x15: the TSC runs at crystal * ebx / eax. Only when the crystal
+   frequency is enumerated, since the invariant TSC is the same on all cores */
+double
+ticks_per_ns_platf()
+{
+  uint32_t a, b, c, d;
+  ssmp_cpuid(0, &a, &b, &c, &d);
+  if (a < 0x15)
+    {
+      return 0;
+    }
+
+  ssmp_cpuid(0x15, &a, &b, &c, &d);
+  if (a == 0 || b == 0 || c == 0)
+    {
+      return 0;
+    }
+  return (double) c * b / a / 1e9;
+}
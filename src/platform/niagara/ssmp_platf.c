@@ -45,13 +45,18 @@ inline void
 ssmp_recv_from_platf(uint32_t from, volatile ssmp_msg_t* msg) 
 {
   volatile ssmp_msg_t* tmpm = ssmp_recv_buf[from];
-  while(tmpm->state != SSMP_BUF_MESSG) 
-    {
-      PAUSE;
-    }
+  const ssmp_proto_t* proto = &ssmp_proto_peer[from];
+  proto->wait_fn(&tmpm->state, SSMP_BUF_MESSG);
   
   memcpy64((volatile uint64_t*) msg, (const uint64_t*) tmpm, SSMP_CACHE_LINE_DW);
-  tmpm->state = SSMP_BUF_EMPTY;
+  msg->tag = tmpm->tag;	/* outside the memcpy64 words */
+  proto->update_fn(&tmpm->state, SSMP_BUF_EMPTY);
+}
+
+inline int
+ssmp_recv_is_ready_platf(uint32_t from)
+{
+  return (ssmp_recv_buf[from]->state == SSMP_BUF_MESSG);
 }
 
 inline void 
@@ -68,6 +73,7 @@ ssmp_recv_platf(ssmp_msg_t* msg)
 	    {
 	      volatile ssmp_msg_t* tmpm = ssmp_recv_buf[from];
 	      memcpy64((volatile uint64_t*) msg, (const uint64_t*) tmpm, SSMP_CACHE_LINE_DW);
+	      msg->tag = tmpm->tag;
 	      msg->sender = from;
 
 	      tmpm->state = SSMP_BUF_EMPTY;
@@ -93,6 +99,7 @@ ssmp_recv_color_platf(ssmp_color_buf_t* cbuf, ssmp_msg_t* msg)
 	    {
 	      volatile ssmp_msg_t* tmpm = cbuf->buf[start_recv_from];
 	      memcpy64((volatile uint64_t*) msg, (const uint64_t*) tmpm, SSMP_CACHE_LINE_DW);
+	      msg->tag = tmpm->tag;
 	      tmpm->state = SSMP_BUF_EMPTY;
 	      msg->sender = cbuf->from[start_recv_from];
 
@@ -107,12 +114,11 @@ ssmp_recv_color_platf(ssmp_color_buf_t* cbuf, ssmp_msg_t* msg)
 }
 
 
-static uint32_t start_recv_from = 0; /* keeping from which core to start the recv from next */
-
 inline void
 ssmp_recv_color_start_platf(ssmp_color_buf_t* cbuf, ssmp_msg_t* msg)
 {
   uint32_t num_ues = cbuf->num_ues;
+  uint32_t start_recv_from = cbuf->start_recv_from;
   SSMP_FLAG_TYPE** cbuf_state = cbuf->buf_state;
   while(1) 
     {
@@ -124,6 +130,7 @@ ssmp_recv_color_start_platf(ssmp_color_buf_t* cbuf, ssmp_msg_t* msg)
 	      volatile ssmp_msg_t* tmpm = cbuf->buf[start_recv_from];
 
 	      memcpy64((volatile uint64_t*) msg, (const uint64_t*) tmpm, SSMP_CACHE_LINE_DW);
+	      msg->tag = tmpm->tag;
 	      tmpm->state = SSMP_BUF_EMPTY;
 	      msg->sender = cbuf->from[start_recv_from];
 
@@ -132,6 +139,7 @@ ssmp_recv_color_start_platf(ssmp_color_buf_t* cbuf, ssmp_msg_t* msg)
 		{
 		  start_recv_from = 0;
 		}
+	      cbuf->start_recv_from = start_recv_from;
 	      return;
 	    }
 	}
@@ -143,8 +151,8 @@ ssmp_recv_color_start_platf(ssmp_color_buf_t* cbuf, ssmp_msg_t* msg)
 void
 ssmp_recv_from_big_platf(int from, void* data, size_t length) 
 {
-  int last_chunk = length % SSMP_CHUNK_SIZE;
-  int num_chunks = length / SSMP_CHUNK_SIZE;
+  int last_chunk = length % SSMP_CHUNK_DATA;
+  int num_chunks = length / SSMP_CHUNK_DATA;
 
   while(num_chunks--)
     {
@@ -153,8 +161,8 @@ ssmp_recv_from_big_platf(int from, void* data, size_t length)
 	  PAUSE;
 	}
 
-      memcpy(data, ssmp_chunk_buf[from], SSMP_CHUNK_SIZE);
-      data = ((char*) data) + SSMP_CHUNK_SIZE;
+      memcpy(data, ssmp_chunk_buf[from], SSMP_CHUNK_DATA);
+      data = ((char*) data) + SSMP_CHUNK_DATA;
 
       ssmp_chunk_buf[from]->state = 0;
     }
@@ -184,13 +192,12 @@ inline void
 ssmp_send_platf(uint32_t to, volatile ssmp_msg_t* msg) 
 {
   volatile ssmp_msg_t* tmpm = ssmp_send_buf[to];
-  while (tmpm->state != SSMP_BUF_EMPTY)
-    {
-      PAUSE;
-    }
+  const ssmp_proto_t* proto = &ssmp_proto_peer[to];
+  proto->wait_fn(&tmpm->state, SSMP_BUF_EMPTY);
 
   memcpy64((volatile uint64_t*) tmpm, (const uint64_t*) msg, SSMP_CACHE_LINE_DW);
-  tmpm->state = SSMP_BUF_MESSG;
+  tmpm->tag = msg->tag;
+  proto->update_fn(&tmpm->state, SSMP_BUF_MESSG);
 }
 
 inline int
@@ -206,6 +213,7 @@ ssmp_send_no_sync_platf(uint32_t to, volatile ssmp_msg_t* msg)
 {
   volatile ssmp_msg_t* tmpm = ssmp_send_buf[to];
   memcpy64((volatile uint64_t*) tmpm, (const uint64_t*) msg, SSMP_CACHE_LINE_DW);
+  tmpm->tag = msg->tag;
   tmpm->state = SSMP_BUF_MESSG;
 }
 
@@ -213,8 +221,8 @@ ssmp_send_no_sync_platf(uint32_t to, volatile ssmp_msg_t* msg)
 void
 ssmp_send_big_platf(int to, void* data, size_t length) 
 {
-  int last_chunk = length % SSMP_CHUNK_SIZE;
-  int num_chunks = length / SSMP_CHUNK_SIZE;
+  int last_chunk = length % SSMP_CHUNK_DATA;
+  int num_chunks = length / SSMP_CHUNK_DATA;
 
   while(num_chunks--)
     {
@@ -223,8 +231,8 @@ ssmp_send_big_platf(int to, void* data, size_t length)
 	  PAUSE;
 	}
 
-      memcpy(ssmp_chunk_buf[ssmp_id_], data, SSMP_CHUNK_SIZE);
-      data = ((char*) data) + SSMP_CHUNK_SIZE;
+      memcpy(ssmp_chunk_buf[ssmp_id_], data, SSMP_CHUNK_DATA);
+      data = ((char*) data) + SSMP_CHUNK_DATA;
 
       ssmp_chunk_buf[ssmp_id_]->state = 1;
     }
@@ -251,3 +259,16 @@ set_numa_platf(int cpu)
 {
 
 }
+
+const char*
+ssmp_platform_name()
+{
+  return "niagara";
+}
+
+/* single-chip platform */
+inline uint32_t
+ssmp_cores_on_same_socket_platf(uint32_t core1, uint32_t core2)
+{
+  return 1;
+}
@@ -47,6 +47,12 @@ ssmp_recv_from_platf(uint32_t from, volatile ssmp_msg_t* msg)
 }
 
 
+inline int
+ssmp_recv_is_ready_platf(uint32_t from)
+{
+  return 1;			/* cannot really implement this on the Tilera */
+}
+
 inline void
 ssmp_recv_platf(ssmp_msg_t* msg) 
 {
@@ -110,3 +116,16 @@ void
 set_numa_platf(int cpu)
 {
 }
+
+const char*
+ssmp_platform_name()
+{
+  return "tilera";
+}
+
+/* single-chip platform */
+inline uint32_t
+ssmp_cores_on_same_socket_platf(uint32_t core1, uint32_t core2)
+{
+  return 1;
+}
@@ -0,0 +1,525 @@
+/*   
+ *   File: x86/ssmp_platf.c
+ *   Author: Vasileios Trigonakis <vasileios.trigonakis@epfl.ch>
+ *   Description: implementation of send, recv, etc. functions for x86 (generic,
+ *                AMD Opteron and Intel Xeon, selected at runtime)
+ *   x86/ssmp_platf.c is part of ssmp
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (C) 2013  Vasileios Trigonakis
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include "ssmp.h"
+
+extern volatile ssmp_msg_t** ssmp_recv_buf;
+extern volatile ssmp_msg_t** ssmp_send_buf;
+extern uint32_t* ssmp_peers;
+extern uint32_t ssmp_num_peers;
+extern ssmp_chunk_t** ssmp_chunk_buf;
+extern int ssmp_num_ues_;
+extern int ssmp_id_;
+extern int last_recv_from;
+extern ssmp_barrier_t* ssmp_barrier;
+
+uint32_t id_to_core[SSMP_MAX_UES];	/* identity, or the table of the platform */
+
+/* ------------------------------------------------------------------------------- */
+/* platforms: what differs between the x86 machines                              */
+/* ------------------------------------------------------------------------------- */
+
+typedef struct ssmp_platform
+{
+  const char* name;
+  const uint32_t* id_to_core;	/* the first num_cores ids (NULL: identity) */
+  uint32_t num_cores;
+  uint32_t (*socket_of)(uint32_t core);
+  void (*set_numa)(int cpu);
+  int scan_prefetch;		/* prefetchw the buffers while looking for messages */
+  uint8_t presets[SSMP_TOPO_NUM]; /* the default protocol per topology class */
+} ssmp_platform_t;
+
+/* the socket of a core, as reported by sysfs (cached). 0 if unknown */
+static uint32_t
+ssmp_socket_of_core(uint32_t core)
+{
+  static int socket_of[SSMP_MAX_UES];	/* socket + 1, 0 -> not read yet */
+  if (socket_of[core] == 0)
+    {
+      int socket = 0;
+      char path[128];
+      sprintf(path, "/sys/devices/system/cpu/cpu%u/topology/physical_package_id", core);
+      FILE* f = fopen(path, "r");
+      if (f != NULL)
+	{
+	  if (fscanf(f, "%d", &socket) != 1 || socket < 0)
+	    {
+	      socket = 0;
+	    }
+	  fclose(f);
+	}
+      socket_of[core] = socket + 1;
+    }
+  return socket_of[core] - 1;
+}
+
+/* a Magny Cours "socket" here is a 6-core die, i.e., a numa node */
+static uint32_t
+opteron_socket_of(uint32_t core)
+{
+  return core / 6;
+}
+
+static void
+opteron_set_numa(int cpu)
+{
+#ifdef PLATFORM_NUMA
+  numa_set_preferred(cpu / 6);
+#endif
+}
+
+/* the 8 x 10-core Westmere-EX machine: ids 0 .. 79 go to the sockets in order,
+   with core 0 last */
+static const uint32_t xeon_id_to_core[] =
+  {
+    01, 02, 03, 04, 05, 06, 07,  8,  9, 10,
+    11, 12, 13, 14, 15, 16, 17, 18, 19, 20,
+    21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 
+    31, 32, 33, 34, 35, 36, 37, 38, 39, 40,
+    00, 41, 42, 43, 44, 45, 46, 47, 48, 49, 
+    50, 51, 52, 53, 54, 55, 56, 57, 58, 59, 
+    60, 61, 62, 63, 64, 65, 66, 67, 68, 69, 
+    70, 71, 72, 73, 74, 75, 76, 77, 78, 79,
+  };
+
+static const uint8_t xeon_id_to_node[] =
+  {
+    4, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 
+    2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 
+    3, 3, 3, 3, 3, 3, 3, 3, 3, 3,
+    4, 4, 4, 4, 4, 4, 4, 4, 4, 
+    5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 
+    6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 
+    7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 
+  };
+
+static uint32_t
+xeon_socket_of(uint32_t core)
+{
+  return (core < sizeof(xeon_id_to_node)) ? xeon_id_to_node[core] : core / 10;
+}
+
+static void
+ssmp_no_numa(int cpu)
+{
+}
+
+#define SSMP_PRESETS_ALL(p) { p, p, p, p }
+
+static const ssmp_platform_t ssmp_platforms[] =
+  {
+    {
+      "generic", NULL, 0, ssmp_socket_of_core, ssmp_no_numa, 0,
+#if SSMP_ORDER == SSMP_ORDER_RMW
+      SSMP_PRESETS_ALL(SSMP_PRESET_CAS)
+#else
+      SSMP_PRESETS_ALL(SSMP_PRESET_PAUSE)
+#endif
+    },
+    {
+      "opteron", NULL, 0, opteron_socket_of, opteron_set_numa, 1,
+      SSMP_PRESETS_ALL(SSMP_PRESET_PREFETCHW)
+    },
+    {
+      "xeon", xeon_id_to_core, sizeof(xeon_id_to_core) / sizeof(uint32_t), xeon_socket_of, ssmp_no_numa, 0,
+      { SSMP_PRESET_BACKOFF, SSMP_PRESET_BACKOFF, SSMP_PRESET_BACKOFF, SSMP_PRESET_CAS }
+    },
+  };
+
+#define SSMP_NUM_PLATFORMS (sizeof(ssmp_platforms) / sizeof(ssmp_platform_t))
+
+static const ssmp_platform_t* ssmp_platform = &ssmp_platforms[0];
+
+/* the machines that the tables of opteron and xeon describe: the 4 x 12-core
+   Opteron 6172 (family 0x10) and the 8 x 10-core Xeon E7-8867L (Westmere-EX,
+   family 6, model 0x2f). Everything else uses the topology in sysfs */
+static const ssmp_platform_t*
+ssmp_platform_detect()
+{
+  uint32_t a, b, c, d, vendor[3];
+  ssmp_cpuid(0, &a, &vendor[0], &vendor[2], &vendor[1]);
+  ssmp_cpuid(1, &a, &b, &c, &d);
+  uint32_t family = (a >> 8) & 0xf, model = (a >> 4) & 0xf;
+  if (family == 0xf)
+    {
+      family += (a >> 20) & 0xff;
+    }
+  if (family == 0x6 || family >= 0xf)
+    {
+      model |= ((a >> 16) & 0xf) << 4;
+    }
+  long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+  if (memcmp(vendor, "AuthenticAMD", 12) == 0 && family == 0x10 && cpus == 48)
+    {
+      return &ssmp_platforms[1];
+    }
+  if (memcmp(vendor, "GenuineIntel", 12) == 0 && family == 0x6 && model == 0x2f && cpus == 80)
+    {
+      return &ssmp_platforms[2];
+    }
+  return &ssmp_platforms[0];
+}
+
+/* before main (and before any use of id_to_core): SSMP_PLATFORM=<name> overrides
+   the detection */
+static void __attribute__ ((constructor))
+ssmp_platform_init()
+{
+  ssmp_platform = ssmp_platform_detect();
+
+  char* env = getenv("SSMP_PLATFORM");
+  if (env != NULL && *env)
+    {
+      uint32_t p;
+      for (p = 0; p < SSMP_NUM_PLATFORMS; p++)
+	{
+	  if (strcmp(env, ssmp_platforms[p].name) == 0)
+	    {
+	      ssmp_platform = &ssmp_platforms[p];
+	      break;
+	    }
+	}
+      if (p == SSMP_NUM_PLATFORMS)
+	{
+	  fprintf(stderr, "** SSMP_PLATFORM=%s: unknown (generic, opteron, xeon), using %s\n",
+		  env, ssmp_platform->name);
+	}
+    }
+
+#ifndef PLATFORM_NUMA
+  if (ssmp_platform->set_numa == opteron_set_numa)
+    {
+      fprintf(stderr, "** platform opteron without libnuma: no numa placement (build with PLATFORM_NUMA=1)\n");
+    }
+#endif
+
+  uint32_t id;
+  for (id = 0; id < SSMP_MAX_UES; id++)
+    {
+      id_to_core[id] = (id < ssmp_platform->num_cores) ? ssmp_platform->id_to_core[id] : id;
+    }
+  memcpy(ssmp_proto_class_preset, ssmp_platform->presets, sizeof(ssmp_platform->presets));
+}
+
+const char*
+ssmp_platform_name()
+{
+  return ssmp_platform->name;
+}
+
+/* ------------------------------------------------------------------------------- */
+/* receiving functions : default is blocking */
+/* ------------------------------------------------------------------------------- */
+
+inline void
+ssmp_recv_from_platf(uint32_t from, volatile ssmp_msg_t* msg) 
+{
+  volatile ssmp_msg_t* tmpm = ssmp_recv_buf[from];
+  const ssmp_proto_t* proto = &ssmp_proto_peer[from];
+  proto->wait_fn(&tmpm->state, SSMP_BUF_MESSG);
+  memcpy((void*) msg, (const void*) tmpm, SSMP_CACHE_LINE_SIZE);
+  proto->update_fn(&tmpm->state, SSMP_BUF_EMPTY);
+}
+
+
+inline int
+ssmp_recv_is_ready_platf(uint32_t from)
+{
+  return (SSMP_FLAG_LOAD(&ssmp_recv_buf[from]->state) == SSMP_BUF_MESSG);
+}
+
+inline void 
+ssmp_recv_platf(ssmp_msg_t* msg)
+{
+  if (ssmp_doorbell_on)
+    {
+      ssmp_recv_doorbell_platf(NULL, NULL, msg);
+      return;
+    }
+
+  uint32_t p, from;
+  uint32_t num_peers = ssmp_num_peers;
+  const int prefetch = ssmp_platform->scan_prefetch;
+ 
+  while(1)
+    {
+      for (p = 0; p < num_peers; p++) 
+	{
+	  from = ssmp_peers[p];
+	  if (prefetch)
+	    {
+	      PREFETCHW(ssmp_recv_buf[from]);
+	    }
+	  const ssmp_proto_t* proto = &ssmp_proto_peer[from];
+	  if (proto->poll_fn(&ssmp_recv_buf[from]->state, SSMP_BUF_MESSG))
+	    {
+	      volatile ssmp_msg_t* tmpm = ssmp_recv_buf[from];
+	      memcpy((void*) msg, (const void*) tmpm, SSMP_CACHE_LINE_SIZE);
+	      msg->sender = from;
+
+	      proto->update_fn(&tmpm->state, SSMP_BUF_EMPTY);
+
+	      if (prefetch && p + 1 < num_peers)
+		{
+		  PREFETCHW(ssmp_recv_buf[ssmp_peers[p + 1]]);
+		}
+	      return;
+	    }
+	}
+    }
+}
+
+inline void 
+ssmp_recv_color_platf(ssmp_color_buf_t* cbuf, ssmp_msg_t* msg)
+{
+  if (ssmp_doorbell_on)
+    {
+      ssmp_recv_doorbell_platf(cbuf->mask, NULL, msg);
+      return;
+    }
+
+  uint32_t from;
+  uint32_t num_ues = cbuf->num_ues;
+  volatile ssmp_msg_t** buf = cbuf->buf;
+  SSMP_FLAG_TYPE** cbuf_state = cbuf->buf_state;
+  const int prefetch = ssmp_platform->scan_prefetch;
+
+  while(1)
+    {
+      for (from = 0; from < num_ues; from++) 
+	{
+	  if (prefetch)
+	    {
+	      PREFETCHW(buf[from]);
+	    }
+	  const ssmp_proto_t* proto = &ssmp_proto_peer[cbuf->from[from]];
+	  if (proto->poll_fn(cbuf_state[from], SSMP_BUF_MESSG))
+	    {
+	      volatile ssmp_msg_t* tmpm = buf[from];
+	      memcpy((void*) msg, (const void*) tmpm, SSMP_CACHE_LINE_SIZE);
+	      msg->sender = cbuf->from[from];
+
+	      proto->update_fn(&tmpm->state, SSMP_BUF_EMPTY);
+
+	      if (prefetch)
+		{
+		  PREFETCHW(ssmp_send_buf[msg->sender]);
+		  if (from + 1 < num_ues)
+		    {
+		      PREFETCHW(buf[from + 1]);
+		    }
+		}
+	      return;
+	    }
+	}
+    }
+}
+
+
+inline void
+ssmp_recv_color_start_platf(ssmp_color_buf_t* cbuf, ssmp_msg_t* msg)
+{
+  if (ssmp_doorbell_on)
+    {
+      ssmp_recv_doorbell_platf(cbuf->mask, &cbuf->start_recv_from, msg);
+      return;
+    }
+
+  SSMP_FLAG_TYPE** cbuf_state = cbuf->buf_state;
+  volatile ssmp_msg_t** buf = cbuf->buf;
+  uint32_t num_ues = cbuf->num_ues;
+  uint32_t start_recv_from = cbuf->start_recv_from;
+  const int prefetch = ssmp_platform->scan_prefetch;
+
+  while(1) 
+    {
+      for (; start_recv_from < num_ues; start_recv_from++)
+	{
+	  if (prefetch)
+	    {
+	      PREFETCHW(buf[start_recv_from]);
+	    }
+	  const ssmp_proto_t* proto = &ssmp_proto_peer[cbuf->from[start_recv_from]];
+	  if (proto->poll_fn(cbuf_state[start_recv_from], SSMP_BUF_MESSG))
+	    {
+	      volatile ssmp_msg_t* tmpm = buf[start_recv_from];
+	      memcpy((void*) msg, (const void*) tmpm, SSMP_CACHE_LINE_SIZE);
+	      msg->sender = cbuf->from[start_recv_from];
+
+	      proto->update_fn(&tmpm->state, SSMP_BUF_EMPTY);
+
+	      if (++start_recv_from == num_ues)
+		{
+		  start_recv_from = 0;
+		}
+	      if (prefetch)
+		{
+		  PREFETCHW(ssmp_send_buf[msg->sender]);
+		  PREFETCHW(buf[start_recv_from]);
+		}
+
+	      cbuf->start_recv_from = start_recv_from;
+	      return;
+	    }
+	}
+      start_recv_from = 0;
+    }
+}
+      
+
+void
+ssmp_recv_from_big_platf(int from, void* data, size_t length) 
+{
+  int last_chunk = length % SSMP_CHUNK_DATA;
+  int num_chunks = length / SSMP_CHUNK_DATA;
+
+  while(num_chunks--)
+    {
+      while(!SSMP_FLAG_LOAD(&ssmp_chunk_buf[from]->state))
+	{
+	  PAUSE;
+	}
+
+      memcpy(data, ssmp_chunk_buf[from], SSMP_CHUNK_DATA);
+      data = ((char*) data) + SSMP_CHUNK_DATA;
+
+      SSMP_FLAG_STORE(&ssmp_chunk_buf[from]->state, 0);
+    }
+
+  if (!last_chunk)
+    {
+      return;
+    }
+
+  while(!SSMP_FLAG_LOAD(&ssmp_chunk_buf[from]->state))
+    {
+      PAUSE;
+    }
+
+  memcpy(data, ssmp_chunk_buf[from], last_chunk);
+  SSMP_FLAG_STORE(&ssmp_chunk_buf[from]->state, 0);
+
+  PD("recved from %d\n", from);
+}
+
+
+/* ------------------------------------------------------------------------------- */
+/* sending functions : default is blocking */
+/* ------------------------------------------------------------------------------- */
+
+inline void
+ssmp_send_platf(uint32_t to, volatile ssmp_msg_t* msg) 
+{
+  volatile ssmp_msg_t* tmpm = ssmp_send_buf[to];
+  const ssmp_proto_t* proto = &ssmp_proto_peer[to];
+  proto->wait_fn(&tmpm->state, SSMP_BUF_EMPTY);
+
+  ssmp_msg_copy_data(tmpm, msg);
+  proto->update_fn(&tmpm->state, SSMP_BUF_MESSG);
+  if (ssmp_doorbell_on)
+    {
+      ssmp_doorbell_ring_platf(to);
+    }
+}
+
+inline int
+ssmp_send_is_free_platf(uint32_t to)
+{
+  volatile ssmp_msg_t* tmpm = ssmp_send_buf[to];
+  if (ssmp_platform->scan_prefetch)
+    {
+      PREFETCHW(tmpm);
+    }
+  return (SSMP_FLAG_LOAD(&tmpm->state) == SSMP_BUF_EMPTY);
+}
+
+inline void
+ssmp_send_no_sync_platf(uint32_t to, volatile ssmp_msg_t* msg) 
+{
+  volatile ssmp_msg_t* tmpm = ssmp_send_buf[to];
+  ssmp_msg_copy_data(tmpm, msg);
+  ssmp_proto_peer[to].update_fn(&tmpm->state, SSMP_BUF_MESSG);
+  if (ssmp_doorbell_on)
+    {
+      ssmp_doorbell_ring_platf(to);
+    }
+}
+
+
+void
+ssmp_send_big_platf(int to, void* data, size_t length) 
+{
+  int last_chunk = length % SSMP_CHUNK_DATA;
+  int num_chunks = length / SSMP_CHUNK_DATA;
+
+  while(num_chunks--)
+    {
+      while(SSMP_FLAG_LOAD(&ssmp_chunk_buf[ssmp_id_]->state))
+	{
+	  PAUSE;
+	}
+
+      memcpy(ssmp_chunk_buf[ssmp_id_], data, SSMP_CHUNK_DATA);
+      data = ((char*) data) + SSMP_CHUNK_DATA;
+
+      SSMP_FLAG_STORE(&ssmp_chunk_buf[ssmp_id_]->state, 1);
+    }
+
+  if (!last_chunk)
+    {
+      return;
+    }
+
+  while(SSMP_FLAG_LOAD(&ssmp_chunk_buf[ssmp_id_]->state))
+    {
+      PAUSE;
+    }
+
+  memcpy(ssmp_chunk_buf[ssmp_id_], data, last_chunk);
+
+  SSMP_FLAG_STORE(&ssmp_chunk_buf[ssmp_id_]->state, 1);
+
+  PD("sent to %d", to);
+}
+
+void
+set_numa_platf(int cpu)
+{
+  ssmp_platform->set_numa(cpu);
+}
+
+inline uint32_t
+ssmp_cores_on_same_socket_platf(uint32_t core1, uint32_t core2)
+{
+  return (ssmp_platform->socket_of(id_to_core[core1]) == ssmp_platform->socket_of(id_to_core[core2]));
+}
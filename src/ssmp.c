@@ -38,8 +38,8 @@
 int ssmp_num_ues_;
 int ssmp_id_;
 ssmp_barrier_t* ssmp_barrier;
-volatile int* ues_initialized;
 static uint32_t ssmp_my_core;
+int ssmp_opts_;
 
 
 /* ------------------------------------------------------------------------------- */
@@ -49,19 +49,96 @@ static uint32_t ssmp_my_core;
 void
 ssmp_init(int num_procs)
 {
+  ssmp_init_opt(num_procs, 0);
+}
+
+void
+ssmp_init_opt(int num_procs, int opts)
+{
+  if (num_procs > SSMP_MAX_UES)
+    {
+      printf("** ssmp supports up to %d processes (SSMP_MAX_UES)\n", SSMP_MAX_UES);
+      exit(-1);
+    }
+  ssmp_opts_ = opts;		/* inherited by the forked processes */
+  ticks_per_ns();		/* calibrated once, before the fork */
+  ssmp_proto_topo_init(num_procs);
+  char* tune = getenv("SSMP_AUTOTUNE");
+  if ((opts & SSMP_OPT_AUTOTUNE) || (tune != NULL && atoi(tune)))
+    {
+      ssmp_tune(tune != NULL && atoi(tune) > 1);
+    }
+  SSMP_STATS_INIT(num_procs);
+  SSMP_TRACE_INIT(num_procs);
   ssmp_init_platf(num_procs);
+  ssmp_group_init(num_procs);
+  if (opts & SSMP_OPT_SEQ)
+    {
+      ssmp_seq_init(num_procs);
+    }
+}
+
+/* SSMP_OPT_WARMUP: in the step with distance d, send to id + d and receive from
+   id - d, so that every pair has exchanged a message when the application starts */
+static void
+ssmp_warmup()
+{
+  uint32_t num_ues = ssmp_num_ues_, id = ssmp_id_, dist;
+  ssmp_msg_t msg;
+  for (dist = 1; dist < num_ues; dist++)
+    {
+      ssmp_send((id + dist) % num_ues, &msg);
+      ssmp_recv_from((id + num_ues - dist) % num_ues, &msg);
+    }
+  ssmp_barrier_wait(0);
 }
 
 void
 ssmp_mem_init(int id, int num_ues) 
 {
+  ssmp_proto_init(id, num_ues);
   ssmp_mem_init_platf(id, num_ues);
+  SSMP_STATS_MEM_INIT(id);
+  SSMP_TRACE_MEM_INIT(id);
+  if (ssmp_opts_ & SSMP_OPT_SEQ)
+    {
+      ssmp_seq_mem_init(id, num_ues);
+    }
+  ssmp_group_world_init();
+  if (ssmp_opts_ & SSMP_OPT_WARMUP)
+    {
+      ssmp_warmup();
+    }
+  if (ssmp_opts_ & SSMP_OPT_CLOCK_SYNC)
+    {
+      ssmp_clock_sync();
+    }
+}
+
+void
+ssmp_mem_init_peers(int id, int num_ues, const uint32_t* peers, uint32_t num_peers)
+{
+  /* no SSMP_OPT_WARMUP / SSMP_OPT_CLOCK_SYNC: a core does not know to which cores
+     it may send */
+  ssmp_proto_init(id, num_ues);
+  ssmp_mem_init_peers_platf(id, num_ues, peers, num_peers);
+  SSMP_STATS_MEM_INIT(id);
+  SSMP_TRACE_MEM_INIT(id);
+  if (ssmp_opts_ & SSMP_OPT_SEQ)
+    {
+      ssmp_seq_mem_init(id, num_ues);
+    }
+  ssmp_group_world_init();
 }
 
 
 void
 ssmp_term() 
 {
+  ssmp_group_term();
+  SSMP_STATS_TERM();
+  SSMP_TRACE_TERM();
+  ssmp_seq_term();
   ssmp_term_platf();
 }
 
@@ -119,10 +196,21 @@ ssmp_barrier_init(int barrier_num, long long int participants, int (*color)(int)
   ssmp_barrier_init_platf(barrier_num, participants, color);
 }
 
+void
+ssmp_barrier_init_mask(int barrier_num, const uint64_t* participants)
+{
+  ssmp_barrier_init_mask_platf(barrier_num, participants);
+}
+
 void 
 ssmp_barrier_wait(int barrier_num) 
 {
+  SSMP_TRACE_START();
+  SSMP_STATS_TICKS_START();
   ssmp_barrier_wait_platf(barrier_num);
+  SSMP_STATS_TICKS_STOP(barrier_wait_ticks);
+  SSMP_STATS_ADD(barrier_waits, 1);
+  SSMP_TRACE_EVENT(SSMP_TRACE_BARRIER, ssmp_id_, 0, barrier_num);
 }
 
 /* ------------------------------------------------------------------------------- */
@@ -177,6 +265,12 @@ getticks(void)
   return getticks_platf();
 }
 
+inline ticks
+getticks_fenced(void)
+{
+  return getticks_fenced_platf();
+}
+
 ticks getticks_correction;
 
 ticks 
@@ -186,14 +280,176 @@ getticks_correction_calc()
   ticks t_dur = 0;
   uint32_t i;
   for (i = 0; i < GETTICKS_CALC_REPS; i++) {
-    ticks t_start = getticks();
-    ticks t_end = getticks();
+    ticks t_start = getticks_fenced();
+    ticks t_end = getticks_fenced();
     t_dur += t_end - t_start;
   }
   getticks_correction = (ticks)(t_dur / (double) GETTICKS_CALC_REPS);
   return getticks_correction;
 }
 
+static double ticks_per_ns_ = 0;
+
+static uint64_t
+clock_ns()
+{
+#if defined(CLOCK_MONOTONIC_RAW) || defined(CLOCK_MONOTONIC)
+  struct timespec ts;
+#  if defined(CLOCK_MONOTONIC_RAW)
+  clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+#  else
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+#  endif
+  return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+#else
+  return (uint64_t) (wtime() * 1e9);
+#endif
+}
+
+/* a clock reading and the ticks in its middle, from the narrowest of a few tries */
+static void
+ticks_clock_pair(ticks* t, uint64_t* ns)
+{
+  ticks best = ~0ULL;
+  uint32_t i;
+  for (i = 0; i < 8; i++)
+    {
+      ticks t0 = getticks_fenced();
+      uint64_t n = clock_ns();
+      ticks t1 = getticks_fenced();
+      if (t1 - t0 < best)
+	{
+	  best = t1 - t0;
+	  *t = t0 + (t1 - t0) / 2;
+	  *ns = n;
+	}
+    }
+}
+
+#define TICKS_CALIB_NS 20000000	/* 20 ms */
+
+double
+ticks_per_ns()
+{
+  if (ticks_per_ns_ > 0)
+    {
+      return ticks_per_ns_;
+    }
+
+  char* env = getenv("SSMP_TSC_GHZ");
+  if (env != NULL && atof(env) > 0)
+    {
+      ticks_per_ns_ = atof(env);
+      return ticks_per_ns_;
+    }
+
+  ticks_per_ns_ = ticks_per_ns_platf();
+  if (ticks_per_ns_ > 0)
+    {
+      return ticks_per_ns_;
+    }
+
+  ticks t0 = 0, t1 = 0;
+  uint64_t ns0 = 0, ns1 = 0;
+  ticks_clock_pair(&t0, &ns0);
+  do
+    {
+      ticks_clock_pair(&t1, &ns1);
+    }
+  while (ns1 - ns0 < TICKS_CALIB_NS);
+
+  ticks_per_ns_ = (double) (t1 - t0) / (ns1 - ns0);
+  return ticks_per_ns_;
+}
+
+double
+ticks_to_ns(ticks t)
+{
+  return t / ticks_per_ns();
+}
+
+double
+ticks_to_secs(ticks t)
+{
+  return t / (ticks_per_ns() * 1e9);
+}
+
+/* ------------------------------------------------------------------------------- */
+/* clock synchronization                                                           */
+/* ------------------------------------------------------------------------------- */
+
+/*
+  Core 0 exchanges SSMP_CLOCK_SYNC_REPS roundtrips with every other core in turn:
+  it stamps t0 before sending, the other core stamps t1 when it receives and
+  returns it, and core 0 stamps t3 when the answer arrives. As in NTP, the
+  offset of the other core is t1 - t0 - (t3 - t0) / 2 of the roundtrip with the
+  smallest t3 - t0, the one least disturbed by delays in either direction.
+  Core 0 then sends each core its offset.
+*/
+
+#define SSMP_CLOCK_SYNC_REPS 64
+
+static int64_t ssmp_clock_offset_ = 0;
+
+void
+ssmp_clock_sync()
+{
+  uint32_t id = ssmp_id_, num_ues = ssmp_num_ues_, core, i;
+  ssmp_msg_t msg;
+  ticks t1;
+
+  if (id == 0)
+    {
+      for (core = 1; core < num_ues; core++)
+	{
+	  ticks best_rtt = ~0ULL;
+	  int64_t best_offset = 0;
+	  for (i = 0; i < SSMP_CLOCK_SYNC_REPS; i++)
+	    {
+	      ticks t0 = getticks_fenced();
+	      ssmp_send(core, &msg);
+	      ssmp_recv_from(core, &msg);
+	      ticks t3 = getticks_fenced();
+	      memcpy(&t1, &msg, sizeof(t1));
+	      if (t3 - t0 < best_rtt)
+		{
+		  best_rtt = t3 - t0;
+		  best_offset = (int64_t) (t1 - t0) - (int64_t) (best_rtt / 2);
+		}
+	    }
+	  memcpy(&msg, &best_offset, sizeof(best_offset));
+	  ssmp_send(core, &msg);
+	}
+      ssmp_clock_offset_ = 0;
+    }
+  else
+    {
+      for (i = 0; i < SSMP_CLOCK_SYNC_REPS; i++)
+	{
+	  ssmp_recv_from(0, &msg);
+	  t1 = getticks_fenced();
+	  memcpy(&msg, &t1, sizeof(t1));
+	  ssmp_send(0, &msg);
+	}
+      ssmp_recv_from(0, &msg);
+      memcpy(&ssmp_clock_offset_, &msg, sizeof(ssmp_clock_offset_));
+    }
+
+  ssmp_barrier_wait(0);
+}
+
+int64_t
+ssmp_clock_offset()
+{
+  return ssmp_clock_offset_;
+}
+
+inline ticks
+getticks_global()
+{
+  return getticks_fenced() - ssmp_clock_offset_;
+}
+
 /* Round up to next higher power of 2 (return x if it's already a power */
 /* of 2) for 32-bit numbers */
 uint32_t 
@@ -209,6 +465,12 @@ pow2roundup(uint32_t x)
   return x+1;
 }
 
+inline uint32_t
+ssmp_cores_on_same_socket(uint32_t core1, uint32_t core2)
+{
+  return ssmp_cores_on_same_socket_platf(core1, core2);
+}
+
 inline int
 ssmp_id() 
 {
@@ -0,0 +1,435 @@
+/*
+ *   File: ssmp_collective.c
+ *   Author: Vasileios Trigonakis <vasileios.trigonakis@epfl.ch>
+ *   Description: gather, scatter, allgather, and alltoall collectives
+ *   ssmp_collective.c is part of ssmp
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (C) 2013  Vasileios Trigonakis
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include "ssmp.h"
+
+extern int ssmp_id_;
+extern int ssmp_num_ues_;
+#if !defined(__tile__)
+extern ssmp_chunk_t** ssmp_chunk_buf;
+#endif
+
+/* ------------------------------------------------------------------------------- */
+/* point-to-point transfers used by the collectives                                */
+/* ------------------------------------------------------------------------------- */
+
+/*
+  Blocks of up to SSMP_MSG_PAYLOAD bytes are carried inside a single message.
+  Bigger blocks are announced with a message and then streamed through the
+  chunk buffer of the sender. Every core has a single chunk buffer, thus a sender
+  first waits for its previous stream to be drained and only then announces the
+  new one: the receiver touches the chunk buffer of the sender only after the
+  announcement, so it never consumes chunks that were meant for another core.
+*/
+
+static inline void
+coll_msg_send(uint32_t to, ssmp_msg_t* msg, void* data, size_t length)
+{
+  if (length <= SSMP_MSG_PAYLOAD)
+    {
+      memcpy(msg, data, length);
+    }
+  ssmp_send(to, msg);
+}
+
+static inline void
+coll_msg_recv(uint32_t from, ssmp_msg_t* msg, void* data, size_t length)
+{
+  ssmp_recv_from(from, msg);
+  if (length <= SSMP_MSG_PAYLOAD)
+    {
+      memcpy(data, msg, length);
+    }
+}
+
+#if !defined(__tile__)
+static inline void
+coll_chunk_drained()
+{
+  while (SSMP_FLAG_LOAD(&ssmp_chunk_buf[ssmp_id_]->state))
+    {
+      PAUSE;
+    }
+}
+
+/* try to write the next piece of data to the own chunk buffer: returns the bytes written */
+static inline size_t
+coll_chunk_try_put(char* data, size_t length)
+{
+  ssmp_chunk_t* cnk = ssmp_chunk_buf[ssmp_id_];
+  if (SSMP_FLAG_LOAD(&cnk->state))
+    {
+      return 0;
+    }
+  size_t piece = (length < SSMP_CHUNK_DATA) ? length : SSMP_CHUNK_DATA;
+  memcpy((void*) cnk->data, data, piece);
+  SSMP_FLAG_STORE(&cnk->state, 1);
+  return piece;
+}
+
+/* try to read the next piece of data from the chunk buffer of from: returns the bytes read */
+static inline size_t
+coll_chunk_try_get(uint32_t from, char* data, size_t length)
+{
+  ssmp_chunk_t* cnk = ssmp_chunk_buf[from];
+  if (!SSMP_FLAG_LOAD(&cnk->state))
+    {
+      return 0;
+    }
+  size_t piece = (length < SSMP_CHUNK_DATA) ? length : SSMP_CHUNK_DATA;
+  memcpy(data, (const void*) cnk->data, piece);
+  SSMP_FLAG_STORE(&cnk->state, 0);
+  return piece;
+}
+#endif	/* !__tile__ */
+
+static void
+coll_send(uint32_t to, void* data, size_t length)
+{
+  ssmp_msg_t msg;
+#if !defined(__tile__)
+  if (length > SSMP_MSG_PAYLOAD)
+    {
+      coll_chunk_drained();
+      coll_msg_send(to, &msg, data, length);
+      char* d = (char*) data;
+      while (length > 0)
+	{
+	  size_t put = coll_chunk_try_put(d, length);
+	  d += put;
+	  length -= put;
+	}
+      return;
+    }
+#endif
+  coll_msg_send(to, &msg, data, length);
+  if (length > SSMP_MSG_PAYLOAD)
+    {
+      ssmp_send_big(to, data, length);
+    }
+}
+
+static void
+coll_recv(uint32_t from, void* data, size_t length)
+{
+  ssmp_msg_t msg;
+  coll_msg_recv(from, &msg, data, length);
+#if !defined(__tile__)
+  if (length > SSMP_MSG_PAYLOAD)
+    {
+      char* d = (char*) data;
+      while (length > 0)
+	{
+	  size_t got = coll_chunk_try_get(from, d, length);
+	  d += got;
+	  length -= got;
+	}
+    }
+#else
+  if (length > SSMP_MSG_PAYLOAD)
+    {
+      ssmp_recv_from_big(from, data, length);
+    }
+#endif
+}
+
+/* send length bytes to core to, while receiving length bytes from core from. The two
+   transfers progress together, so that cycles of senders cannot deadlock */
+static void
+coll_sendrecv(uint32_t to, void* sdata, uint32_t from, void* rdata, size_t length)
+{
+  ssmp_msg_t smsg, rmsg;
+#if !defined(__tile__)
+  if (length > SSMP_MSG_PAYLOAD)
+    {
+      coll_chunk_drained();
+      coll_msg_send(to, &smsg, sdata, length);
+      coll_msg_recv(from, &rmsg, rdata, length);
+
+      char* s = (char*) sdata;
+      char* r = (char*) rdata;
+      size_t slen = length, rlen = length;
+      while (slen > 0 || rlen > 0)
+	{
+	  if (slen > 0)
+	    {
+	      size_t put = coll_chunk_try_put(s, slen);
+	      s += put;
+	      slen -= put;
+	    }
+	  if (rlen > 0)
+	    {
+	      size_t got = coll_chunk_try_get(from, r, rlen);
+	      r += got;
+	      rlen -= got;
+	    }
+	}
+      return;
+    }
+#endif
+  coll_send(to, sdata, length);
+  coll_recv(from, rdata, length);
+}
+
+/* ------------------------------------------------------------------------------- */
+/* schedules                                                                       */
+/* ------------------------------------------------------------------------------- */
+
+/*
+  The steps of the pairwise exchange are k = 1 .. num_ues - 1: in step k, rank i
+  sends to (i + k) and receives from (i - k) (with num_ues a power of 2: exchanges
+  with i ^ k). Any permutation of the steps is correct, as long as all members use
+  the same one, thus the steps are sorted by the number of exchanges within a
+  socket, so that the socket-local ones happen first. Computed once per group.
+*/
+
+static inline uint32_t
+coll_is_pow2(uint32_t n)
+{
+  return (n & (n - 1)) == 0;
+}
+
+static inline uint32_t
+coll_step_to(uint32_t step, uint32_t rank, uint32_t num_ues)
+{
+  return coll_is_pow2(num_ues) ? (rank ^ step) : ((rank + step) % num_ues);
+}
+
+static inline uint32_t
+coll_step_from(uint32_t step, uint32_t rank, uint32_t num_ues)
+{
+  return coll_is_pow2(num_ues) ? (rank ^ step) : ((rank + num_ues - step) % num_ues);
+}
+
+/* called once, by ssmp_group_build */
+void
+ssmp_coll_schedule(ssmp_group_t* group)
+{
+  uint32_t num_ues = group->num_ues;
+  uint32_t rank = group->rank;
+  uint32_t* members = group->members;
+
+  uint32_t* steps = (uint32_t*) malloc(num_ues * sizeof(uint32_t));
+  uint32_t* local_first = (uint32_t*) malloc(num_ues * sizeof(uint32_t));
+  /* the local exchanges of every step, until local_first is filled */
+  uint32_t* local = local_first;
+  if (steps == NULL || local_first == NULL)
+    {
+      perror("malloc @ ssmp_coll_schedule");
+      exit(-1);
+    }
+
+  uint32_t s, i;
+  for (s = 1; s < num_ues; s++)
+    {
+      local[s] = 0;
+      for (i = 0; i < num_ues; i++)
+	{
+	  local[s] += ssmp_cores_on_same_socket(members[i], members[coll_step_to(s, i, num_ues)]);
+	}
+
+      /* insertion sort: more local exchanges first, ties keep the natural order */
+      uint32_t pos = s - 1;
+      while (pos > 0 && local[steps[pos - 1]] < local[s])
+	{
+	  steps[pos] = steps[pos - 1];
+	  pos--;
+	}
+      steps[pos] = s;
+    }
+
+  /* the order in which a root serves the rest of the members: first the ones on its socket */
+  uint32_t n = 0, k, pass;
+  for (pass = 0; pass < 2; pass++)
+    {
+      uint32_t same = (pass == 0);
+      for (k = 1; k < num_ues; k++)
+	{
+	  uint32_t r = (rank + k) % num_ues;
+	  if (ssmp_cores_on_same_socket(members[rank], members[r]) == same)
+	    {
+	      local_first[n++] = r;
+	    }
+	}
+    }
+
+  group->steps = steps;
+  group->local_first = local_first;
+}
+
+/* ------------------------------------------------------------------------------- */
+/* collectives                                                                     */
+/* ------------------------------------------------------------------------------- */
+
+void
+ssmp_group_gather(ssmp_group_t* group, int root, void* sdata, void* rdata, size_t length)
+{
+  if (group->rank < 0)
+    {
+      return;
+    }
+
+  if (group->rank != root)
+    {
+      coll_send(group->members[root], sdata, length);
+      return;
+    }
+
+  uint32_t* order = group->local_first;
+  memcpy((char*) rdata + root * length, sdata, length);
+
+  uint32_t n;
+  for (n = 0; n < group->num_ues - 1; n++)
+    {
+      coll_recv(group->members[order[n]], (char*) rdata + order[n] * length, length);
+    }
+}
+
+void
+ssmp_group_scatter(ssmp_group_t* group, int root, void* sdata, void* rdata, size_t length)
+{
+  if (group->rank < 0)
+    {
+      return;
+    }
+
+  if (group->rank != root)
+    {
+      coll_recv(group->members[root], rdata, length);
+      return;
+    }
+
+  uint32_t* order = group->local_first;
+  memcpy(rdata, (char*) sdata + root * length, length);
+
+  uint32_t n;
+  for (n = 0; n < group->num_ues - 1; n++)
+    {
+      coll_send(group->members[order[n]], (char*) sdata + order[n] * length, length);
+    }
+}
+
+/*
+  Bruck's allgather: tmp holds the blocks of ranks r, r + 1, ... In the step with
+  distance d (1, 2, 4, ...), the first min(d, num_ues - d) blocks of tmp are sent to
+  r - d and the ones of r + d .. are received from r + d. The small distances come
+  first, i.e., the exchanges with the neighboring ranks.
+*/
+void
+ssmp_group_allgather(ssmp_group_t* group, void* sdata, void* rdata, size_t length)
+{
+  if (group->rank < 0)
+    {
+      return;
+    }
+
+  uint32_t num_ues = group->num_ues;
+  uint32_t rank = group->rank;
+  uint32_t* members = group->members;
+
+  /* the scratch buffer of the group only grows */
+  if (group->scratch_size < num_ues * length)
+    {
+      free(group->scratch);
+      group->scratch_size = num_ues * length;
+      group->scratch = (char*) malloc(group->scratch_size);
+      if (group->scratch == NULL)
+	{
+	  perror("malloc @ ssmp_group_allgather");
+	  exit(-1);
+	}
+    }
+  char* tmp = group->scratch;
+
+  memcpy(tmp, sdata, length);
+
+  uint32_t dist;
+  for (dist = 1; dist < num_ues; dist <<= 1)
+    {
+      uint32_t num_blocks = (dist < num_ues - dist) ? dist : (num_ues - dist);
+      uint32_t to = (rank + num_ues - dist) % num_ues;
+      uint32_t from = (rank + dist) % num_ues;
+      coll_sendrecv(members[to], tmp, members[from], tmp + dist * length, num_blocks * length);
+    }
+
+  uint32_t b;
+  for (b = 0; b < num_ues; b++)
+    {
+      memcpy((char*) rdata + ((rank + b) % num_ues) * length, tmp + b * length, length);
+    }
+}
+
+void
+ssmp_group_alltoall(ssmp_group_t* group, void* sdata, void* rdata, size_t length)
+{
+  if (group->rank < 0)
+    {
+      return;
+    }
+
+  uint32_t num_ues = group->num_ues;
+  uint32_t rank = group->rank;
+  uint32_t* members = group->members;
+  uint32_t* steps = group->steps;
+
+  memcpy((char*) rdata + rank * length, (char*) sdata + rank * length, length);
+
+  uint32_t s;
+  for (s = 0; s < num_ues - 1; s++)
+    {
+      uint32_t to = coll_step_to(steps[s], rank, num_ues);
+      uint32_t from = coll_step_from(steps[s], rank, num_ues);
+      coll_sendrecv(members[to], (char*) sdata + to * length,
+		    members[from], (char*) rdata + from * length, length);
+    }
+}
+
+void
+ssmp_gather(int root, void* sdata, void* rdata, size_t length)
+{
+  ssmp_group_gather(ssmp_group_world(), root, sdata, rdata, length);
+}
+
+void
+ssmp_scatter(int root, void* sdata, void* rdata, size_t length)
+{
+  ssmp_group_scatter(ssmp_group_world(), root, sdata, rdata, length);
+}
+
+void
+ssmp_allgather(void* sdata, void* rdata, size_t length)
+{
+  ssmp_group_allgather(ssmp_group_world(), sdata, rdata, length);
+}
+
+void
+ssmp_alltoall(void* sdata, void* rdata, size_t length)
+{
+  ssmp_group_alltoall(ssmp_group_world(), sdata, rdata, length);
+}
@@ -0,0 +1,288 @@
+/*
+ *   File: ssmp_group.c
+ *   Author: Vasileios Trigonakis <vasileios.trigonakis@epfl.ch>
+ *   Description: groups of cores (communicators) and group barriers
+ *   ssmp_group.c is part of ssmp
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (C) 2013  Vasileios Trigonakis
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include "ssmp.h"
+
+extern int ssmp_num_ues_;
+extern int ssmp_id_;
+
+static ssmp_group_t ssmp_world;
+
+/* the group barrier (see ssmp_group_barrier) */
+static volatile _Atomic uint32_t* ssmp_group_bar;
+static size_t ssmp_group_bar_size;
+static uint32_t ssmp_group_bar_num_ues;
+static uint32_t* ssmp_group_bar_sent;	/* signals to every core */
+static uint32_t* ssmp_group_bar_seen;	/* signals from every core, consumed */
+
+/* ------------------------------------------------------------------------------- */
+/* group creation                                                                  */
+/* ------------------------------------------------------------------------------- */
+
+/* membership that the receive buffers of a group are initialized from */
+static int32_t* group_rank_of_init;
+
+static int
+group_member_color(int id)
+{
+  return (group_rank_of_init[id] >= 0);
+}
+
+/* members: the core ids of the members, in local rank order. Taken over by the group */
+static void
+ssmp_group_build(ssmp_group_t* group, uint32_t* members, uint32_t num_members)
+{
+  group->num_ues = num_members;
+  group->members = members;
+  group->rank_of = (int32_t*) malloc(ssmp_num_ues_ * sizeof(int32_t));
+  if (group->rank_of == NULL)
+    {
+      perror("malloc @ ssmp_group_build");
+      exit(-1);
+    }
+
+  uint32_t ue;
+  for (ue = 0; ue < ssmp_num_ues_; ue++)
+    {
+      group->rank_of[ue] = -1;
+    }
+  for (ue = 0; ue < num_members; ue++)
+    {
+      group->rank_of[members[ue]] = ue;
+    }
+  group->rank = group->rank_of[ssmp_id_];
+
+  group_rank_of_init = group->rank_of;
+  ssmp_color_buf_init(&group->cbuf, group_member_color);
+
+  group->steps = NULL;
+  group->local_first = NULL;
+  group->scratch = NULL;
+  group->scratch_size = 0;
+  if (group->rank >= 0)
+    {
+      ssmp_coll_schedule(group);
+    }
+}
+
+static uint32_t*
+ssmp_group_members_alloc()
+{
+  uint32_t* members = (uint32_t*) malloc(ssmp_num_ues_ * sizeof(uint32_t));
+  if (members == NULL)
+    {
+      perror("malloc @ ssmp_group_members_alloc");
+      exit(-1);
+    }
+  return members;
+}
+
+void
+ssmp_group_world_init()
+{
+  ssmp_group_bar_sent = (uint32_t*) calloc(ssmp_num_ues_, sizeof(uint32_t));
+  ssmp_group_bar_seen = (uint32_t*) calloc(ssmp_num_ues_, sizeof(uint32_t));
+  if (ssmp_group_bar_sent == NULL || ssmp_group_bar_seen == NULL)
+    {
+      perror("malloc @ ssmp_group_world_init");
+      exit(-1);
+    }
+
+  uint32_t* members = ssmp_group_members_alloc();
+  uint32_t ue;
+  for (ue = 0; ue < ssmp_num_ues_; ue++)
+    {
+      members[ue] = ue;
+    }
+  ssmp_group_build(&ssmp_world, members, ssmp_num_ues_);
+}
+
+ssmp_group_t*
+ssmp_group_world()
+{
+  return &ssmp_world;
+}
+
+void
+ssmp_group_split(ssmp_group_t* parent, int color, int key, ssmp_group_t* group)
+{
+  uint32_t* members = ssmp_group_members_alloc();
+  uint32_t num_members = 0;
+  if (parent->rank < 0)
+    {
+      ssmp_group_build(group, members, 0);
+      return;
+    }
+
+  uint32_t num_ues = parent->num_ues;
+  int32_t mine[2] = { color, key };
+  int32_t* all = (int32_t*) malloc(num_ues * sizeof(mine));
+  if (all == NULL)
+    {
+      perror("malloc @ ssmp_group_split");
+      exit(-1);
+    }
+
+  ssmp_group_allgather(parent, mine, all, sizeof(mine));
+
+  if (color != SSMP_GROUP_NONE)
+    {
+      uint32_t r;
+      for (r = 0; r < num_ues; r++)
+	{
+	  if (all[2 * r] != color)
+	    {
+	      continue;
+	    }
+
+	  /* insertion sort on key; the ranks come in order, so ties keep the parent order */
+	  uint32_t pos = num_members++;
+	  while (pos > 0 && all[2 * parent->rank_of[members[pos - 1]] + 1] > all[2 * r + 1])
+	    {
+	      members[pos] = members[pos - 1];
+	      pos--;
+	    }
+	  members[pos] = parent->members[r];
+	}
+    }
+
+  free(all);
+  ssmp_group_build(group, members, num_members);
+}
+
+void
+ssmp_group_init_color(ssmp_group_t* group, int (*color)(int))
+{
+  uint32_t* members = ssmp_group_members_alloc();
+  uint32_t ue, num_members = 0;
+  for (ue = 0; ue < ssmp_num_ues_; ue++)
+    {
+      if (color(ue))
+	{
+	  members[num_members++] = ue;
+	}
+    }
+  ssmp_group_build(group, members, num_members);
+}
+
+void
+ssmp_group_free(ssmp_group_t* group)
+{
+  ssmp_color_buf_free(&group->cbuf);
+  free(group->members);
+  free(group->rank_of);
+  free(group->steps);
+  free(group->local_first);
+  free(group->scratch);
+  group->members = NULL;
+  group->rank_of = NULL;
+  group->steps = NULL;
+  group->local_first = NULL;
+  group->scratch = NULL;
+  group->scratch_size = 0;
+  group->num_ues = 0;
+  group->rank = -1;
+}
+
+/* ------------------------------------------------------------------------------- */
+/* group barrier                                                                   */
+/* ------------------------------------------------------------------------------- */
+
+/*
+  The barrier does not use the message buffers: a message that a member sent to
+  another just before the barrier would be taken as a signal, and the signal
+  returned by the next receive of the application. Instead, word [to][from] of a
+  shared array counts the signals from core from to core to, over all groups.
+  Only from writes it; to waits until it exceeds the signals that it consumed.
+  For a pair of cores the signals are consumed in the order they are sent, as
+  long as the cores call the barriers of the groups they share in the same order.
+*/
+
+/* before forking, as the other buffers (the rows of cores that are never
+   signalled are never touched) */
+void
+ssmp_group_init(int num_procs)
+{
+  ssmp_group_bar_num_ues = num_procs;
+  ssmp_group_bar_size = (size_t) num_procs * num_procs * sizeof(uint32_t);
+  ssmp_group_bar = (volatile _Atomic uint32_t*) mmap(NULL, ssmp_group_bar_size, PROT_READ | PROT_WRITE,
+						     MAP_SHARED | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  if (ssmp_group_bar == MAP_FAILED)
+    {
+      perror("ssmp_group_bar = NULL\n");
+      exit(134);
+    }
+}
+
+void
+ssmp_group_term()
+{
+  ssmp_group_free(&ssmp_world);
+  free(ssmp_group_bar_sent);
+  free(ssmp_group_bar_seen);
+  ssmp_group_bar_sent = NULL;
+  ssmp_group_bar_seen = NULL;
+  if (ssmp_group_bar != NULL)
+    {
+      munmap((void*) ssmp_group_bar, ssmp_group_bar_size);
+      ssmp_group_bar = NULL;
+    }
+}
+
+/* dissemination barrier: in the round with distance d (1, 2, 4, ...), signal the
+   member at rank + d and wait for the one at rank - d */
+void
+ssmp_group_barrier(ssmp_group_t* group)
+{
+  if (group->rank < 0)
+    {
+      return;
+    }
+
+  uint32_t num_ues = group->num_ues;
+  uint32_t rank = group->rank;
+  uint32_t* members = group->members;
+  size_t n = ssmp_group_bar_num_ues;
+
+  uint32_t dist;
+  for (dist = 1; dist < num_ues; dist <<= 1)
+    {
+      uint32_t to = members[(rank + dist) % num_ues];
+      uint32_t from = members[(rank + num_ues - dist) % num_ues];
+      atomic_store_explicit(&ssmp_group_bar[to * n + ssmp_id_], ++ssmp_group_bar_sent[to],
+			    memory_order_release);
+
+      uint32_t seen = ++ssmp_group_bar_seen[from];
+      while ((int32_t) (atomic_load_explicit(&ssmp_group_bar[ssmp_id_ * n + from],
+					     memory_order_acquire) - seen) < 0)
+	{
+	  PAUSE;
+	}
+    }
+}
@@ -0,0 +1,291 @@
+/*
+ *   File: ssmp_proto.c
+ *   Author: Vasileios Trigonakis <vasileios.trigonakis@epfl.ch>
+ *   Description: the protocol of every peer, from the topology class of the two cores
+ *   ssmp_proto.c is part of ssmp
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (C) 2013  Vasileios Trigonakis
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include "ssmp.h"
+
+ssmp_proto_t ssmp_proto_peer[SSMP_MAX_UES];
+
+const ssmp_proto_preset_t ssmp_proto_presets[SSMP_PRESET_NUM] =
+  {
+    /* name             wait               backoff             prefetch  update */
+    { "spin",           SSMP_WAIT_LOAD,    SSMP_BACKOFF_NONE,  0,        SSMP_UPDATE_STORE },
+    { "pause",          SSMP_WAIT_LOAD,    SSMP_BACKOFF_PAUSE, 0,        SSMP_UPDATE_STORE },
+    { "backoff",        SSMP_WAIT_LFENCE,  SSMP_BACKOFF_RAMP,  0,        SSMP_UPDATE_STORE },
+    { "prefetchw",      SSMP_WAIT_LOAD,    SSMP_BACKOFF_RAMP,  1,        SSMP_UPDATE_STORE },
+    { "cas",            SSMP_WAIT_CAS,     SSMP_BACKOFF_NONE,  0,        SSMP_UPDATE_STORE },
+    { "backoff_mfence", SSMP_WAIT_LFENCE,  SSMP_BACKOFF_RAMP,  0,        SSMP_UPDATE_MFENCE },
+    { "cas_mfence",     SSMP_WAIT_CAS,     SSMP_BACKOFF_NONE,  0,        SSMP_UPDATE_MFENCE },
+  };
+
+/* smt, l3, socket, remote. The x86 platform replaces these with the defaults of
+   the machine at startup */
+uint8_t ssmp_proto_class_preset[SSMP_TOPO_NUM] =
+#if SSMP_ORDER == SSMP_ORDER_RMW
+  { SSMP_PRESET_CAS, SSMP_PRESET_CAS, SSMP_PRESET_CAS, SSMP_PRESET_CAS };
+#else
+  { SSMP_PRESET_PAUSE, SSMP_PRESET_PAUSE, SSMP_PRESET_PAUSE, SSMP_PRESET_PAUSE };
+#endif
+
+const char* ssmp_topo_names[SSMP_TOPO_NUM] = { "smt", "l3", "socket", "remote" };
+
+/* ------------------------------------------------------------------------------- */
+/* the functions of the protocols */
+/* ------------------------------------------------------------------------------- */
+
+/* with constant wait, backoff and prefetch: every ssmp_proto_wait_<w>_<b>_<p> below
+   is a loop without branches on the settings */
+static inline int
+ssmp_proto_poll_any(SSMP_FLAG_TYPE* flag, uint8_t value, const int wait)
+{
+  switch (wait)
+    {
+    case SSMP_WAIT_CAS:
+      return ssmp_flag_cas(flag, value, SSMP_BUF_LOCKD);
+    case SSMP_WAIT_LFENCE:
+      {
+	int ready = (SSMP_FLAG_LOAD(flag) == value);
+	_mm_lfence();
+	return ready;
+      }
+    default:
+      return (SSMP_FLAG_LOAD(flag) == value);
+    }
+}
+
+static inline void
+ssmp_proto_wait_any(SSMP_FLAG_TYPE* flag, uint8_t value, const int wait, const int backoff,
+		    const int prefetch)
+{
+  uint32_t wted = 0;
+  if (prefetch)
+    {
+      PREFETCHW(flag);
+    }
+  while (!ssmp_proto_poll_any(flag, value, wait))
+    {
+      SSMP_STATS_POLL();
+      if (wait == SSMP_WAIT_CAS)
+	{
+#ifdef SSMP_WAIT_TIME
+	  wait_cycles(SSMP_WAIT_TIME);
+#else
+	  PAUSE;
+#endif
+	}
+      if (backoff == SSMP_BACKOFF_PAUSE)
+	{
+	  _mm_pause();
+	}
+      else if (backoff == SSMP_BACKOFF_RAMP)
+	{
+	  _mm_pause_rep(wted++ & 63);
+	}
+      if (prefetch)
+	{
+	  PREFETCHW(flag);
+	}
+    }
+}
+
+#define SSMP_PROTO_WAIT_FN(w, b, p)					\
+  static void								\
+  ssmp_proto_wait_##w##_##b##_##p(SSMP_FLAG_TYPE* flag, uint8_t value)	\
+  {									\
+    ssmp_proto_wait_any(flag, value, w, b, p);				\
+  }
+#define SSMP_PROTO_WAIT_FNS(w)						\
+  SSMP_PROTO_WAIT_FN(w, 0, 0) SSMP_PROTO_WAIT_FN(w, 0, 1)		\
+  SSMP_PROTO_WAIT_FN(w, 1, 0) SSMP_PROTO_WAIT_FN(w, 1, 1)		\
+  SSMP_PROTO_WAIT_FN(w, 2, 0) SSMP_PROTO_WAIT_FN(w, 2, 1)
+#define SSMP_PROTO_WAIT_ROW(w)						\
+  {									\
+    { ssmp_proto_wait_##w##_0_0, ssmp_proto_wait_##w##_0_1 },		\
+    { ssmp_proto_wait_##w##_1_0, ssmp_proto_wait_##w##_1_1 },		\
+    { ssmp_proto_wait_##w##_2_0, ssmp_proto_wait_##w##_2_1 }		\
+  }
+
+SSMP_PROTO_WAIT_FNS(0)		/* SSMP_WAIT_LOAD */
+SSMP_PROTO_WAIT_FNS(1)		/* SSMP_WAIT_LFENCE */
+SSMP_PROTO_WAIT_FNS(2)		/* SSMP_WAIT_CAS */
+
+static void (*ssmp_proto_wait_fns[SSMP_WAIT_NUM][SSMP_BACKOFF_NUM][2])(SSMP_FLAG_TYPE*, uint8_t) =
+  {
+    SSMP_PROTO_WAIT_ROW(0), SSMP_PROTO_WAIT_ROW(1), SSMP_PROTO_WAIT_ROW(2)
+  };
+
+static int
+ssmp_proto_poll_load(SSMP_FLAG_TYPE* flag, uint8_t value)
+{
+  return ssmp_proto_poll_any(flag, value, SSMP_WAIT_LOAD);
+}
+
+static int
+ssmp_proto_poll_lfence(SSMP_FLAG_TYPE* flag, uint8_t value)
+{
+  return ssmp_proto_poll_any(flag, value, SSMP_WAIT_LFENCE);
+}
+
+static int
+ssmp_proto_poll_cas(SSMP_FLAG_TYPE* flag, uint8_t value)
+{
+  return ssmp_proto_poll_any(flag, value, SSMP_WAIT_CAS);
+}
+
+static int (*ssmp_proto_poll_fns[SSMP_WAIT_NUM])(SSMP_FLAG_TYPE*, uint8_t) =
+  {
+    ssmp_proto_poll_load, ssmp_proto_poll_lfence, ssmp_proto_poll_cas
+  };
+
+static void
+ssmp_proto_update_store(SSMP_FLAG_TYPE* flag, uint8_t value)
+{
+  SSMP_FLAG_STORE(flag, value);
+}
+
+static void
+ssmp_proto_update_mfence(SSMP_FLAG_TYPE* flag, uint8_t value)
+{
+  SSMP_FLAG_STORE(flag, value);
+  atomic_thread_fence(memory_order_seq_cst);
+}
+
+static void
+ssmp_proto_update_xchg(SSMP_FLAG_TYPE* flag, uint8_t value)
+{
+  atomic_exchange_explicit(SSMP_FLAG_ATOMIC(flag), value, memory_order_seq_cst);
+}
+
+static void (*ssmp_proto_update_fns[SSMP_UPDATE_NUM])(SSMP_FLAG_TYPE*, uint8_t) =
+  {
+    ssmp_proto_update_store, ssmp_proto_update_mfence, ssmp_proto_update_xchg
+  };
+
+void
+ssmp_proto_make(ssmp_proto_t* p, const ssmp_proto_preset_t* preset)
+{
+  p->wait = preset->wait;
+  p->backoff = preset->backoff;
+  p->prefetch = (preset->prefetch != 0);
+  p->update = preset->update;
+  p->fast = (p->wait != SSMP_WAIT_CAS && p->update != SSMP_UPDATE_XCHG);
+  p->wait_fn = ssmp_proto_wait_fns[p->wait][p->backoff][p->prefetch];
+  p->poll_fn = ssmp_proto_poll_fns[p->wait];
+  p->update_fn = ssmp_proto_update_fns[p->update];
+}
+
+/* ------------------------------------------------------------------------------- */
+/* topology */
+/* ------------------------------------------------------------------------------- */
+
+typedef struct ssmp_topo
+{
+  int read;			/* 0: not read yet */
+  int core;			/* core_id, -1 if unknown */
+  int l3;			/* id of the L3 cache, -1 if unknown */
+} ssmp_topo_t;
+
+static ssmp_topo_t ssmp_topo[SSMP_MAX_UES];
+
+static int
+ssmp_topo_read(uint32_t cpu, const char* what)
+{
+  char path[128];
+  int v = -1;
+  sprintf(path, "/sys/devices/system/cpu/cpu%u/%s", cpu, what);
+  FILE* f = fopen(path, "r");
+  if (f != NULL)
+    {
+      if (fscanf(f, "%d", &v) != 1)
+	{
+	  v = -1;
+	}
+      fclose(f);
+    }
+  return v;
+}
+
+static ssmp_topo_t*
+ssmp_topo_of(uint32_t id)
+{
+  ssmp_topo_t* t = &ssmp_topo[id];
+  if (!t->read)
+    {
+      t->core = ssmp_topo_read(id_to_core[id], "topology/core_id");
+      t->l3 = ssmp_topo_read(id_to_core[id], "cache/index3/id");
+      t->read = 1;
+    }
+  return t;
+}
+
+void
+ssmp_proto_topo_init(int num_procs)
+{
+  int id;
+  for (id = 0; id < num_procs; id++)
+    {
+      ssmp_topo_of(id);
+      ssmp_cores_on_same_socket(id, id); /* the platform may cache the socket too */
+    }
+}
+
+int
+ssmp_proto_class(uint32_t id1, uint32_t id2)
+{
+  if (!ssmp_cores_on_same_socket(id1, id2))
+    {
+      return SSMP_TOPO_REMOTE;
+    }
+
+  ssmp_topo_t* t1 = ssmp_topo_of(id1);
+  ssmp_topo_t* t2 = ssmp_topo_of(id2);
+  if (id_to_core[id1] == id_to_core[id2] || (t1->core >= 0 && t1->core == t2->core))
+    {
+      return SSMP_TOPO_SMT;
+    }
+  if (t1->l3 >= 0 && t1->l3 == t2->l3)
+    {
+      return SSMP_TOPO_L3;
+    }
+  return SSMP_TOPO_SOCKET;
+}
+
+void
+ssmp_proto_init(int id, int num_ues)
+{
+  ssmp_proto_t protos[SSMP_TOPO_NUM];
+  int cls, c;
+  for (cls = 0; cls < SSMP_TOPO_NUM; cls++)
+    {
+      ssmp_proto_make(&protos[cls], &ssmp_proto_presets[ssmp_proto_class_preset[cls]]);
+    }
+  for (c = 0; c < num_ues; c++)
+    {
+      ssmp_proto_peer[c] = protos[ssmp_proto_class(id, c)];
+    }
+}
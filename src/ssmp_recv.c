@@ -38,33 +38,80 @@
 inline void
 ssmp_recv_from(uint32_t from, volatile ssmp_msg_t* msg) 
 {
-  ssmp_recv_from_platf(from, msg);
+  SSMP_TRACE_START();
+  SSMP_STATS_WAIT(ssmp_recv_is_ready_platf(from), ssmp_recv_from_platf(from, msg),
+		  recv_spins, recv_wait_ticks);
+  SSMP_STATS_RECV(from, sizeof(ssmp_msg_t));
+  SSMP_TRACE_EVENT(SSMP_TRACE_RECV, from, sizeof(ssmp_msg_t), 0);
 }
 
 
 inline void 
 ssmp_recv(ssmp_msg_t* msg)
 {
+  SSMP_TRACE_START();
+  SSMP_STATS_TICKS_START();
   ssmp_recv_platf(msg);
+  SSMP_STATS_TICKS_STOP(recv_wait_ticks);
+  SSMP_STATS_RECV(msg->sender, sizeof(ssmp_msg_t));
+  SSMP_TRACE_EVENT(SSMP_TRACE_RECV_ANY, msg->sender, sizeof(ssmp_msg_t), 0);
 }
 
 
 inline void 
 ssmp_recv_color(ssmp_color_buf_t* cbuf, ssmp_msg_t* msg)
 {
+  SSMP_TRACE_START();
+  SSMP_STATS_TICKS_START();
   ssmp_recv_color_platf(cbuf, msg);
+  SSMP_STATS_TICKS_STOP(recv_wait_ticks);
+  SSMP_STATS_RECV(msg->sender, sizeof(ssmp_msg_t));
+  SSMP_TRACE_EVENT(SSMP_TRACE_RECV_ANY, msg->sender, sizeof(ssmp_msg_t), 0);
 }
 
 
 inline void
 ssmp_recv_color_start(ssmp_color_buf_t* cbuf, ssmp_msg_t* msg)
 {
+  SSMP_TRACE_START();
+  SSMP_STATS_TICKS_START();
   ssmp_recv_color_start_platf(cbuf, msg);
+  SSMP_STATS_TICKS_STOP(recv_wait_ticks);
+  SSMP_STATS_RECV(msg->sender, sizeof(ssmp_msg_t));
+  SSMP_TRACE_EVENT(SSMP_TRACE_RECV_ANY, msg->sender, sizeof(ssmp_msg_t), 0);
 }
 
 inline 
 void ssmp_recv_from_big(int from, void* data, size_t length) 
 {
+  SSMP_TRACE_START();
+  SSMP_STATS_TICKS_START();
   ssmp_recv_from_big_platf(from, data, length);
+  SSMP_STATS_TICKS_STOP(big_recv_ticks);
+  SSMP_STATS_ADD(big_bytes_recv, length);
+  SSMP_STATS_RECV(from, length);
+  SSMP_TRACE_EVENT(SSMP_TRACE_RECV_BIG, from, length, 0);
 }
       
+
+inline void
+ssmp_recv_group(ssmp_group_t* group, ssmp_msg_t* msg)
+{
+  SSMP_TRACE_START();
+  SSMP_STATS_TICKS_START();
+  ssmp_recv_color_platf(&group->cbuf, msg);
+  SSMP_STATS_TICKS_STOP(recv_wait_ticks);
+  SSMP_STATS_RECV(msg->sender, sizeof(ssmp_msg_t));
+  SSMP_TRACE_EVENT(SSMP_TRACE_RECV_ANY, msg->sender, sizeof(ssmp_msg_t), 0);
+}
+
+inline void
+ssmp_recv_group_start(ssmp_group_t* group, ssmp_msg_t* msg)
+{
+  SSMP_TRACE_START();
+  SSMP_STATS_TICKS_START();
+  ssmp_recv_color_start_platf(&group->cbuf, msg);
+  SSMP_STATS_TICKS_STOP(recv_wait_ticks);
+  SSMP_STATS_RECV(msg->sender, sizeof(ssmp_msg_t));
+  SSMP_TRACE_EVENT(SSMP_TRACE_RECV_ANY, msg->sender, sizeof(ssmp_msg_t), 0);
+}
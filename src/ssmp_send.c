@@ -38,7 +38,11 @@
 inline void
 ssmp_send(uint32_t to, volatile ssmp_msg_t* msg) 
 {
-  ssmp_send_platf(to, msg);
+  SSMP_TRACE_START();
+  SSMP_STATS_WAIT(ssmp_send_is_free_platf(to), ssmp_send_platf(to, msg),
+		  send_spins, send_wait_ticks);
+  SSMP_STATS_SENT(to, sizeof(ssmp_msg_t));
+  SSMP_TRACE_EVENT(SSMP_TRACE_SEND, to, sizeof(ssmp_msg_t), 0);
 }
 
 inline int
@@ -50,11 +54,20 @@ ssmp_send_is_free(uint32_t to)
 inline void
 ssmp_send_no_sync(uint32_t to, volatile ssmp_msg_t* msg) 
 {
+  SSMP_TRACE_START();
   ssmp_send_no_sync_platf(to, msg);
+  SSMP_STATS_SENT(to, sizeof(ssmp_msg_t));
+  SSMP_TRACE_EVENT(SSMP_TRACE_SEND, to, sizeof(ssmp_msg_t), 0);
 }
 
 void
 ssmp_send_big(int to, void* data, size_t length) 
 {
+  SSMP_TRACE_START();
+  SSMP_STATS_TICKS_START();
   ssmp_send_big_platf(to, data, length);
+  SSMP_STATS_TICKS_STOP(big_send_ticks);
+  SSMP_STATS_ADD(big_bytes_sent, length);
+  SSMP_STATS_SENT(to, length);
+  SSMP_TRACE_EVENT(SSMP_TRACE_SEND_BIG, to, length, 0);
 }
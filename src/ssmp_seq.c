@@ -0,0 +1,226 @@
+/*
+ *   File: ssmp_seq.c
+ *   Author: Vasileios Trigonakis <vasileios.trigonakis@epfl.ch>
+ *   Description: messaging over rings of sequence-numbered slots (SSMP_OPT_SEQ)
+ *   ssmp_seq.c is part of ssmp
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (C) 2013  Vasileios Trigonakis
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include "ssmp.h"
+
+/*
+  With the flag protocol, the receiver frees a buffer by writing its flag, in the
+  line that the sender writes next: every message moves the line to the receiver
+  and back. Here the sender of the pair (from, to) owns a ring of SSMP_SEQ_SLOTS
+  slots and writes the number of the message (1, 2, ..) to the sender word of a
+  slot after its data; the receiver waits for the number it expects in the next
+  slot and never writes to the slots. It counts the messages it took in an ack
+  line of its own, every SSMP_SEQ_ACK_BATCH messages. The sender keeps the last
+  count it read and reads the ack line again only when the ring looks full.
+*/
+
+typedef struct ALIGNED(SSMP_CACHE_LINE_SIZE) ssmp_seq_ack
+{
+  volatile uint32_t acked;	/* messages taken by the receiver */
+  uint8_t pad[SSMP_CACHE_LINE_SIZE - sizeof(uint32_t)];
+} ssmp_seq_ack_t;
+
+/* the channel from a core to another */
+typedef struct ssmp_seq_chan
+{
+  ssmp_msg_t slots[SSMP_SEQ_SLOTS];
+  ssmp_seq_ack_t ack;
+} ssmp_seq_chan_t;
+
+/* what a core knows about its channels with a peer */
+typedef struct ssmp_seq_peer
+{
+  uint32_t sent;		/* to the peer */
+  uint32_t acked;		/* by the peer, as last read */
+  uint32_t recvd;		/* from the peer */
+  uint32_t unacked;		/* received, not acknowledged yet */
+} ssmp_seq_peer_t;
+
+#define SSMP_SEQ_WORD(m)     ((volatile _Atomic uint32_t*) &(m)->sender)
+/* the bytes of a message before and after the sender word */
+#define SSMP_SEQ_HEAD        offsetof(ssmp_msg_t, sender)
+#define SSMP_SEQ_TAIL        (SSMP_SEQ_HEAD + sizeof(uint32_t))
+
+ssmp_seq_counters_t ssmp_seq_counters;
+
+static ssmp_seq_chan_t* ssmp_seq_mem;
+static size_t ssmp_seq_size;
+static uint32_t ssmp_seq_num_ues;
+static uint32_t ssmp_seq_id;
+static ssmp_seq_peer_t* ssmp_seq_peer;
+
+/* the channel from core from to core to */
+static inline ssmp_seq_chan_t*
+ssmp_seq_chan(uint32_t from, uint32_t to)
+{
+  return ssmp_seq_mem + (size_t) to * ssmp_seq_num_ues + from;
+}
+
+/* before forking, as the other buffers (pages of unused channels are never touched) */
+void
+ssmp_seq_init(int num_procs)
+{
+  ssmp_seq_num_ues = num_procs;
+  ssmp_seq_size = (size_t) num_procs * num_procs * sizeof(ssmp_seq_chan_t);
+  ssmp_seq_mem = (ssmp_seq_chan_t*) mmap(NULL, ssmp_seq_size, PROT_READ | PROT_WRITE,
+					 MAP_SHARED | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  if (ssmp_seq_mem == MAP_FAILED)
+    {
+      perror("ssmp_seq_mem = NULL\n");
+      exit(134);
+    }
+}
+
+void
+ssmp_seq_mem_init(int id, int num_ues)
+{
+  ssmp_seq_id = id;
+  ssmp_seq_peer = (ssmp_seq_peer_t*) calloc(num_ues, sizeof(ssmp_seq_peer_t));
+  if (ssmp_seq_peer == NULL)
+    {
+      perror("malloc@ ssmp_seq_mem_init\n");
+      exit(-1);
+    }
+  memset(&ssmp_seq_counters, 0, sizeof(ssmp_seq_counters));
+}
+
+void
+ssmp_seq_term()
+{
+  if (ssmp_seq_mem != NULL)
+    {
+      free(ssmp_seq_peer);
+      munmap(ssmp_seq_mem, ssmp_seq_size);
+      ssmp_seq_mem = NULL;
+    }
+}
+
+/* ------------------------------------------------------------------------------- */
+/* sending / receiving */
+/* ------------------------------------------------------------------------------- */
+
+/* 1 if the ring to to has a free slot, reading the ack line only if it looks full */
+static inline int
+ssmp_seq_has_slot(ssmp_seq_chan_t* chan, ssmp_seq_peer_t* p)
+{
+  if (p->sent - p->acked < SSMP_SEQ_SLOTS)
+    {
+      return 1;
+    }
+  uint32_t acked = atomic_load_explicit((volatile _Atomic uint32_t*) &chan->ack.acked,
+					memory_order_acquire);
+  if (acked != p->acked)
+    {
+      ssmp_seq_counters.ack_misses++;
+      p->acked = acked;
+    }
+  return (p->sent - p->acked < SSMP_SEQ_SLOTS);
+}
+
+/* until the ring to to has a free slot */
+static inline void
+ssmp_seq_wait_slot(ssmp_seq_chan_t* chan, ssmp_seq_peer_t* p)
+{
+  while (!ssmp_seq_has_slot(chan, p))
+    {
+      SSMP_STATS_POLL();
+      PAUSE;
+    }
+}
+
+/* until the word of slot carries seq */
+static inline void
+ssmp_seq_wait_seq(ssmp_msg_t* slot, uint32_t seq)
+{
+  while (atomic_load_explicit(SSMP_SEQ_WORD(slot), memory_order_acquire) != seq)
+    {
+      SSMP_STATS_POLL();
+      PAUSE;
+    }
+}
+
+int
+ssmp_seq_send_is_free(uint32_t to)
+{
+  return ssmp_seq_has_slot(ssmp_seq_chan(ssmp_seq_id, to), &ssmp_seq_peer[to]);
+}
+
+void
+ssmp_seq_send(uint32_t to, volatile ssmp_msg_t* msg)
+{
+  SSMP_TRACE_START();
+  ssmp_seq_chan_t* chan = ssmp_seq_chan(ssmp_seq_id, to);
+  ssmp_seq_peer_t* p = &ssmp_seq_peer[to];
+  if (p->sent - p->acked >= SSMP_SEQ_SLOTS)
+    {
+      ssmp_seq_counters.ack_loads++;
+      SSMP_STATS_WAIT(ssmp_seq_has_slot(chan, p), ssmp_seq_wait_slot(chan, p),
+		      send_spins, send_wait_ticks);
+    }
+
+  ssmp_msg_t* slot = &chan->slots[p->sent % SSMP_SEQ_SLOTS];
+  memcpy((void*) slot, (const void*) msg, SSMP_SEQ_HEAD);
+  memcpy((char*) slot + SSMP_SEQ_TAIL, (const char*) msg + SSMP_SEQ_TAIL,
+	 sizeof(ssmp_msg_t) - SSMP_SEQ_TAIL);
+  atomic_store_explicit(SSMP_SEQ_WORD(slot), ++p->sent, memory_order_release);
+  SSMP_STATS_SENT(to, sizeof(ssmp_msg_t));
+  SSMP_TRACE_EVENT(SSMP_TRACE_SEND, to, sizeof(ssmp_msg_t), 0);
+}
+
+int
+ssmp_seq_recv_is_ready(uint32_t from)
+{
+  ssmp_seq_peer_t* p = &ssmp_seq_peer[from];
+  ssmp_msg_t* slot = &ssmp_seq_chan(from, ssmp_seq_id)->slots[p->recvd % SSMP_SEQ_SLOTS];
+  return (atomic_load_explicit(SSMP_SEQ_WORD(slot), memory_order_acquire) == p->recvd + 1);
+}
+
+void
+ssmp_seq_recv_from(uint32_t from, volatile ssmp_msg_t* msg)
+{
+  SSMP_TRACE_START();
+  ssmp_seq_chan_t* chan = ssmp_seq_chan(from, ssmp_seq_id);
+  ssmp_seq_peer_t* p = &ssmp_seq_peer[from];
+  ssmp_msg_t* slot = &chan->slots[p->recvd % SSMP_SEQ_SLOTS];
+  uint32_t seq = p->recvd + 1;
+  SSMP_STATS_WAIT(atomic_load_explicit(SSMP_SEQ_WORD(slot), memory_order_acquire) == seq,
+		  ssmp_seq_wait_seq(slot, seq), recv_spins, recv_wait_ticks);
+
+  memcpy((void*) msg, (const void*) slot, sizeof(ssmp_msg_t));
+  msg->sender = from;
+  p->recvd = seq;
+  if (++p->unacked == SSMP_SEQ_ACK_BATCH)
+    {
+      atomic_store_explicit((volatile _Atomic uint32_t*) &chan->ack.acked, seq, memory_order_release);
+      ssmp_seq_counters.ack_stores++;
+      p->unacked = 0;
+    }
+  SSMP_STATS_RECV(from, sizeof(ssmp_msg_t));
+  SSMP_TRACE_EVENT(SSMP_TRACE_RECV, from, sizeof(ssmp_msg_t), 0);
+}
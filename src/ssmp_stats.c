@@ -0,0 +1,131 @@
+/*
+ *   File: ssmp_stats.c
+ *   Author: Vasileios Trigonakis <vasileios.trigonakis@epfl.ch>
+ *   Description: the shared segment of the live statistics
+ *   ssmp_stats.c is part of ssmp
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (C) 2013  Vasileios Trigonakis
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include "ssmp.h"
+
+#if defined(SSMP_STATS)
+
+ssmp_stats_core_t* ssmp_stats_core_;
+ssmp_stats_peer_t* ssmp_stats_peer_;
+uint64_t ssmp_stats_polls_;
+
+static ssmp_stats_hdr_t* ssmp_stats_mem;
+static size_t ssmp_stats_size;
+static int ssmp_stats_pid;	/* of the process that created the segment */
+
+/* the creator removes the name of the segment when it exits, also without
+   ssmp_term (the forked processes inherit the handler, hence the pid) */
+static void
+ssmp_stats_unlink()
+{
+  if (ssmp_stats_pid != 0 && getpid() == ssmp_stats_pid)
+    {
+      char keyF[100];
+      sprintf(keyF, SSMP_STATS_NAME, ssmp_stats_pid);
+      shm_unlink(keyF);
+      ssmp_stats_pid = 0;
+    }
+}
+
+/* the header, then per core its ssmp_stats_core_t and num_procs ssmp_stats_peer_t */
+void
+ssmp_stats_init(int num_procs)
+{
+  size_t core_size = sizeof(ssmp_stats_core_t) + num_procs * sizeof(ssmp_stats_peer_t);
+  SSMP_INC_ALIGN(core_size);
+  ssmp_stats_size = sizeof(ssmp_stats_hdr_t) + num_procs * core_size;
+  ssmp_stats_pid = getpid();
+
+  static int registered = 0;
+  if (!registered)
+    {
+      atexit(ssmp_stats_unlink);
+      registered = 1;
+    }
+
+  char keyF[100];
+  sprintf(keyF, SSMP_STATS_NAME, ssmp_stats_pid);
+
+  int ssmpfd = shm_open(keyF, O_CREAT | O_RDWR | O_TRUNC, S_IRWXU | S_IRWXG);
+  if (ssmpfd < 0)
+    {
+      perror("In shm_open");
+      exit(1);
+    }
+
+  if (ftruncate(ssmpfd, ssmp_stats_size) < 0)
+    {
+      perror("ftruncate failed\n");
+      exit(1);
+    }
+
+  ssmp_stats_mem = (ssmp_stats_hdr_t*) mmap(NULL, ssmp_stats_size, PROT_READ | PROT_WRITE,
+					    MAP_SHARED | MAP_NORESERVE, ssmpfd, 0);
+  if (ssmp_stats_mem == MAP_FAILED)
+    {
+      perror("ssmp_stats_mem = NULL\n");
+      exit(134);
+    }
+  close(ssmpfd);
+
+  ssmp_stats_mem->num_ues = num_procs;
+  ssmp_stats_mem->core_size = core_size;
+  _mm_mfence();
+  ssmp_stats_mem->magic = SSMP_STATS_MAGIC;
+}
+
+void
+ssmp_stats_mem_init(int id)
+{
+  char* cores = (char*) (ssmp_stats_mem + 1);
+  ssmp_stats_core_ = (ssmp_stats_core_t*) (cores + id * ssmp_stats_mem->core_size);
+  ssmp_stats_peer_ = (ssmp_stats_peer_t*) (ssmp_stats_core_ + 1);
+  ssmp_stats_core_->pid = getpid();
+}
+
+/* also called without ssmp_mem_init (or without ssmp_init) */
+void
+ssmp_stats_term()
+{
+  if (ssmp_stats_mem == NULL)
+    {
+      return;
+    }
+  if (ssmp_stats_core_ != NULL)
+    {
+      ssmp_stats_core_->pid = 0;
+      ssmp_stats_core_ = NULL;
+      ssmp_stats_peer_ = NULL;
+    }
+  ssmp_stats_unlink();
+  munmap(ssmp_stats_mem, ssmp_stats_size);
+  ssmp_stats_mem = NULL;
+}
+
+#endif	/* SSMP_STATS */
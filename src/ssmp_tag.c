@@ -0,0 +1,284 @@
+/*
+ *   File: ssmp_tag.c
+ *   Author: Vasileios Trigonakis <vasileios.trigonakis@epfl.ch>
+ *   Description: tagged messages and selective (matching) receive
+ *   ssmp_tag.c is part of ssmp
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (C) 2013  Vasileios Trigonakis
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include "ssmp.h"
+
+#if !defined(__tile__)		/* the Tilera messages have no tag */
+
+extern volatile ssmp_msg_t** ssmp_recv_buf;
+extern int ssmp_num_ues_;
+extern int ssmp_id_;
+
+/* ------------------------------------------------------------------------------- */
+/* the unexpected queue                                                            */
+/* ------------------------------------------------------------------------------- */
+
+/*
+  The messages that arrived while looking for a different (source, tag) are kept
+  in the unexpected queue. Every queued message is on three lists, all in arrival
+  order: the list of all messages, the one of its sender, and the one of the hash
+  bucket of its tag. Any combination of source / tag (or any) is thus matched by
+  walking a single list, and the messages of a sender keep their send order.
+*/
+
+#define SSMP_UQ_ALL 0
+#define SSMP_UQ_SRC 1
+#define SSMP_UQ_TAG 2
+#define SSMP_UQ_BLOCK 64	/* entries allocated at once */
+
+typedef struct ssmp_uq_entry ssmp_uq_entry_t;
+
+typedef struct ssmp_uq_link
+{
+  ssmp_uq_entry_t* next;
+  ssmp_uq_entry_t* prev;
+} ssmp_uq_link_t;
+
+struct ssmp_uq_entry
+{
+  ssmp_msg_t msg;
+  ssmp_uq_link_t link[3];	/* SSMP_UQ_ALL, SSMP_UQ_SRC, SSMP_UQ_TAG */
+};
+
+typedef struct ssmp_uq_list
+{
+  ssmp_uq_entry_t* head;
+  ssmp_uq_entry_t* tail;
+} ssmp_uq_list_t;
+
+static ssmp_uq_list_t uq_all;
+static ssmp_uq_list_t* uq_src = NULL; /* one per core */
+static ssmp_uq_list_t uq_tag[SSMP_TAG_HASH_SIZE];
+static ssmp_uq_entry_t* uq_free = NULL;	/* linked through link[SSMP_UQ_ALL].next */
+
+static inline ssmp_uq_list_t*
+uq_tag_bucket(uint32_t tag)
+{
+  return &uq_tag[tag & (SSMP_TAG_HASH_SIZE - 1)];
+}
+
+static inline void
+uq_list_append(ssmp_uq_list_t* list, ssmp_uq_entry_t* e, int k)
+{
+  e->link[k].next = NULL;
+  e->link[k].prev = list->tail;
+  if (list->tail != NULL)
+    {
+      list->tail->link[k].next = e;
+    }
+  else
+    {
+      list->head = e;
+    }
+  list->tail = e;
+}
+
+static inline void
+uq_list_unlink(ssmp_uq_list_t* list, ssmp_uq_entry_t* e, int k)
+{
+  if (e->link[k].prev != NULL)
+    {
+      e->link[k].prev->link[k].next = e->link[k].next;
+    }
+  else
+    {
+      list->head = e->link[k].next;
+    }
+  if (e->link[k].next != NULL)
+    {
+      e->link[k].next->link[k].prev = e->link[k].prev;
+    }
+  else
+    {
+      list->tail = e->link[k].prev;
+    }
+}
+
+static ssmp_uq_entry_t*
+uq_entry_alloc()
+{
+  if (uq_free == NULL)
+    {
+      ssmp_uq_entry_t* block = (ssmp_uq_entry_t*) memalign(SSMP_CACHE_LINE_SIZE,
+							   SSMP_UQ_BLOCK * sizeof(ssmp_uq_entry_t));
+      if (block == NULL)
+	{
+	  perror("memalign @ uq_entry_alloc");
+	  exit(-1);
+	}
+
+      uint32_t i;
+      for (i = 0; i < SSMP_UQ_BLOCK; i++)
+	{
+	  block[i].link[SSMP_UQ_ALL].next = uq_free;
+	  uq_free = &block[i];
+	}
+    }
+
+  ssmp_uq_entry_t* e = uq_free;
+  uq_free = e->link[SSMP_UQ_ALL].next;
+  return e;
+}
+
+/* msg->sender must be set */
+static void
+uq_put(ssmp_msg_t* msg)
+{
+  if (uq_src == NULL)
+    {
+      uq_src = (ssmp_uq_list_t*) calloc(ssmp_num_ues_, sizeof(ssmp_uq_list_t));
+      if (uq_src == NULL)
+	{
+	  perror("calloc @ uq_put");
+	  exit(-1);
+	}
+    }
+
+  ssmp_uq_entry_t* e = uq_entry_alloc();
+  memcpy(&e->msg, msg, sizeof(ssmp_msg_t));
+  uq_list_append(&uq_all, e, SSMP_UQ_ALL);
+  uq_list_append(&uq_src[msg->sender], e, SSMP_UQ_SRC);
+  uq_list_append(uq_tag_bucket(msg->tag), e, SSMP_UQ_TAG);
+}
+
+/* the oldest queued message that matches from / tag, NULL if none */
+static ssmp_uq_entry_t*
+uq_find(int from, int tag)
+{
+  if (tag == SSMP_ANY_TAG)
+    {
+      return (from == SSMP_ANY_SOURCE) ? uq_all.head : uq_src[from].head;
+    }
+
+  ssmp_uq_entry_t* e;
+  for (e = uq_tag_bucket(tag)->head; e != NULL; e = e->link[SSMP_UQ_TAG].next)
+    {
+      if (e->msg.tag == (uint32_t) tag && (from == SSMP_ANY_SOURCE || e->msg.sender == from))
+	{
+	  return e;
+	}
+    }
+  return NULL;
+}
+
+static void
+uq_remove(ssmp_uq_entry_t* e)
+{
+  uq_list_unlink(&uq_all, e, SSMP_UQ_ALL);
+  uq_list_unlink(&uq_src[e->msg.sender], e, SSMP_UQ_SRC);
+  uq_list_unlink(uq_tag_bucket(e->msg.tag), e, SSMP_UQ_TAG);
+  e->link[SSMP_UQ_ALL].next = uq_free;
+  uq_free = e;
+}
+
+static inline int
+uq_matches(ssmp_msg_t* msg, int tag)
+{
+  return (tag == SSMP_ANY_TAG || msg->tag == (uint32_t) tag);
+}
+
+/* ------------------------------------------------------------------------------- */
+/* tagged send / receive                                                           */
+/* ------------------------------------------------------------------------------- */
+
+inline void
+ssmp_send_tag(uint32_t to, ssmp_msg_t* msg, int tag)
+{
+  msg->tag = tag;
+  ssmp_send(to, msg);
+}
+
+void
+ssmp_recv_tag(int from, int tag, ssmp_msg_t* msg)
+{
+  if (uq_all.head != NULL)
+    {
+      ssmp_uq_entry_t* e = uq_find(from, tag);
+      if (e != NULL)
+	{
+	  memcpy(msg, &e->msg, sizeof(ssmp_msg_t));
+	  uq_remove(e);
+	  return;
+	}
+    }
+
+  while (1)
+    {
+      if (from == SSMP_ANY_SOURCE)
+	{
+	  ssmp_recv(msg);
+	}
+      else
+	{
+	  ssmp_recv_from(from, msg);
+	  msg->sender = from;
+	}
+
+      if (uq_matches(msg, tag))
+	{
+	  return;
+	}
+      uq_put(msg);
+    }
+}
+
+int
+ssmp_probe(int from, int tag, ssmp_msg_t* msg)
+{
+  ssmp_uq_entry_t* e = (uq_all.head != NULL) ? uq_find(from, tag) : NULL;
+  if (e != NULL)
+    {
+      memcpy(msg, &e->msg, sizeof(ssmp_msg_t));
+      return 1;
+    }
+
+  /* move the messages that have already arrived to the queue, until a match */
+  uint32_t ue = (from == SSMP_ANY_SOURCE) ? 0 : from;
+  uint32_t last = (from == SSMP_ANY_SOURCE) ? ssmp_num_ues_ : from + 1;
+  for (; ue < last; ue++)
+    {
+      if (ue == ssmp_id_ || ssmp_recv_buf[ue] == NULL /* not a peer */
+	  || SSMP_FLAG_LOAD(&ssmp_recv_buf[ue]->state) != SSMP_BUF_MESSG)
+	{
+	  continue;
+	}
+
+      ssmp_recv_from(ue, msg);
+      msg->sender = ue;
+      uq_put(msg);
+      if (uq_matches(msg, tag))
+	{
+	  return 1;
+	}
+    }
+
+  return 0;
+}
+
+#endif	/* !__tile__ */
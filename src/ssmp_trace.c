@@ -0,0 +1,110 @@
+/*
+ *   File: ssmp_trace.c
+ *   Author: Vasileios Trigonakis <vasileios.trigonakis@epfl.ch>
+ *   Description: the shared segment of the event tracing
+ *   ssmp_trace.c is part of ssmp
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (C) 2013  Vasileios Trigonakis
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include "ssmp.h"
+
+#if defined(SSMP_TRACE)
+
+ssmp_trace_ring_t* ssmp_trace_ring_;
+ssmp_trace_event_t* ssmp_trace_events_;
+uint64_t ssmp_trace_mask_;
+
+static ssmp_trace_hdr_t* ssmp_trace_mem;
+static size_t ssmp_trace_size;
+
+/* the header, then per core its ssmp_trace_ring_t and ring_events events */
+void
+ssmp_trace_init(int num_procs)
+{
+  uint64_t events = SSMP_TRACE_EVENTS;
+  char* env = getenv("SSMP_TRACE_EVENTS");
+  if (env != NULL && atoll(env) > 0)
+    {
+      events = atoll(env);
+    }
+  uint64_t ring_events = 1;
+  while (ring_events < events)
+    {
+      ring_events <<= 1;
+    }
+
+  size_t ring_size = sizeof(ssmp_trace_ring_t) + ring_events * sizeof(ssmp_trace_event_t);
+  SSMP_INC_ALIGN(ring_size);
+  ssmp_trace_size = sizeof(ssmp_trace_hdr_t) + num_procs * ring_size;
+
+  char keyF[100];
+  sprintf(keyF, SSMP_TRACE_NAME, getpid());
+
+  int ssmpfd = shm_open(keyF, O_CREAT | O_RDWR | O_TRUNC, S_IRWXU | S_IRWXG);
+  if (ssmpfd < 0)
+    {
+      perror("In shm_open");
+      exit(1);
+    }
+
+  if (ftruncate(ssmpfd, ssmp_trace_size) < 0)
+    {
+      perror("ftruncate failed\n");
+      exit(1);
+    }
+
+  ssmp_trace_mem = (ssmp_trace_hdr_t*) mmap(NULL, ssmp_trace_size, PROT_READ | PROT_WRITE,
+					    MAP_SHARED | MAP_NORESERVE, ssmpfd, 0);
+  if (ssmp_trace_mem == MAP_FAILED)
+    {
+      perror("ssmp_trace_mem = NULL\n");
+      exit(134);
+    }
+  close(ssmpfd);
+
+  ssmp_trace_mem->num_ues = num_procs;
+  ssmp_trace_mem->ring_events = ring_events;
+  ssmp_trace_mem->ring_size = ring_size;
+  _mm_mfence();
+  ssmp_trace_mem->magic = SSMP_TRACE_MAGIC;
+  ssmp_trace_mask_ = ring_events - 1;
+}
+
+void
+ssmp_trace_mem_init(int id)
+{
+  char* rings = (char*) (ssmp_trace_mem + 1);
+  ssmp_trace_ring_ = (ssmp_trace_ring_t*) (rings + id * ssmp_trace_mem->ring_size);
+  ssmp_trace_events_ = (ssmp_trace_event_t*) (ssmp_trace_ring_ + 1);
+  ssmp_trace_ring_->pid = getpid();
+}
+
+/* the segment is not unlinked: ssmp_trace -u removes it after dumping it */
+void
+ssmp_trace_term()
+{
+  munmap(ssmp_trace_mem, ssmp_trace_size);
+}
+
+#endif	/* SSMP_TRACE */
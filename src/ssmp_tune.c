@@ -0,0 +1,334 @@
+/*
+ *   File: ssmp_tune.c
+ *   Author: Vasileios Trigonakis <vasileios.trigonakis@epfl.ch>
+ *   Description: the preset of every topology class, measured and persisted
+ *   ssmp_tune.c is part of ssmp
+ */
+
+#include <sys/wait.h>
+#include <sys/utsname.h>
+#include "ssmp.h"
+
+#ifndef SSMP_TUNE_REPS		/* roundtrips per round of a measurement */
+#  define SSMP_TUNE_REPS     4000
+#endif
+#define SSMP_TUNE_ROUNDS     5	/* the median round counts */
+#define SSMP_TUNE_VERSION    2
+
+double ssmp_proto_cycles[SSMP_TOPO_NUM][SSMP_PRESET_NUM];
+
+/* ------------------------------------------------------------------------------- */
+/* the profile */
+/* ------------------------------------------------------------------------------- */
+
+const char*
+ssmp_tune_profile()
+{
+  static char path[512];
+  char* env = getenv("SSMP_PROFILE");
+  if (env != NULL && *env)
+    {
+      return env;
+    }
+  char* home = getenv("HOME");
+  snprintf(path, sizeof(path), "%s/.ssmp_profile", (home != NULL) ? home : "/tmp");
+  return path;
+}
+
+/* the profile is only valid on the machine (host name and number of cpus) that
+   measured it */
+static void
+ssmp_tune_machine(char* machine, size_t len)
+{
+  struct utsname u;
+  if (uname(&u) < 0)
+    {
+      strcpy(u.nodename, "unknown");
+    }
+  snprintf(machine, len, "%s/%ld", u.nodename, sysconf(_SC_NPROCESSORS_ONLN));
+}
+
+static int
+ssmp_preset_of_name(const char* name)
+{
+  int w;
+  for (w = 0; w < SSMP_PRESET_NUM; w++)
+    {
+      if (strcmp(name, ssmp_proto_presets[w].name) == 0)
+	{
+	  return w;
+	}
+    }
+  return -1;
+}
+
+/*
+  # comments
+  version 2
+  machine <host>/<cpus>
+  <class> <preset> <preset>=<cycles> ...
+*/
+static int
+ssmp_tune_load(const char* path)
+{
+  FILE* f = fopen(path, "r");
+  if (f == NULL)
+    {
+      return 0;
+    }
+
+  char line[512], machine[300], key[64], val[300];
+  int version = 0, same_machine = 0, cls, w;
+  uint8_t preset[SSMP_TOPO_NUM];
+  double cycles[SSMP_TOPO_NUM][SSMP_PRESET_NUM] = { { 0 } };
+  memcpy(preset, ssmp_proto_class_preset, sizeof(preset));
+  ssmp_tune_machine(machine, sizeof(machine));
+
+  while (fgets(line, sizeof(line), f) != NULL)
+    {
+      if (line[0] == '#' || sscanf(line, "%63s %299s", key, val) != 2)
+	{
+	  continue;
+	}
+      if (strcmp(key, "version") == 0)
+	{
+	  version = atoi(val);
+	  continue;
+	}
+      if (strcmp(key, "machine") == 0)
+	{
+	  same_machine = (strcmp(val, machine) == 0);
+	  continue;
+	}
+      for (cls = 0; cls < SSMP_TOPO_NUM; cls++)
+	{
+	  if (strcmp(key, ssmp_topo_names[cls]) == 0 && (w = ssmp_preset_of_name(val)) >= 0)
+	    {
+	      preset[cls] = w;
+	      char* tok = strtok(line, " \t\n");
+	      while ((tok = strtok(NULL, " \t\n")) != NULL)
+		{
+		  char* eq = strchr(tok, '=');
+		  if (eq != NULL)
+		    {
+		      *eq = '\0';
+		      if ((w = ssmp_preset_of_name(tok)) >= 0)
+			{
+			  cycles[cls][w] = atof(eq + 1);
+			}
+		    }
+		}
+	    }
+	}
+    }
+  fclose(f);
+
+  if (version != SSMP_TUNE_VERSION || !same_machine)
+    {
+      return 0;
+    }
+  memcpy(ssmp_proto_class_preset, preset, sizeof(preset));
+  memcpy(ssmp_proto_cycles, cycles, sizeof(cycles));
+  return 1;
+}
+
+/* written to a temporary file that is renamed, so that a concurrent run never
+   reads half a profile */
+static void
+ssmp_tune_store(const char* path)
+{
+  char tmp[600], machine[300];
+  snprintf(tmp, sizeof(tmp), "%s.%d", path, getpid());
+  ssmp_tune_machine(machine, sizeof(machine));
+
+  FILE* f = fopen(tmp, "w");
+  if (f == NULL)
+    {
+      perror("ssmp_tune: cannot write the profile");
+      return;
+    }
+  fprintf(f, "# ssmp protocol profile: <class> <fastest preset> <preset>=<cycles per roundtrip> ...\n");
+  fprintf(f, "version %d\n", SSMP_TUNE_VERSION);
+  fprintf(f, "machine %s\n", machine);
+  int cls, w;
+  for (cls = 0; cls < SSMP_TOPO_NUM; cls++)
+    {
+      if (ssmp_proto_cycles[cls][ssmp_proto_class_preset[cls]] == 0)
+	{
+	  continue;		/* no pair of cores of this class */
+	}
+      fprintf(f, "%s %s", ssmp_topo_names[cls], ssmp_proto_presets[ssmp_proto_class_preset[cls]].name);
+      for (w = 0; w < SSMP_PRESET_NUM; w++)
+	{
+	  fprintf(f, " %s=%.1f", ssmp_proto_presets[w].name, ssmp_proto_cycles[cls][w]);
+	}
+      fprintf(f, "\n");
+    }
+  fclose(f);
+
+  if (rename(tmp, path) < 0)
+    {
+      perror("ssmp_tune: cannot write the profile");
+      unlink(tmp);
+    }
+}
+
+/* ------------------------------------------------------------------------------- */
+/* the measurements */
+/* ------------------------------------------------------------------------------- */
+
+static void
+ssmp_tune_pin(uint32_t cpu)
+{
+  cpu_set_t mask;
+  CPU_ZERO(&mask);
+  CPU_SET(cpu, &mask);
+  if (sched_setaffinity(0, sizeof(cpu_set_t), &mask) != 0)
+    {
+      perror("ssmp_tune: sched_setaffinity");
+    }
+}
+
+/* as ssmp_send / ssmp_recv_from on a single buffer */
+static inline void
+ssmp_tune_send(volatile ssmp_msg_t* buf, ssmp_msg_t* msg, const ssmp_proto_t* proto)
+{
+  proto->wait_fn(&buf->state, SSMP_BUF_EMPTY);
+  ssmp_msg_copy_data(buf, msg);
+  proto->update_fn(&buf->state, SSMP_BUF_MESSG);
+}
+
+static inline void
+ssmp_tune_recv(volatile ssmp_msg_t* buf, ssmp_msg_t* msg, const ssmp_proto_t* proto)
+{
+  proto->wait_fn(&buf->state, SSMP_BUF_MESSG);
+  memcpy((void*) msg, (const void*) buf, SSMP_CACHE_LINE_SIZE);
+  proto->update_fn(&buf->state, SSMP_BUF_EMPTY);
+}
+
+static int
+ssmp_tune_cmp(const void* a, const void* b)
+{
+  double x = *(const double*) a, y = *(const double*) b;
+  return (x > y) - (x < y);
+}
+
+/* the median cycles of a roundtrip between cpus a and b (a forked process) */
+static double
+ssmp_tune_measure(uint32_t cpu_a, uint32_t cpu_b, const ssmp_proto_preset_t* preset)
+{
+  ssmp_proto_t proto;
+  ssmp_proto_make(&proto, preset);
+
+  volatile ssmp_msg_t* bufs = (volatile ssmp_msg_t*)
+    mmap(NULL, 2 * sizeof(ssmp_msg_t), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  if (bufs == MAP_FAILED)
+    {
+      perror("ssmp_tune: mmap");
+      return 0;
+    }
+  bufs[0].state = SSMP_BUF_EMPTY;
+  bufs[1].state = SSMP_BUF_EMPTY;
+
+  ssmp_msg_t msg;
+  memset(&msg, 0, sizeof(msg));
+  uint32_t total = (SSMP_TUNE_ROUNDS + 1) * SSMP_TUNE_REPS, i, r;
+
+  pid_t child = fork();
+  if (child < 0)
+    {
+      perror("ssmp_tune: fork");
+      munmap((void*) bufs, 2 * sizeof(ssmp_msg_t));
+      return 0;
+    }
+  if (child == 0)
+    {
+      ssmp_tune_pin(cpu_b);
+      for (i = 0; i < total; i++)
+	{
+	  ssmp_tune_recv(&bufs[0], &msg, &proto);
+	  ssmp_tune_send(&bufs[1], &msg, &proto);
+	}
+      _exit(0);
+    }
+
+  ssmp_tune_pin(cpu_a);
+  double rounds[SSMP_TUNE_ROUNDS + 1];
+  for (r = 0; r <= SSMP_TUNE_ROUNDS; r++) /* round 0 warms up */
+    {
+      ticks t0 = getticks_fenced();
+      for (i = 0; i < SSMP_TUNE_REPS; i++)
+	{
+	  ssmp_tune_send(&bufs[0], &msg, &proto);
+	  ssmp_tune_recv(&bufs[1], &msg, &proto);
+	}
+      rounds[r] = (double) (getticks_fenced() - t0) / SSMP_TUNE_REPS;
+    }
+  waitpid(child, NULL, 0);
+  munmap((void*) bufs, 2 * sizeof(ssmp_msg_t));
+
+  qsort(rounds + 1, SSMP_TUNE_ROUNDS, sizeof(double), ssmp_tune_cmp);
+  return rounds[1 + SSMP_TUNE_ROUNDS / 2];
+}
+
+/* the first core id (other than 0) of class cls that is online, -1 if none */
+static int
+ssmp_tune_peer(int cls, uint32_t cpus)
+{
+  uint32_t id;
+  for (id = 1; id < cpus && id < SSMP_MAX_UES; id++)
+    {
+      if (id_to_core[id] >= cpus || id_to_core[id] == id_to_core[0])
+	{
+	  continue;
+	}
+      if (ssmp_proto_class(0, id) == cls)
+	{
+	  return id;
+	}
+    }
+  return -1;
+}
+
+int
+ssmp_tune(int force)
+{
+  const char* path = ssmp_tune_profile();
+  if (!force && ssmp_tune_load(path))
+    {
+      return 0;
+    }
+
+  cpu_set_t mask;
+  int restore = (sched_getaffinity(0, sizeof(cpu_set_t), &mask) == 0);
+  uint32_t cpus = sysconf(_SC_NPROCESSORS_ONLN);
+  int cls, w;
+
+  memset(ssmp_proto_cycles, 0, sizeof(ssmp_proto_cycles));
+  for (cls = 0; cls < SSMP_TOPO_NUM; cls++)
+    {
+      int peer = ssmp_tune_peer(cls, cpus);
+      if (peer < 0)
+	{
+	  continue;		/* keep the default */
+	}
+      double* cycles = ssmp_proto_cycles[cls];
+      int best = ssmp_proto_class_preset[cls];
+      for (w = 0; w < SSMP_PRESET_NUM; w++)
+	{
+	  cycles[w] = ssmp_tune_measure(id_to_core[0], id_to_core[peer], &ssmp_proto_presets[w]);
+	  if (cycles[w] > 0 && (cycles[best] == 0 || cycles[w] < cycles[best]))
+	    {
+	      best = w;
+	    }
+	}
+      ssmp_proto_class_preset[cls] = best;
+    }
+
+  if (restore)
+    {
+      sched_setaffinity(0, sizeof(cpu_set_t), &mask);
+    }
+  ssmp_tune_store(path);
+  return 1;
+}